@@ -18,6 +18,7 @@
 #pragma once
 
 #include <multipass/exceptions/download_exception.h>
+#include <multipass/executor.h>
 #include <multipass/logging/log.h>
 
 #include <chrono>
@@ -66,7 +67,9 @@ public:
 
         // TODO, remove the launch_msg parameter once we have better class separation.
         mpl::log(mpl::Level::debug, "async task", std::string(launch_msg));
-        future = QtConcurrent::run(std::forward<Callable>(func), std::forward<Args>(args)...);
+        future = MP_EXECUTOR.run(Executor::Priority::background,
+                                 std::forward<Callable>(func),
+                                 std::forward<Args>(args)...);
 
         auto event_handler_on_success_and_failure = [retry_start_delay_time, this]() -> void {
             try
@@ -100,7 +103,7 @@ public:
             if (future.isFinished())
             {
                 mpl::log(mpl::Level::debug, "async task", std::string(launch_msg));
-                future = QtConcurrent::run(func, args...);
+                future = MP_EXECUTOR.run(Executor::Priority::background, func, args...);
                 future_watcher.setFuture(future);
             }
         });
@@ -45,6 +45,7 @@ constexpr auto home_automount_dir = "Home";
 constexpr auto multipass_storage_env_var = "MULTIPASS_STORAGE";
 constexpr auto driver_env_var = "MULTIPASS_VM_DRIVER";
 constexpr auto blueprints_url_env_var = "MULTIPASS_BLUEPRINTS_URL";
+constexpr auto trace_env_var = "MULTIPASS_TRACE"; // when set, the daemon records traces of RPCs
 
 constexpr auto winterm_profile_guid =
     "{aaaa9e6d-1e09-4be6-b76c-82b4ba1885fb}"; // identifies the primary Multipass profile in Windows
@@ -63,6 +64,9 @@ constexpr auto bridged_interface_key = "local.bridged-network";
 constexpr auto mounts_key = "local.privileged-mounts";
 constexpr auto winterm_key = "client.apps.windows-terminal.profiles";
 constexpr auto mirror_key = "local.image.mirror"; // the mirror of simple streams
+constexpr auto suspend_format_key = "local.qemu.suspend-format"; // how QEMU saves suspended state
+constexpr auto native_mount_type_key = "local.qemu.native-mount-type"; // 9p or virtiofs
+constexpr auto virtiofs_cache_key = "local.qemu.virtiofs-cache"; // virtiofsd caching policy
 
 constexpr auto cloud_init_file_name = "cloud-init-config.iso";
 
@@ -70,6 +74,11 @@ constexpr auto cloud_init_file_name = "cloud-init-config.iso";
 constexpr auto key_examples = {petenv_key, driver_key, mounts_key};
 
 constexpr auto petenv_default = "primary";
+constexpr auto suspend_format_snapshot = "snapshot"; // savevm into the instance image
+constexpr auto suspend_format_file = "file";         // migration into a separate state file
+constexpr auto native_mount_type_9p = "9p";
+constexpr auto native_mount_type_virtiofs = "virtiofs";
+constexpr auto virtiofs_cache_default = "auto";
 
 constexpr auto timeout_exit_code = 5;
 
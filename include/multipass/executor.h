@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <multipass/singleton.h>
+
+#include <QThreadPool>
+#include <QtConcurrent/QtConcurrent>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+
+#define MP_EXECUTOR multipass::Executor::instance()
+
+namespace multipass
+{
+// The daemon's shared pool of worker threads. It is bounded and reuses its threads. Interactive
+// tasks go ahead of background ones, and tasks that were cancelled before they started are skipped.
+class Executor : public Singleton<Executor>
+{
+public:
+    enum class Priority : int
+    {
+        background = 0,
+        interactive = 1
+    };
+
+    struct Counters
+    {
+        std::uint64_t tasks;
+        std::chrono::nanoseconds waiting; // from submission until the task starts
+        std::chrono::nanoseconds running;
+    };
+
+    Executor(const Singleton<Executor>::PrivatePass&) noexcept;
+
+    // Cancelling the returned future before the task starts skips it
+    template <typename Callable, typename... Args>
+    auto run(Priority priority, Callable&& func, Args&&... args);
+
+    // Calls task(0) to task(count - 1) in the pool and waits for them all, rethrowing the first
+    // exception. The calling thread takes on the calls that no worker started yet, so that nested
+    // uses make progress even when the pool is busy. Tasks inherit the caller's priority.
+    void run_and_wait(std::size_t count, const std::function<void(std::size_t)>& task);
+
+    // The priority of the task running in this thread, interactive outside of tasks
+    static Priority current_priority();
+
+    Counters counters(Priority priority) const;
+    int max_thread_count() const;
+    void wait_for_done();
+
+private:
+    // Accounts for a task while it runs, and makes its priority current
+    class TaskScope
+    {
+    public:
+        TaskScope(Executor& executor,
+                  Priority priority,
+                  std::chrono::steady_clock::time_point submitted);
+        ~TaskScope();
+
+    private:
+        Executor& executor;
+        const Priority priority;
+        const Priority previous_priority;
+        const std::chrono::steady_clock::time_point submitted;
+        const std::chrono::steady_clock::time_point started;
+    };
+
+    struct AtomicCounters
+    {
+        std::atomic<std::uint64_t> tasks{0};
+        std::atomic<std::int64_t> waiting_ns{0};
+        std::atomic<std::int64_t> running_ns{0};
+    };
+
+    AtomicCounters& counters_for(Priority priority);
+
+    std::array<AtomicCounters, 2> all_counters;
+    QThreadPool pool;
+};
+} // namespace multipass
+
+template <typename Callable, typename... Args>
+auto multipass::Executor::run(Priority priority, Callable&& func, Args&&... args)
+{
+    auto timed_func = [this,
+                       priority,
+                       func = std::forward<Callable>(func),
+                       submitted = std::chrono::steady_clock::now()](auto&&... task_args) mutable {
+        const TaskScope scope{*this, priority, submitted};
+        return std::invoke(func, std::forward<decltype(task_args)>(task_args)...);
+    };
+
+    return QtConcurrent::task(std::move(timed_func))
+        .withArguments(std::forward<Args>(args)...)
+        .withPriority(static_cast<int>(priority))
+        .onThreadPool(pool)
+        .spawn();
+}
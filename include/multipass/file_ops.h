@@ -94,6 +94,8 @@ public:
     virtual int read(int fd, void* buf, size_t nbytes) const;
     virtual int write(int fd, const void* buf, size_t nbytes) const;
     virtual off_t lseek(int fd, off_t offset, int whence) const;
+    virtual int pread(int fd, void* buf, size_t nbytes, off_t offset) const;
+    virtual int pwrite(int fd, const void* buf, size_t nbytes, off_t offset) const;
 
     // std operations
     virtual void open(std::fstream& stream,
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <multipass/disabled_copy_move.h>
+
+#include <QByteArray>
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace multipass
+{
+namespace logging
+{
+struct TraceEvent
+{
+    std::string name;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::duration duration;
+    std::uint64_t thread; // a hash of the ID of the thread that recorded the event
+};
+
+/**
+ * Collects the spans that finish on any thread while the recording is live.
+ *
+ * Recordings export Chrome trace JSON, which chrome://tracing and https://ui.perfetto.dev display
+ * as nested phases per thread. Spans finishing during several recordings go into all of them.
+ */
+class TraceRecording : private DisabledCopyMove
+{
+public:
+    explicit TraceRecording(std::string name);
+    ~TraceRecording();
+
+    void add(TraceEvent event);
+    void finish(); // stops recording and closes the span of the recording itself
+
+    std::vector<TraceEvent> events() const;
+    QByteArray to_chrome_trace() const;
+
+private:
+    const std::string name;
+    const std::chrono::steady_clock::time_point start;
+    const std::uint64_t thread;
+    mutable std::mutex mutex;
+    std::vector<TraceEvent> recorded_events;
+    bool finished{false};
+};
+
+/**
+ * Times a named phase, from construction to destruction, for all live recordings.
+ *
+ * Spans are cheap when nothing is being recorded: they only check an atomic counter.
+ */
+class TraceSpan : private DisabledCopyMove
+{
+public:
+    explicit TraceSpan(std::string_view name);
+    ~TraceSpan();
+
+private:
+    std::string name;
+    std::optional<std::chrono::steady_clock::time_point> start;
+};
+} // namespace logging
+} // namespace multipass
@@ -37,6 +37,10 @@ public:
 
     QString apparmor_profile() const override;
 
+    // The backing images that the given qcow2 image is layered on, nearest first. Processes that
+    // open the image need to be allowed to read them too.
+    static QStringList backing_images_of(const QString& image_path);
+
 private:
     const QStringList args;
     const QString source_image;
@@ -20,8 +20,13 @@
 #include "setting_spec.h"
 #include "settings_handler.h"
 
+#include <functional>
 #include <map>
+#include <memory>
 #include <mutex>
+#include <vector>
+
+class QFileSystemWatcher;
 
 namespace multipass
 {
@@ -33,9 +38,26 @@ public:
     void set(const QString& key, const QString& val) override;
     std::set<QString> keys() const override;
 
+    ~PersistentSettingsHandler() override;
+
+    // Observers are called with the key and new value of settings changed through this handler or,
+    // provided there is a running Qt event loop, of known settings changed on disk by others
+    using Observer = std::function<void(const QString& key, const QString& val)>;
+    void subscribe(Observer observer);
+
 private:
     const SettingSpec& get_setting(const QString& key) const; // throws on unknown key
 
+    /* Settings that were already read or written are served from an immutable snapshot, which is
+       replaced as a whole (under the mutex) when anything changes, so that readers need no locking
+       and no disk access. Changes made by others are detected by watching the settings file. */
+    using Snapshot = std::map<QString, QString>;
+    void publish(const QString& key, const QString& val) const; // requires the mutex
+    void watch_file();
+    void watch_paths();
+    void reload();
+    void notify(const Snapshot& changes);
+
 private:
     using SettingMap = std::map<QString, SettingSpec::UPtr>;
     static SettingMap convert(SettingSpec::Set);
@@ -44,5 +66,9 @@ private:
     QString filename;
     SettingMap settings;
     mutable std::mutex mutex;
+    mutable std::shared_ptr<const Snapshot> snapshot;
+    std::unique_ptr<QFileSystemWatcher> watcher;
+    std::vector<Observer> observers;
+    std::mutex observers_mutex;
 };
 } // namespace multipass
@@ -24,6 +24,7 @@
 
 #include <QByteArray>
 #include <QMap>
+#include <QMultiMap>
 #include <QString>
 
 #include <memory>
@@ -43,6 +44,8 @@ struct SimpleStreamsManifest
     const QString updated_at;
     const std::vector<VMImageInfo> products;
     const QMap<QString, const VMImageInfo*> image_records;
+    // Every product by image hash, ordered so that partial hashes can be looked up too
+    const QMultiMap<QString, const VMImageInfo*> images_by_id;
 
     SimpleStreamsManifest(const QString& updated_at, std::vector<VMImageInfo>&& images);
 };
@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <QByteArray>
+#include <QFile>
+
+namespace multipass
+{
+// Writes a file out sequentially, seeking over blocks of zeros instead of writing them, so that
+// they become holes on file systems that support them. The file must start out empty.
+class SparseFileWriter
+{
+public:
+    static constexpr qint64 block_size = 4096;
+
+    explicit SparseFileWriter(QFile& file);
+
+    void write(const char* data, qint64 size);
+    void write(const QByteArray& data);
+
+    // Writes out what is pending and extends the file over any trailing zeros. Must be called once
+    // all the data has been written.
+    void finish();
+
+    qint64 size() const;
+    qint64 bytes_written() const;
+
+private:
+    void write_blocks(const char* data, qint64 size);
+    void write_at(qint64 offset, const char* data, qint64 size);
+
+    QFile& file;
+    QByteArray pending;
+    qint64 position{0};
+    qint64 file_position{0};
+    qint64 written{0};
+};
+} // namespace multipass
@@ -22,13 +22,23 @@
 #include <libssh/libssh.h>
 
 #include <chrono>
+#include <future>
 #include <memory>
 #include <mutex>
 #include <string>
 
 namespace multipass
 {
+class SSHChannelMultiplexer;
 class SSHKeyProvider;
+
+struct SSHCommandResult
+{
+    int exit_code;
+    std::string std_output;
+    std::string std_error;
+};
+
 class SSHSession
 {
 public:
@@ -50,6 +60,15 @@ public:
     SSHProcess exec(const std::string& cmd,
                     bool whisper = false); /* locks the session until the process is destroyed
                                               or exit_code is called! */
+
+    // Runs the command on a channel of its own, concurrently with other exec_async calls. Output is
+    // collected as it arrives. The result is an SSHProcessTimeoutException if the command does not
+    // finish within the timeout.
+    std::future<SSHCommandResult> exec_async(
+        const std::string& cmd,
+        bool whisper = false,
+        std::chrono::milliseconds timeout = std::chrono::seconds(5));
+
     [[nodiscard]] bool is_connected() const;
 
     operator ssh_session(); // careful, not thread safe
@@ -59,8 +78,12 @@ private:
     SSHSession(SSHSession&&, std::unique_lock<std::mutex> lock);
 
     void set_option(ssh_options_e type, const void* value);
+    std::unique_lock<std::mutex> lock_for_move();
+    void stop_multiplexer();
 
     std::unique_ptr<ssh_session_struct, void (*)(ssh_session)> session;
     mutable std::mutex mut;
+    std::unique_ptr<SSHChannelMultiplexer> multiplexer; // started on first use
+    std::mutex multiplexer_mutex;
 };
 } // namespace multipass
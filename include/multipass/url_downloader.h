@@ -28,6 +28,7 @@
 
 #include <atomic>
 #include <chrono>
+#include <functional>
 
 #define MP_NETMGRFACTORY multipass::NetworkManagerFactory::instance()
 
@@ -51,12 +52,21 @@ public:
     URLDownloader(const Path& cache_dir, std::chrono::milliseconds timeout);
     virtual ~URLDownloader() = default;
 
+    using DataHandler = std::function<bool(const QByteArray&)>;
+
     // Note: All http urls are converted to https
     virtual void download_to(const QUrl& url,
                              const QString& file_name,
                              int64_t size,
                              const int download_type,
                              const ProgressMonitor& monitor);
+    // Passes the data to on_data as it arrives, instead of writing it to a file. The download is
+    // aborted if on_data returns false.
+    virtual void stream_to(const QUrl& url,
+                           const DataHandler& on_data,
+                           int64_t size,
+                           const int download_type,
+                           const ProgressMonitor& monitor);
     virtual QByteArray download(const QUrl& url);
     virtual QByteArray download(const QUrl& url, const bool is_force_update_from_network);
     virtual QDateTime last_modified(const QUrl& url);
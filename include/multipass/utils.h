@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include <multipass/executor.h>
 #include <multipass/logging/level.h>
 #include <multipass/network_interface_info.h>
 #include <multipass/path.h>
@@ -30,6 +31,7 @@
 #include <filesystem>
 #include <functional>
 #include <future>
+#include <iterator>
 #include <string>
 #include <vector>
 
@@ -145,6 +147,14 @@ void try_action_for(OnTimeoutCallable&& on_timeout,
                     TryAction&& try_action,
                     Args&&... args);
 
+// like try_action_for, but retrying at the given interval rather than every second
+template <typename OnTimeoutCallable, typename TryAction, typename... Args>
+void try_action_every(std::chrono::milliseconds interval,
+                      OnTimeoutCallable&& on_timeout,
+                      std::chrono::milliseconds timeout,
+                      TryAction&& try_action,
+                      Args&&... args);
+
 template <typename T>
 bool is_default_constructed(const T& input_type)
 {
@@ -163,21 +173,21 @@ parallel_transform(const Container& input_container, UnaryOperation&& unary_op)
 {
     using InputValueType = typename Container::value_type;
     using OutputValueType = std::invoke_result_t<std::decay_t<UnaryOperation>, InputValueType>;
-    const auto num_elements = input_container.size();
-
-    // Pre-allocate space for futures
-    std::vector<std::future<OutputValueType>> futures(num_elements);
 
-    int index = 0;
+    std::vector<const InputValueType*> inputs;
+    inputs.reserve(input_container.size());
     for (const auto& item : input_container)
-    {
-        futures[index++] = std::async(std::launch::async, unary_op, std::cref(item));
-    }
+        inputs.push_back(&item);
+
+    // The work goes to the shared executor, rather than to a thread per element
+    std::vector<OutputValueType> outputs(inputs.size());
+    MP_EXECUTOR.run_and_wait(inputs.size(), [&inputs, &outputs, &unary_op](std::size_t i) {
+        outputs[i] = std::invoke(unary_op, *inputs[i]);
+    });
 
     std::vector<OutputValueType> results;
-    for (auto& fut : futures)
+    for (auto& item : outputs)
     {
-        auto item = fut.get();
         if (!is_default_constructed(item))
         {
             results.emplace_back(std::move(item));
@@ -190,19 +200,15 @@ parallel_transform(const Container& input_container, UnaryOperation&& unary_op)
 template <typename Container, typename UnaryOperation>
 void parallel_for_each(Container& input_container, UnaryOperation&& unary_op)
 {
-    const auto num_elements = input_container.size();
-    std::vector<std::future<void>> empty_futures;
-    empty_futures.reserve(num_elements);
-
+    using ItemType = std::remove_reference_t<decltype(*std::begin(input_container))>;
+    std::vector<ItemType*> items;
+    items.reserve(input_container.size());
     for (auto& item : input_container)
-    {
-        empty_futures.emplace_back(std::async(std::launch::async, unary_op, std::ref(item)));
-    }
+        items.push_back(&item);
 
-    for (auto& empty_future : empty_futures)
-    {
-        empty_future.get();
-    }
+    MP_EXECUTOR.run_and_wait(items.size(), [&items, &unary_op](std::size_t i) {
+        std::invoke(unary_op, *items[i]);
+    });
 }
 } // namespace utils
 
@@ -310,11 +316,26 @@ void multipass::utils::try_action_for(OnTimeoutCallable&& on_timeout,
                                       TryAction&& try_action,
                                       Args&&... args)
 {
+    using namespace std::literals::chrono_literals;
+
+    try_action_every(1s,
+                     std::forward<OnTimeoutCallable>(on_timeout),
+                     timeout,
+                     std::forward<TryAction>(try_action),
+                     std::forward<Args>(args)...);
+}
+
+template <typename OnTimeoutCallable, typename TryAction, typename... Args>
+void multipass::utils::try_action_every(std::chrono::milliseconds interval,
+                                        OnTimeoutCallable&& on_timeout,
+                                        std::chrono::milliseconds timeout,
+                                        TryAction&& try_action,
+                                        Args&&... args)
+{
 
     static_assert(
         std::is_same<decltype(try_action(std::forward<Args>(args)...)), TimeoutAction>::value,
         "");
-    using namespace std::literals::chrono_literals;
 
     auto deadline = std::chrono::steady_clock::now() + timeout;
     while (std::chrono::steady_clock::now() < deadline)
@@ -322,8 +343,8 @@ void multipass::utils::try_action_for(OnTimeoutCallable&& on_timeout,
         if (try_action(std::forward<Args>(args)...) == TimeoutAction::done)
             return;
 
-        // retry every second, until timeout - mock this to avoid sleeping at all in tests
-        MP_UTILS.sleep_for(timeout < 1s ? timeout : 1s);
+        // retry every interval, until timeout - mock this to avoid sleeping at all in tests
+        MP_UTILS.sleep_for(timeout < interval ? timeout : interval);
     }
 
     on_timeout();
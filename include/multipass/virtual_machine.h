@@ -110,6 +110,7 @@ public:
     virtual std::shared_ptr<Snapshot> get_snapshot(const std::string& name) = 0;
     virtual std::shared_ptr<Snapshot> get_snapshot(int index) = 0;
 
+    virtual bool supports_live_snapshots() const = 0; // whether running instances can be snapshot
     virtual std::shared_ptr<const Snapshot> take_snapshot(const VMSpecs& specs,
                                                           const std::string& snapshot_name,
                                                           const std::string& comment) = 0;
@@ -129,6 +130,7 @@ public:
     std::condition_variable state_wait;
     std::mutex state_mutex;
     std::optional<IPAddress> management_ip;
+    std::mutex management_ip_mutex; // looked up from list, info and start workers alike
     bool shutdown_while_starting{false};
 
 protected:
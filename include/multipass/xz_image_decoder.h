@@ -19,11 +19,10 @@
 
 #include <multipass/path.h>
 #include <multipass/progress_monitor.h>
+#include <multipass/sparse_file_writer.h>
 
 #include <memory>
 
-#include <QFile>
-
 #include <xz.h>
 
 namespace multipass
@@ -32,14 +31,21 @@ class XzImageDecoder
 {
 public:
     XzImageDecoder();
+    // Multi-block files are decoded by up to this many threads, if more than one
+    explicit XzImageDecoder(unsigned max_threads);
 
     void decode_to(const Path& xz_file_path,
                    const Path& decoded_file_path,
                    const ProgressMonitor& monitor) const;
 
+    // Decodes the next part of an xz stream that arrives in chunks, writing out what it decodes.
+    // Returns false once the end of the stream is reached.
+    bool decode_chunk(const QByteArray& chunk, SparseFileWriter& writer) const;
+
     using XzDecoderUPtr = std::unique_ptr<xz_dec, decltype(xz_dec_end)*>;
 
 private:
     XzDecoderUPtr xz_decoder;
+    const unsigned max_threads;
 };
 } // namespace multipass
@@ -64,8 +64,9 @@ QString cmd::Snapshot::short_help() const
 
 QString cmd::Snapshot::description() const
 {
-    return QStringLiteral("Take a snapshot of a stopped instance that can later be restored to "
-                          "recover the current state.");
+    return QStringLiteral("Take a snapshot of an instance that can later be restored to recover "
+                          "the current state. Depending on the driver, the instance may need to be "
+                          "stopped. Snapshots of running instances capture only their disks.");
 }
 
 mp::ParseCode cmd::Snapshot::parse_args(mp::ArgParser* parser)
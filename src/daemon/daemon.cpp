@@ -34,15 +34,18 @@
 #include <multipass/exceptions/sshfs_missing_error.h>
 #include <multipass/exceptions/start_exception.h>
 #include <multipass/exceptions/virtual_machine_state_exceptions.h>
+#include <multipass/executor.h>
 #include <multipass/ip_address.h>
 #include <multipass/json_utils.h>
 #include <multipass/logging/client_logger.h>
 #include <multipass/logging/log.h>
+#include <multipass/logging/trace.h>
 #include <multipass/name_generator.h>
 #include <multipass/network_interface.h>
 #include <multipass/platform.h>
 #include <multipass/query.h>
 #include <multipass/settings/bool_setting_spec.h>
+#include <multipass/settings/persistent_settings_handler.h>
 #include <multipass/settings/settings.h>
 #include <multipass/snapshot.h>
 #include <multipass/ssh/ssh_session.h>
@@ -75,6 +78,7 @@
 #include <algorithm>
 #include <cassert>
 #include <functional>
+#include <future>
 #include <optional>
 #include <stdexcept>
 #include <type_traits>
@@ -95,8 +99,10 @@ using error_string = std::string;
 
 constexpr auto category = "daemon";
 constexpr auto instance_db_name = "multipassd-vm-instances.json";
+constexpr auto instance_journal_name = "multipassd-vm-instances.journal";
 constexpr auto reboot_cmd = "sudo reboot";
 constexpr auto stop_ssh_cmd = "sudo systemctl stop ssh";
+constexpr auto runtime_info_timeout = 10s;
 const std::string sshfs_error_template =
     "Error enabling mount support in '{}'"
     "\n\nPlease install the 'multipass-sshfs' snap manually inside the instance.";
@@ -230,7 +236,8 @@ auto name_from(const std::string& requested_name,
 }
 
 std::unordered_map<std::string, mp::VMSpecs> load_db(const mp::Path& data_path,
-                                                     const mp::Path& cache_path)
+                                                     const mp::Path& cache_path,
+                                                     mp::InstanceJournal& journal)
 {
     QDir data_dir{data_path};
     QDir cache_dir{cache_path};
@@ -243,12 +250,13 @@ std::unordered_map<std::string, mp::VMSpecs> load_db(const mp::Path& data_path,
             return {};
     }
 
+    const auto db_contents = db_file.readAll();
     QJsonParseError parse_error;
-    auto doc = QJsonDocument::fromJson(db_file.readAll(), &parse_error);
+    auto doc = QJsonDocument::fromJson(db_contents, &parse_error);
     if (doc.isNull())
         return {};
 
-    auto records = doc.object();
+    auto records = journal.replay(db_contents, doc.object());
     if (records.isEmpty())
         return {};
 
@@ -948,6 +956,92 @@ grpc::Status cmd_vms(const LinearInstanceSelection& tgts, const VMCommand& cmd)
     return grpc::Status::OK;
 }
 
+// The addresses of a running instance, which `list` collects away from the daemon's thread
+struct IPv4Query
+{
+    int entry_index;
+    mp::VirtualMachine::ShPtr vm;
+    std::string management_ipv4{};
+    std::vector<std::string> all_ipv4{};
+};
+
+void add_ipv4_to(mp::ListVMInstance& entry, const IPv4Query& query)
+{
+    if (MP_UTILS.is_ipv4_valid(query.management_ipv4))
+        entry.add_ipv4(query.management_ipv4);
+    else if (query.all_ipv4.empty())
+        entry.add_ipv4("N/A");
+
+    for (const auto& extra_ipv4 : query.all_ipv4)
+        if (extra_ipv4 != query.management_ipv4)
+            entry.add_ipv4(extra_ipv4);
+}
+
+// The runtime details of a running instance, which `info` collects away from the daemon's thread
+struct RuntimeInfoQuery
+{
+    int details_index;
+    mp::VirtualMachine::ShPtr vm;
+    bool parallelize;
+};
+
+// Each instance is queried in its own task on the shared executor, so that an unresponsive one can
+// be left behind when the deadline passes. Its record then stays without runtime details, rather
+// than holding up the whole reply, and its task is cancelled if it did not start yet.
+void populate_runtime_info_for(const std::vector<RuntimeInfoQuery>& queries,
+                               mp::InfoReply& response)
+{
+    std::vector<std::future<mp::DetailedInfoItem>> results;
+    std::vector<QFuture<void>> tasks;
+    results.reserve(queries.size());
+    tasks.reserve(queries.size());
+
+    for (const auto& query : queries)
+    {
+        auto task = std::make_shared<std::packaged_task<mp::DetailedInfoItem()>>(
+            [vm = query.vm,
+             info = response.details(query.details_index),
+             parallelize = query.parallelize]() mutable {
+                auto instance_info = info.mutable_instance_info();
+                mp::RuntimeInstanceInfoHelper::populate_runtime_info(*vm,
+                                                                     &info,
+                                                                     instance_info,
+                                                                     instance_info->image_release(),
+                                                                     parallelize);
+                return info;
+            });
+
+        results.push_back(task->get_future());
+        tasks.push_back(
+            MP_EXECUTOR.run(mp::Executor::Priority::interactive, [task] { (*task)(); }));
+    }
+
+    const auto deadline = std::chrono::steady_clock::now() + runtime_info_timeout;
+    for (std::size_t i = 0; i < queries.size(); ++i)
+    {
+        const auto& name = queries[i].vm->vm_name;
+        if (results[i].wait_until(deadline) != std::future_status::ready)
+        {
+            mpl::log(mpl::Level::warning,
+                     category,
+                     fmt::format("Timed out getting runtime information for \"{}\"", name));
+            tasks[i].cancel(); // skipped unless it already started
+            continue;
+        }
+
+        try
+        {
+            *response.mutable_details(queries[i].details_index) = results[i].get();
+        }
+        catch (const std::exception& e)
+        {
+            mpl::log(mpl::Level::warning,
+                     category,
+                     fmt::format("Cannot get runtime information for \"{}\": {}", name, e.what()));
+        }
+    }
+}
+
 std::vector<std::string> names_from(const LinearInstanceSelection& instances)
 {
     std::vector<std::string> ret;
@@ -1316,6 +1410,7 @@ void populate_snapshot_fundamentals(std::shared_ptr<const mp::Snapshot> snapshot
 
 void populate_mount_info(const std::unordered_map<std::string, mp::VMMount>& mounts,
                          mp::MountInfo* mount_info,
+                         bool mounts_enabled,
                          bool& have_mounts)
 {
     mount_info->set_longest_path_len(0);
@@ -1323,7 +1418,7 @@ void populate_mount_info(const std::unordered_map<std::string, mp::VMMount>& mou
     if (!mounts.empty())
         have_mounts = true;
 
-    if (MP_SETTINGS.get_as<bool>(mp::mounts_key))
+    if (mounts_enabled)
     {
         for (const auto& mount : mounts)
         {
@@ -1353,6 +1448,7 @@ void populate_mount_info(const std::unordered_map<std::string, mp::VMMount>& mou
 void populate_snapshot_info(mp::VirtualMachine& vm,
                             std::shared_ptr<const mp::Snapshot> snapshot,
                             mp::InfoReply& response,
+                            bool mounts_enabled,
                             bool& have_mounts)
 {
     auto* info = response.add_details();
@@ -1366,7 +1462,7 @@ void populate_snapshot_info(mp::VirtualMachine& vm,
     info->set_cpu_count(std::to_string(snapshot->get_num_cores()));
 
     auto mount_info = info->mutable_mount_info();
-    populate_mount_info(snapshot->get_mounts(), mount_info, have_mounts);
+    populate_mount_info(snapshot->get_mounts(), mount_info, mounts_enabled, have_mounts);
 
     // TODO@snapshots get snapshot size once available
 
@@ -1394,12 +1490,20 @@ void lxd_and_libvirt_deprecation_warning(grpc::ServerReaderWriterInterface<Reply
 
 mp::Daemon::Daemon(std::unique_ptr<const DaemonConfig> the_config)
     : config{std::move(the_config)},
+      instance_journal{QDir{mp::utils::backend_directory_path(
+                                config->data_directory,
+                                config->factory->get_backend_directory_name())}
+                           .filePath(instance_journal_name)},
       vm_instance_specs{load_db(
           mp::utils::backend_directory_path(config->data_directory,
                                             config->factory->get_backend_directory_name()),
           mp::utils::backend_directory_path(config->cache_directory,
-                                            config->factory->get_backend_directory_name()))},
-      daemon_rpc{config->server_address, *config->cert_provider, config->client_cert_store.get()},
+                                            config->factory->get_backend_directory_name()),
+          instance_journal)},
+      daemon_rpc{config->server_address,
+                 *config->cert_provider,
+                 config->client_cert_store.get(),
+                 config->trace_directory},
       instance_mod_handler{register_instance_mod(
           vm_instance_specs,
           operative_instances,
@@ -1897,17 +2001,23 @@ try
     if (snapshots_only)
         config->factory->require_snapshots_support();
 
-    auto process_snapshot_pick = [&response, &have_mounts, snapshots_only](
+    auto process_snapshot_pick = [this, &response, &have_mounts, snapshots_only](
                                      VirtualMachine& vm,
                                      const SnapshotPick& snapshot_pick) {
         for (const auto& snapshot_name : snapshot_pick.pick)
         {
             const auto snapshot = vm.get_snapshot(snapshot_name); // verify validity even if unused
             if (!snapshot_pick.all_or_none || !snapshots_only)
-                populate_snapshot_info(vm, snapshot, response, have_mounts);
+                populate_snapshot_info(vm,
+                                       snapshot,
+                                       response,
+                                       privileged_mounts_enabled(),
+                                       have_mounts);
         }
     };
 
+    std::vector<RuntimeInfoQuery> runtime_info_queries;
+
     auto fetch_detailed_report = [this,
                                   &instance_snapshots_map,
                                   process_snapshot_pick,
@@ -1915,7 +2025,8 @@ try
                                   request,
                                   &response,
                                   &have_mounts,
-                                  &deleted](VirtualMachine& vm) {
+                                  &deleted,
+                                  &runtime_info_queries](VirtualMachine& vm) {
         fmt::memory_buffer errors;
         const auto& name = vm.vm_name;
 
@@ -1930,13 +2041,22 @@ try
             {
                 if (snapshots_only)
                     for (const auto& snapshot : vm.view_snapshots())
-                        populate_snapshot_info(vm, snapshot, response, have_mounts);
-                else
-                    populate_instance_info(vm,
-                                           response,
-                                           request->no_runtime_information(),
-                                           deleted,
-                                           have_mounts);
+                        populate_snapshot_info(vm,
+                                               snapshot,
+                                               response,
+                                               privileged_mounts_enabled(),
+                                               have_mounts);
+                else if (populate_instance_info(vm,
+                                                response,
+                                                request->no_runtime_information(),
+                                                deleted,
+                                                have_mounts))
+                {
+                    auto& instances = deleted ? deleted_instances : operative_instances;
+                    runtime_info_queries.push_back({response.details_size() - 1,
+                                                    instances.at(name),
+                                                    vm_instance_specs[name].num_cores != 1});
+                }
             }
         }
         catch (const NoSuchSnapshotException& e)
@@ -1964,11 +2084,38 @@ try
             status = cmd_vms(instance_selection.deleted_selection, fetch_detailed_report);
         }
 
-        if (have_mounts && !MP_SETTINGS.get_as<bool>(mp::mounts_key))
+        if (have_mounts && !privileged_mounts_enabled())
             mpl::log(mpl::Level::error,
                      category,
                      "Mounts have been disabled on this instance of Multipass");
 
+        if (status.ok() && !runtime_info_queries.empty())
+        {
+            // Runtime details come over SSH from each instance, which would hold up every other
+            // request if it happened on the daemon's thread
+            auto log_level = mpl::level_from(request->verbosity_level());
+            auto collect_runtime_info = [this,
+                                         server,
+                                         status_promise,
+                                         log_level,
+                                         response,
+                                         runtime_info_queries]() mutable {
+                mpl::ClientLogger<InfoReply, InfoRequest> logger{log_level,
+                                                                 *config->logger,
+                                                                 server};
+
+                populate_runtime_info_for(runtime_info_queries, response);
+                server->Write(response);
+
+                return AsyncOperationStatus{grpc::Status::OK, status_promise};
+            };
+
+            auto future_watcher = create_future_watcher();
+            future_watcher->setFuture(QtConcurrent::run(std::move(collect_runtime_info)));
+
+            return;
+        }
+
         server->Write(response);
     }
 
@@ -2002,8 +2149,9 @@ try
         response.mutable_instance_list();
 
     bool deleted = false;
+    std::vector<IPv4Query> ipv4_queries;
 
-    auto fetch_instance = [this, request, &response, &deleted](VirtualMachine& vm) {
+    auto fetch_instance = [this, request, &response, &deleted, &ipv4_queries](VirtualMachine& vm) {
         const auto& name = vm.vm_name;
         auto present_state = vm.current_state();
         auto entry = response.mutable_instance_list()->add_instances();
@@ -2036,17 +2184,9 @@ try
 
         if (request->request_ipv4() && MP_UTILS.is_running(present_state))
         {
-            std::string management_ip = vm.management_ipv4();
-            auto all_ipv4 = vm.get_all_ipv4();
-
-            if (MP_UTILS.is_ipv4_valid(management_ip))
-                entry->add_ipv4(management_ip);
-            else if (all_ipv4.empty())
-                entry->add_ipv4("N/A");
-
-            for (const auto& extra_ipv4 : all_ipv4)
-                if (extra_ipv4 != management_ip)
-                    entry->add_ipv4(extra_ipv4);
+            auto& instances = deleted ? deleted_instances : operative_instances;
+            ipv4_queries.push_back(
+                {response.instance_list().instances_size() - 1, instances.at(name)});
         }
 
         return grpc::Status::OK;
@@ -2084,8 +2224,42 @@ try
         status = cmd_vms(select_all(deleted_instances), cmd);
     }
 
-    server->Write(response);
-    status_promise->set_value(status);
+    if (!status.ok() || ipv4_queries.empty())
+    {
+        server->Write(response);
+        return status_promise->set_value(status);
+    }
+
+    // Getting the addresses means going over SSH to each instance, which would hold up every other
+    // request if it happened on the daemon's thread. The VMs are shared, so they stay alive even if
+    // deleted or purged meanwhile.
+    auto log_level = mpl::level_from(request->verbosity_level());
+    auto future_watcher = create_future_watcher();
+    future_watcher->setFuture(QtConcurrent::run(
+        [this, server, status_promise, log_level, response, ipv4_queries]() mutable {
+            mpl::ClientLogger<ListReply, ListRequest> logger{log_level, *config->logger, server};
+
+            try
+            {
+                utils::parallel_for_each(ipv4_queries, [](IPv4Query& query) {
+                    query.management_ipv4 = query.vm->management_ipv4();
+                    query.all_ipv4 = query.vm->get_all_ipv4();
+                });
+
+                auto instances = response.mutable_instance_list()->mutable_instances();
+                for (const auto& query : ipv4_queries)
+                    add_ipv4_to(*instances->Mutable(query.entry_index), query);
+
+                server->Write(response);
+                return AsyncOperationStatus{grpc::Status::OK, status_promise};
+            }
+            catch (const std::exception& e)
+            {
+                return AsyncOperationStatus{
+                    grpc::Status(grpc::StatusCode::FAILED_PRECONDITION, e.what(), ""),
+                    status_promise};
+            }
+        }));
 }
 catch (const std::exception& e)
 {
@@ -2134,7 +2308,7 @@ try
                                                        *config->logger,
                                                        server};
 
-    if (!MP_SETTINGS.get_as<bool>(mp::mounts_key))
+    if (!privileged_mounts_enabled())
         return status_promise->set_value(grpc::Status(
             grpc::StatusCode::FAILED_PRECONDITION,
             "Mounts are disabled on this installation of Multipass.\n\n"
@@ -2325,7 +2499,7 @@ try
                                           "instance(s) missing",
                                           make_start_error_details(instance_selection)});
 
-    bool complain_disabled_mounts = !MP_SETTINGS.get_as<bool>(mp::mounts_key);
+    bool complain_disabled_mounts = !privileged_mounts_enabled();
 
     std::vector<std::string> starting_vms{};
     starting_vms.reserve(instance_selection.operative_selection.size());
@@ -2370,6 +2544,7 @@ try
                          "Mounts have been disabled on this instance of Multipass");
             }
 
+            const mpl::TraceSpan span{"start_vm"};
             vm.start();
         }
 
@@ -2901,10 +3076,14 @@ try
         assert(vm_ptr);
 
         using St = VirtualMachine::State;
-        if (auto state = vm_ptr->current_state(); state != St::off && state != St::stopped)
-            return status_promise->set_value(
-                grpc::Status{grpc::FAILED_PRECONDITION,
-                             "Multipass can only take snapshots of stopped instances."});
+        if (auto state = vm_ptr->current_state();
+            state != St::off && state != St::stopped &&
+            (state != St::running || !vm_ptr->supports_live_snapshots()))
+            return status_promise->set_value(grpc::Status{
+                grpc::FAILED_PRECONDITION,
+                vm_ptr->supports_live_snapshots()
+                    ? "Multipass can only take snapshots of running or stopped instances."
+                    : "Multipass can only take snapshots of stopped instances."});
 
         auto snapshot_name = request->snapshot();
         if (!snapshot_name.empty() && !mp::utils::valid_hostname(snapshot_name))
@@ -3174,14 +3353,14 @@ void mp::Daemon::on_restart(const std::string& name)
 void mp::Daemon::persist_state_for(const std::string& name, const VirtualMachine::State& state)
 {
     vm_instance_specs[name].state = state;
-    persist_instances();
+    persist_instance(name);
 }
 
 void mp::Daemon::update_metadata_for(const std::string& name, const QJsonObject& metadata)
 {
     vm_instance_specs[name].metadata = metadata;
 
-    persist_instances();
+    persist_instance(name);
 }
 
 QJsonObject mp::Daemon::retrieve_metadata_for(const std::string& name)
@@ -3200,6 +3379,42 @@ void mp::Daemon::persist_instances()
     QDir data_dir{mp::utils::backend_directory_path(config->data_directory,
                                                     config->factory->get_backend_directory_name())};
     MP_JSONUTILS.write_json(instance_records_json, data_dir.filePath(instance_db_name));
+    instance_journal.reset(QJsonDocument{instance_records_json}.toJson());
+}
+
+void mp::Daemon::persist_instance(const std::string& name)
+{
+    // Log just this instance's record, unless it is time to rewrite the whole database
+    if (!instance_journal.append(QString::fromStdString(name),
+                                 vm_spec_to_json(vm_instance_specs[name])))
+        persist_instances();
+}
+
+void mp::Daemon::follow_settings(PersistentSettingsHandler& handler)
+{
+    // Subscribing before the read below, so that later changes are not missed
+    auto mounts = std::make_shared<std::atomic_bool>();
+    handler.subscribe([mounts](const QString& key, const QString& val) {
+        if (key == mp::mounts_key)
+            *mounts = QVariant{val}.value<bool>();
+    });
+
+    try
+    {
+        *mounts = QVariant{handler.get(mp::mounts_key)}.value<bool>();
+        privileged_mounts = std::move(mounts);
+    }
+    catch (const std::exception& e)
+    {
+        mpl::log(mpl::Level::warning,
+                 category,
+                 fmt::format("Not caching {}: {}", mp::mounts_key, e.what()));
+    }
+}
+
+bool mp::Daemon::privileged_mounts_enabled() const
+{
+    return privileged_mounts ? privileged_mounts->load() : MP_SETTINGS.get_as<bool>(mp::mounts_key);
 }
 
 void mp::Daemon::release_resources(const std::string& instance)
@@ -3344,7 +3559,10 @@ void mp::Daemon::create_vm(const CreateRequest* request,
                     reply.set_create_message("Starting " + name);
                     server->Write(reply);
 
-                    operative_instances[name]->start();
+                    {
+                        const mpl::TraceSpan span{"start_vm"};
+                        operative_instances[name]->start();
+                    }
 
                     auto future_watcher =
                         create_future_watcher([this, server, name, vm_aliases, vm_workspaces] {
@@ -3846,7 +4064,10 @@ error_string mp::Daemon::async_wait_for_ssh_and_start_mounts_for(
             return fmt::to_string(errors);
         }
         const auto vm = it->second;
-        vm->wait_until_ssh_up(timeout);
+        {
+            const mpl::TraceSpan span{"wait_until_ssh_up"};
+            vm->wait_until_ssh_up(timeout);
+        }
 
         if (std::is_same<Reply, LaunchReply>::value)
         {
@@ -3857,10 +4078,11 @@ error_string mp::Daemon::async_wait_for_ssh_and_start_mounts_for(
                 server->Write(reply);
             }
 
+            const mpl::TraceSpan span{"wait_for_cloud_init"};
             vm->wait_for_cloud_init(timeout);
         }
 
-        if (MP_SETTINGS.get_as<bool>(mp::mounts_key))
+        if (privileged_mounts_enabled())
         {
             std::vector<std::string> invalid_mounts;
             fmt::memory_buffer warnings;
@@ -3870,6 +4092,7 @@ error_string mp::Daemon::async_wait_for_ssh_and_start_mounts_for(
                 {
                     if (!mount->is_mount_managed_by_backend())
                     {
+                        const mpl::TraceSpan span{"activate_mount"};
                         mount->activate(server);
                     }
                 }
@@ -4040,7 +4263,7 @@ void mp::Daemon::reply_msg(grpc::ServerReaderWriterInterface<Reply, Request>* se
     server->Write(reply);
 }
 
-void mp::Daemon::populate_instance_info(VirtualMachine& vm,
+bool mp::Daemon::populate_instance_info(VirtualMachine& vm,
                                         mp::InfoReply& response,
                                         bool no_runtime_info,
                                         bool deleted,
@@ -4091,19 +4314,14 @@ void mp::Daemon::populate_instance_info(VirtualMachine& vm,
     auto vm_specs = vm_instance_specs[name];
 
     auto mount_info = info->mutable_mount_info();
-    populate_mount_info(vm_specs.mounts, mount_info, have_mounts);
+    populate_mount_info(vm_specs.mounts, mount_info, privileged_mounts_enabled(), have_mounts);
 
     const auto created_time = QFileInfo{vm.instance_directory().path()}.birthTime();
     auto timestamp = instance_info->mutable_creation_timestamp();
     timestamp->set_seconds(created_time.toSecsSinceEpoch());
     timestamp->set_nanos(created_time.time().msec() * 1'000'000);
 
-    if (!no_runtime_info && MP_UTILS.is_running(present_state))
-        RuntimeInstanceInfoHelper::populate_runtime_info(vm,
-                                                         info,
-                                                         instance_info,
-                                                         original_release,
-                                                         vm_specs.num_cores != 1);
+    return !no_runtime_info && MP_UTILS.is_running(present_state);
 }
 
 std::string mp::Daemon::dest_name_for_clone(const CloneRequest& request)
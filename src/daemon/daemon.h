@@ -19,6 +19,7 @@
 
 #include "daemon_config.h"
 #include "daemon_rpc.h"
+#include "instance_journal.h"
 
 #include <multipass/async_periodic_download_task.h>
 #include <multipass/delayed_shutdown_timer.h>
@@ -28,6 +29,7 @@
 #include <multipass/vm_specs.h>
 #include <multipass/vm_status_monitor.h>
 
+#include <atomic>
 #include <chrono>
 #include <future>
 #include <memory>
@@ -41,6 +43,7 @@
 namespace multipass
 {
 struct DaemonConfig;
+class PersistentSettingsHandler;
 class SettingsHandler;
 
 class Daemon : public QObject, public multipass::VMStatusMonitor
@@ -52,6 +55,9 @@ public:
 
     void persist_instances();
 
+    // Serves settings read on hot paths from copies that the handler keeps up to date
+    void follow_settings(PersistentSettingsHandler& handler);
+
 protected:
     using InstanceTable = std::unordered_map<std::string, VirtualMachine::ShPtr>;
 
@@ -232,9 +238,10 @@ private:
                    std::string&& msg,
                    bool sticky = false);
 
-    void populate_instance_info(VirtualMachine& vm,
+    // Returns whether runtime details should be collected from the instance as well
+    bool populate_instance_info(VirtualMachine& vm,
                                 InfoReply& response,
-                                bool runtime_info,
+                                bool no_runtime_info,
                                 bool deleted,
                                 bool& have_mounts);
 
@@ -244,7 +251,11 @@ private:
                        const std::string& src_name,
                        const std::string& dest_name);
 
+    void persist_instance(const std::string& name);
+    bool privileged_mounts_enabled() const;
+
     std::unique_ptr<const DaemonConfig> config;
+    InstanceJournal instance_journal;
 
 protected:
     std::unordered_map<std::string, VMSpecs> vm_instance_specs;
@@ -277,5 +288,6 @@ private:
     SettingsHandler* snapshot_mod_handler;
     std::unordered_map<std::string, std::unordered_map<std::string, MountHandler::UPtr>> mounts;
     std::unordered_set<std::string> user_authorized_bridges;
+    std::shared_ptr<const std::atomic_bool> privileged_mounts; // null until following settings
 };
 } // namespace multipass
@@ -33,6 +33,7 @@
 #include <multipass/utils.h>
 #include <multipass/utils/permission_utils.h>
 
+#include <QDir>
 #include <QString>
 #include <QSysInfo>
 #include <QUrl>
@@ -246,6 +247,9 @@ std::unique_ptr<const mp::DaemonConfig> mp::DaemonConfigBuilder::build()
         MP_PERMISSIONS.restrict_permissions(cache_directory.toStdU16String());
     }
 
+    if (trace_directory.isEmpty() && qEnvironmentVariableIsSet(trace_env_var))
+        trace_directory = QDir{data_directory}.filePath("traces");
+
     if (cert_provider == nullptr)
         cert_provider = std::make_unique<mp::SSLCertProvider>(
             MP_UTILS.make_dir(data_directory,
@@ -270,5 +274,6 @@ std::unique_ptr<const mp::DaemonConfig> mp::DaemonConfigBuilder::build()
                                                                 data_directory,
                                                                 server_address,
                                                                 ssh_username,
-                                                                image_refresh_timer});
+                                                                image_refresh_timer,
+                                                                trace_directory});
 }
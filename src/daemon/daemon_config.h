@@ -60,6 +60,7 @@ struct DaemonConfig
     const std::string server_address;
     const std::string ssh_username;
     const std::chrono::hours image_refresh_timer;
+    const multipass::Path trace_directory; // where traces of RPCs are saved, if not empty
 };
 
 struct DaemonConfigBuilder
@@ -82,6 +83,7 @@ struct DaemonConfigBuilder
     std::string ssh_username;
     multipass::days days_to_expire{14};
     std::chrono::hours image_refresh_timer{6};
+    multipass::Path trace_directory;
     multipass::logging::Level verbosity_level{multipass::logging::Level::info};
 
     std::unique_ptr<const DaemonConfig> build();
@@ -92,6 +92,47 @@ QString image_mirror_interpreter(QString val)
     return val;
 }
 
+QString suspend_format_interpreter(QString val)
+{
+    val = val.toLower();
+
+    if (val != mp::suspend_format_snapshot && val != mp::suspend_format_file)
+        throw mp::InvalidSettingException(
+            mp::suspend_format_key,
+            val,
+            QStringLiteral("Allowed formats are \"%1\" and \"%2\"")
+                .arg(mp::suspend_format_snapshot, mp::suspend_format_file));
+
+    return val;
+}
+
+QString native_mount_type_interpreter(QString val)
+{
+    val = val.toLower();
+
+    if (val != mp::native_mount_type_9p && val != mp::native_mount_type_virtiofs)
+        throw mp::InvalidSettingException(
+            mp::native_mount_type_key,
+            val,
+            QStringLiteral("Allowed types are \"%1\" and \"%2\"")
+                .arg(mp::native_mount_type_9p, mp::native_mount_type_virtiofs));
+
+    return val;
+}
+
+QString virtiofs_cache_interpreter(QString val)
+{
+    val = val.toLower();
+
+    if (val != "auto" && val != "always" && val != "never")
+        throw mp::InvalidSettingException(
+            mp::virtiofs_cache_key,
+            val,
+            QStringLiteral("Allowed modes are \"auto\", \"always\" and \"never\""));
+
+    return val;
+}
+
 } // namespace
 
 void mp::daemon::monitor_and_quit_on_settings_change() // temporary
@@ -105,7 +146,7 @@ void mp::daemon::monitor_and_quit_on_settings_change() // temporary
     });
 }
 
-void mp::daemon::register_global_settings_handlers()
+mp::PersistentSettingsHandler& mp::daemon::register_global_settings_handlers()
 {
     auto settings =
         MP_PLATFORM
@@ -121,8 +162,20 @@ void mp::daemon::register_global_settings_handlers()
     }));
     settings.insert(
         std::make_unique<CustomSettingSpec>(mp::mirror_key, "", image_mirror_interpreter));
-
-    MP_SETTINGS.register_handler(
-        std::make_unique<PersistentSettingsHandler>(persistent_settings_filename(),
-                                                    std::move(settings)));
+    settings.insert(std::make_unique<CustomSettingSpec>(mp::suspend_format_key,
+                                                        mp::suspend_format_snapshot,
+                                                        suspend_format_interpreter));
+    settings.insert(std::make_unique<CustomSettingSpec>(mp::native_mount_type_key,
+                                                        mp::native_mount_type_9p,
+                                                        native_mount_type_interpreter));
+    settings.insert(std::make_unique<CustomSettingSpec>(mp::virtiofs_cache_key,
+                                                        mp::virtiofs_cache_default,
+                                                        virtiofs_cache_interpreter));
+
+    auto handler = std::make_unique<PersistentSettingsHandler>(persistent_settings_filename(),
+                                                               std::move(settings));
+    auto& ret = *handler;
+    MP_SETTINGS.register_handler(std::move(handler));
+
+    return ret;
 }
@@ -23,6 +23,7 @@
 
 #include <multipass/auto_join_thread.h>
 #include <multipass/constants.h>
+#include <multipass/executor.h>
 #include <multipass/logging/log.h>
 #include <multipass/platform_unix.h>
 #include <multipass/signal.h>
@@ -88,7 +89,7 @@ int main_impl(int argc, char* argv[], mp::Signal& app_ready_signal)
     QCoreApplication::setApplicationName(mp::daemon_name);
     QCoreApplication::setApplicationVersion(mp::version_string);
 
-    mp::daemon::register_global_settings_handlers();
+    auto& settings_handler = mp::daemon::register_global_settings_handlers();
 
     auto builder = mp::cli::parse(app);
     auto config = builder.build();
@@ -98,6 +99,7 @@ int main_impl(int argc, char* argv[], mp::Signal& app_ready_signal)
                                                        // relevant settings handlers
 
     mp::Daemon daemon(std::move(config));
+    daemon.follow_settings(settings_handler);
     QObject::connect(&app,
                      &QCoreApplication::aboutToQuit,
                      &daemon,
@@ -116,6 +118,7 @@ int main_impl(int argc, char* argv[], mp::Signal& app_ready_signal)
     // QConcurrent::run() invocations are dispatched through the global
     // thread pool. Wait until all threads in the pool are properly cleaned up.
     QThreadPool::globalInstance()->waitForDone();
+    MP_EXECUTOR.wait_for_done();
     mpl::log(mpl::Level::info, "daemon", "Goodbye!");
     return exit_code;
 }
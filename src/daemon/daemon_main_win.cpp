@@ -134,13 +134,14 @@ int daemon_main(int argc, char* argv[], RegisterConsoleHandler register_console)
     if (register_console == RegisterConsoleHandler::yes)
         SetConsoleCtrlHandler(windows_console_ctrl_handler, TRUE);
 
-    mp::daemon::register_global_settings_handlers();
+    auto& settings_handler = mp::daemon::register_global_settings_handlers();
 
     auto builder = mp::cli::parse(app);
     auto config = builder.build();
 
     mp::daemon::monitor_and_quit_on_settings_change();
     mp::Daemon daemon(std::move(config));
+    daemon.follow_settings(settings_handler);
     QObject::connect(&app,
                      &QCoreApplication::aboutToQuit,
                      &daemon,
@@ -20,9 +20,14 @@
 
 #include <multipass/format.h>
 #include <multipass/logging/log.h>
+#include <multipass/logging/trace.h>
 #include <multipass/platform.h>
 #include <multipass/utils.h>
 
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+
 #include <chrono>
 #include <stdexcept>
 
@@ -32,6 +37,7 @@ namespace mpl = multipass::logging;
 namespace
 {
 constexpr auto category = "rpc";
+constexpr auto max_saved_traces = 100;
 
 bool check_is_server_running(const std::string& address)
 {
@@ -132,15 +138,46 @@ void accept_cert(mp::CertStore* client_cert_store,
 
     handle_socket_restrictions(server_address, false);
 }
+
+// Saves a Chrome trace, viewable in chrome://tracing or https://ui.perfetto.dev, dropping old ones
+void save_trace(const mpl::TraceRecording& recording,
+                const char* rpc_name,
+                const mp::Path& trace_directory)
+{
+    QDir dir{trace_directory};
+    const auto file_name = QString{"%1-%2.json"}.arg(
+        QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss-zzz"),
+        rpc_name);
+
+    QFile file{dir.filePath(file_name)};
+    if (!dir.mkpath(".") || !file.open(QIODevice::WriteOnly) ||
+        file.write(recording.to_chrome_trace()) == -1)
+    {
+        mpl::log(mpl::Level::warning,
+                 category,
+                 fmt::format("Could not save trace to {}: {}",
+                             file.fileName(),
+                             file.errorString()));
+        return;
+    }
+
+    mpl::log(mpl::Level::debug, category, fmt::format("Saved trace to {}", file.fileName()));
+
+    const auto traces = dir.entryInfoList({"*.json"}, QDir::Files, QDir::Time); // newest first
+    for (auto i = max_saved_traces; i < traces.size(); ++i)
+        QFile::remove(traces[i].absoluteFilePath());
+}
 } // namespace
 
 mp::DaemonRpc::DaemonRpc(const std::string& server_address,
                          const CertProvider& cert_provider,
-                         CertStore* client_cert_store)
+                         CertStore* client_cert_store,
+                         const Path& trace_directory)
     : server_address{server_address},
       server{make_server(server_address, cert_provider, this)},
       server_socket_type{server_socket_type_for(server_address)},
-      client_cert_store{client_cert_store}
+      client_cert_store{client_cert_store},
+      trace_directory{trace_directory}
 {
     handle_socket_restrictions(server_address, client_cert_store->empty());
 
@@ -160,6 +197,7 @@ grpc::Status mp::DaemonRpc::create(grpc::ServerContext* context,
     server->Read(&request);
 
     return verify_client_and_dispatch_operation(
+        __func__,
         std::bind(&DaemonRpc::on_create, this, &request, server, std::placeholders::_1),
         client_cert_from(context));
 }
@@ -171,6 +209,7 @@ grpc::Status mp::DaemonRpc::launch(grpc::ServerContext* context,
     server->Read(&request);
 
     return verify_client_and_dispatch_operation(
+        __func__,
         std::bind(&DaemonRpc::on_launch, this, &request, server, std::placeholders::_1),
         client_cert_from(context));
 }
@@ -182,6 +221,7 @@ grpc::Status mp::DaemonRpc::purge(grpc::ServerContext* context,
     server->Read(&request);
 
     return verify_client_and_dispatch_operation(
+        __func__,
         std::bind(&DaemonRpc::on_purge, this, &request, server, std::placeholders::_1),
         client_cert_from(context));
 }
@@ -193,6 +233,7 @@ grpc::Status mp::DaemonRpc::find(grpc::ServerContext* context,
     server->Read(&request);
 
     return verify_client_and_dispatch_operation(
+        __func__,
         std::bind(&DaemonRpc::on_find, this, &request, server, std::placeholders::_1),
         client_cert_from(context));
 }
@@ -204,6 +245,7 @@ grpc::Status mp::DaemonRpc::info(grpc::ServerContext* context,
     server->Read(&request);
 
     return verify_client_and_dispatch_operation(
+        __func__,
         std::bind(&DaemonRpc::on_info, this, &request, server, std::placeholders::_1),
         client_cert_from(context));
 }
@@ -215,6 +257,7 @@ grpc::Status mp::DaemonRpc::list(grpc::ServerContext* context,
     server->Read(&request);
 
     return verify_client_and_dispatch_operation(
+        __func__,
         std::bind(&DaemonRpc::on_list, this, &request, server, std::placeholders::_1),
         client_cert_from(context));
 }
@@ -229,7 +272,9 @@ grpc::Status mp::DaemonRpc::clone(grpc::ServerContext* context,
         this->on_clone(&request, server, std::forward<decltype(arg)>(arg));
     };
 
-    return verify_client_and_dispatch_operation(adapted_on_clone, client_cert_from(context));
+    return verify_client_and_dispatch_operation(__func__,
+                                                adapted_on_clone,
+                                                client_cert_from(context));
 }
 
 grpc::Status mp::DaemonRpc::networks(
@@ -240,6 +285,7 @@ grpc::Status mp::DaemonRpc::networks(
     server->Read(&request);
 
     return verify_client_and_dispatch_operation(
+        __func__,
         std::bind(&DaemonRpc::on_networks, this, &request, server, std::placeholders::_1),
         client_cert_from(context));
 }
@@ -251,6 +297,7 @@ grpc::Status mp::DaemonRpc::mount(grpc::ServerContext* context,
     server->Read(&request);
 
     return verify_client_and_dispatch_operation(
+        __func__,
         std::bind(&DaemonRpc::on_mount, this, &request, server, std::placeholders::_1),
         client_cert_from(context));
 }
@@ -262,6 +309,7 @@ grpc::Status mp::DaemonRpc::recover(grpc::ServerContext* context,
     server->Read(&request);
 
     return verify_client_and_dispatch_operation(
+        __func__,
         std::bind(&DaemonRpc::on_recover, this, &request, server, std::placeholders::_1),
         client_cert_from(context));
 }
@@ -273,6 +321,7 @@ grpc::Status mp::DaemonRpc::ssh_info(grpc::ServerContext* context,
     server->Read(&request);
 
     return verify_client_and_dispatch_operation(
+        __func__,
         std::bind(&DaemonRpc::on_ssh_info, this, &request, server, std::placeholders::_1),
         client_cert_from(context));
 }
@@ -284,6 +333,7 @@ grpc::Status mp::DaemonRpc::start(grpc::ServerContext* context,
     server->Read(&request);
 
     return verify_client_and_dispatch_operation(
+        __func__,
         std::bind(&DaemonRpc::on_start, this, &request, server, std::placeholders::_1),
         client_cert_from(context));
 }
@@ -295,6 +345,7 @@ grpc::Status mp::DaemonRpc::stop(grpc::ServerContext* context,
     server->Read(&request);
 
     return verify_client_and_dispatch_operation(
+        __func__,
         std::bind(&DaemonRpc::on_stop, this, &request, server, std::placeholders::_1),
         client_cert_from(context));
 }
@@ -306,6 +357,7 @@ grpc::Status mp::DaemonRpc::suspend(grpc::ServerContext* context,
     server->Read(&request);
 
     return verify_client_and_dispatch_operation(
+        __func__,
         std::bind(&DaemonRpc::on_suspend, this, &request, server, std::placeholders::_1),
         client_cert_from(context));
 }
@@ -317,6 +369,7 @@ grpc::Status mp::DaemonRpc::restart(grpc::ServerContext* context,
     server->Read(&request);
 
     return verify_client_and_dispatch_operation(
+        __func__,
         std::bind(&DaemonRpc::on_restart, this, &request, server, std::placeholders::_1),
         client_cert_from(context));
 }
@@ -328,6 +381,7 @@ grpc::Status mp::DaemonRpc::delet(grpc::ServerContext* context,
     server->Read(&request);
 
     return verify_client_and_dispatch_operation(
+        __func__,
         std::bind(&DaemonRpc::on_delete, this, &request, server, std::placeholders::_1),
         client_cert_from(context));
 }
@@ -339,6 +393,7 @@ grpc::Status mp::DaemonRpc::umount(grpc::ServerContext* context,
     server->Read(&request);
 
     return verify_client_and_dispatch_operation(
+        __func__,
         std::bind(&DaemonRpc::on_umount, this, &request, server, std::placeholders::_1),
         client_cert_from(context));
 }
@@ -350,6 +405,7 @@ grpc::Status mp::DaemonRpc::version(grpc::ServerContext* context,
     server->Read(&request);
 
     return verify_client_and_dispatch_operation(
+        __func__,
         std::bind(&DaemonRpc::on_version, this, &request, server, std::placeholders::_1),
         client_cert_from(context));
 }
@@ -375,6 +431,7 @@ grpc::Status mp::DaemonRpc::get(grpc::ServerContext* context,
     server->Read(&request);
 
     return verify_client_and_dispatch_operation(
+        __func__,
         std::bind(&DaemonRpc::on_get, this, &request, server, std::placeholders::_1),
         client_cert_from(context));
 }
@@ -411,6 +468,7 @@ grpc::Status mp::DaemonRpc::set(grpc::ServerContext* context,
     server->Read(&request);
 
     return verify_client_and_dispatch_operation(
+        __func__,
         std::bind(&DaemonRpc::on_set, this, &request, server, std::placeholders::_1),
         client_cert_from(context));
 }
@@ -422,6 +480,7 @@ grpc::Status mp::DaemonRpc::keys(grpc::ServerContext* context,
     server->Read(&request);
 
     return verify_client_and_dispatch_operation(
+        __func__,
         std::bind(&DaemonRpc::on_keys, this, &request, server, std::placeholders::_1),
         client_cert_from(context));
 }
@@ -434,6 +493,7 @@ grpc::Status mp::DaemonRpc::snapshot(
     server->Read(&request);
 
     return verify_client_and_dispatch_operation(
+        __func__,
         std::bind(&DaemonRpc::on_snapshot, this, &request, server, std::placeholders::_1),
         client_cert_from(context));
 }
@@ -445,6 +505,7 @@ grpc::Status mp::DaemonRpc::restore(grpc::ServerContext* context,
     server->Read(&request);
 
     return verify_client_and_dispatch_operation(
+        __func__,
         std::bind(&DaemonRpc::on_restore, this, &request, server, std::placeholders::_1),
         client_cert_from(context));
 }
@@ -457,12 +518,14 @@ grpc::Status mp::DaemonRpc::daemon_info(
     server->Read(&request);
 
     return verify_client_and_dispatch_operation(
+        __func__,
         std::bind(&DaemonRpc::on_daemon_info, this, &request, server, std::placeholders::_1),
         client_cert_from(context));
 }
 
 template <typename OperationSignal>
-grpc::Status mp::DaemonRpc::verify_client_and_dispatch_operation(OperationSignal signal,
+grpc::Status mp::DaemonRpc::verify_client_and_dispatch_operation(const char* rpc_name,
+                                                                 OperationSignal signal,
                                                                  const std::string& client_cert)
 {
     if (server_socket_type == mp::ServerSocketType::unix && client_cert_store->empty())
@@ -486,5 +549,14 @@ grpc::Status mp::DaemonRpc::verify_client_and_dispatch_operation(OperationSignal
             "(e.g. via 'multipass set local.passphrase')."};
     }
 
-    return emit_signal_and_wait_for_result(signal);
+    if (trace_directory.isEmpty())
+        return emit_signal_and_wait_for_result(signal);
+
+    mpl::TraceRecording recording{rpc_name};
+    auto status = emit_signal_and_wait_for_result(signal);
+    recording.finish();
+
+    save_trace(recording, rpc_name, trace_directory);
+
+    return status;
 }
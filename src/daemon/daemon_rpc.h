@@ -21,6 +21,7 @@
 
 #include <multipass/cert_provider.h>
 #include <multipass/disabled_copy_move.h>
+#include <multipass/path.h>
 #include <multipass/rpc/multipass.grpc.pb.h>
 
 #include <grpcpp/grpcpp.h>
@@ -53,7 +54,8 @@ class DaemonRpc : public QObject, public multipass::Rpc::Service, private Disabl
 public:
     DaemonRpc(const std::string& server_address,
               const CertProvider& cert_provider,
-              CertStore* client_cert_store);
+              CertStore* client_cert_store,
+              const Path& trace_directory = {}); // RPCs are traced when a directory is given
 
     void shutdown_and_wait();
 
@@ -136,13 +138,15 @@ signals:
 
 private:
     template <typename OperationSignal>
-    grpc::Status verify_client_and_dispatch_operation(OperationSignal signal,
+    grpc::Status verify_client_and_dispatch_operation(const char* rpc_name,
+                                                      OperationSignal signal,
                                                       const std::string& client_cert);
 
     const std::string server_address;
     const std::unique_ptr<grpc::Server> server;
     const ServerSocketType server_socket_type;
     CertStore* client_cert_store;
+    const Path trace_directory;
 
 protected:
     grpc::Status create(grpc::ServerContext* context,
@@ -24,22 +24,27 @@
 #include <multipass/file_ops.h>
 #include <multipass/json_utils.h>
 #include <multipass/logging/log.h>
+#include <multipass/logging/trace.h>
 #include <multipass/platform.h>
 #include <multipass/process/qemuimg_process_spec.h>
 #include <multipass/query.h>
 #include <multipass/rpc/multipass.grpc.pb.h>
+#include <multipass/sparse_file_writer.h>
 #include <multipass/url_downloader.h>
 #include <multipass/utils.h>
 #include <multipass/vm_image.h>
+#include <multipass/xz_image_decoder.h>
 
 #include <multipass/format.h>
 
+#include <QCryptographicHash>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QUrl>
 #include <QtConcurrent/QtConcurrent>
 
+#include <algorithm>
 #include <exception>
 
 namespace mp = multipass;
@@ -221,6 +226,17 @@ mp::MemorySize get_image_size(const mp::Path& image_path)
         throw std::runtime_error{"Could not obtain image's virtual size"};
     }
 
+    // Images are kept sparse, so they normally take up less room on disk than their virtual size
+    const auto disk_size_re = QRegularExpression{QStringLiteral("^disk size: (?<size>.+?)\r?$"),
+                                                 QRegularExpression::MultilineOption};
+    if (const auto disk_size = disk_size_re.match(img_info); disk_size.hasMatch())
+        mpl::log(mpl::Level::debug,
+                 category,
+                 fmt::format("Image {} has a virtual size of {} bytes, {} allocated on disk",
+                             image_path,
+                             image_size.in_bytes(),
+                             disk_size.captured("size")));
+
     return image_size;
 }
 
@@ -241,13 +257,15 @@ mp::DefaultVMImageVault::DefaultVMImageVault(std::vector<VMImageHost*> image_hos
                                              URLDownloader* downloader,
                                              const mp::Path& cache_dir_path,
                                              const mp::Path& data_dir_path,
-                                             const mp::days& days_to_expire)
+                                             const mp::days& days_to_expire,
+                                             bool thin_instance_images)
     : BaseVMImageVault{image_hosts},
       url_downloader{downloader},
       cache_dir{QDir(cache_dir_path).filePath("vault")},
       data_dir{QDir(data_dir_path).filePath("vault")},
       images_dir(cache_dir.filePath("images")),
       days_to_expire{days_to_expire},
+      thin_instance_images{thin_instance_images},
       prepared_image_records{load_db(cache_dir.filePath(image_db_name))},
       instance_image_records{load_db(data_dir.filePath(instance_db_name))}
 {
@@ -265,6 +283,8 @@ mp::VMImage mp::DefaultVMImageVault::fetch_image(const FetchType& fetch_type,
                                                  const std::optional<std::string>& checksum,
                                                  const mp::Path& save_dir)
 {
+    const mpl::TraceSpan span{"fetch_image"};
+
     {
         std::lock_guard<decltype(fetch_mutex)> lock{fetch_mutex};
         auto name_entry = instance_image_records.find(query.name);
@@ -369,7 +389,7 @@ mp::VMImage mp::DefaultVMImageVault::fetch_image(const FetchType& fetch_type,
                 const auto image_dir_name = QString("%1-%2").arg(
                     image_filename.section(".", 0, image_filename.endsWith(".xz") ? -3 : -2),
                     QLocale::c().toString(last_modified, "yyyyMMdd"));
-                const auto image_dir = MP_UTILS.make_dir(images_dir, image_dir_name);
+                const auto image_dir = make_image_dir(image_dir_name);
 
                 // Had to use std::bind here to workaround the 5 allowable function arguments
                 // constraint of QtConcurrent::run()
@@ -436,8 +456,7 @@ mp::VMImage mp::DefaultVMImageVault::fetch_image(const FetchType& fetch_type,
             else
             {
                 const auto image_dir =
-                    MP_UTILS.make_dir(images_dir,
-                                      QString("%1-%2").arg(info->release).arg(info->version));
+                    make_image_dir(QString("%1-%2").arg(info->release).arg(info->version));
 
                 // Had to use std::bind here to workaround the 5 allowable function arguments
                 // constraint of QtConcurrent::run()
@@ -498,6 +517,15 @@ void mp::DefaultVMImageVault::prune_expired_images()
             !record.second.query.persistent &&
             record.second.last_accessed + days_to_expire <= std::chrono::system_clock::now())
         {
+            if (is_backing_image(record.second.image))
+            {
+                mpl::log(mpl::Level::debug,
+                         category,
+                         fmt::format("Keeping expired source image {}, instances are based on it.",
+                                     record.second.query.release));
+                continue;
+            }
+
             mpl::log(mpl::Level::info,
                      category,
                      fmt::format("Source image {} is expired. Removing it from the cache.",
@@ -507,10 +535,19 @@ void mp::DefaultVMImageVault::prune_expired_images()
         }
     }
 
-    // Remove any image directories that have no corresponding database entry
+    // Remove any image directories that have no corresponding database entry, unless an instance
+    // image is an overlay on something in them
+    QStringList backing_dirs;
+    if (thin_instance_images)
+        for (const auto& record : instance_image_records)
+            for (const auto& backing_image :
+                 QemuImgProcessSpec::backing_images_of(record.second.image.image_path))
+                backing_dirs.append(QFileInfo{backing_image}.absolutePath());
+
     for (const auto& entry : images_dir.entryInfoList(QDir::AllEntries | QDir::NoDotAndDotDot))
     {
-        if (std::find_if(prepared_image_records.cbegin(),
+        if (!backing_dirs.contains(entry.absoluteFilePath()) &&
+            std::find_if(prepared_image_records.cbegin(),
                          prepared_image_records.cend(),
                          [&entry](const std::pair<std::string, VaultRecord>& record) {
                              return record.second.image.image_path.contains(
@@ -552,7 +589,11 @@ void mp::DefaultVMImageVault::update_images(const FetchType& fetch_type,
                     throw mp::ImageNotFoundException(record.second.query.release,
                                                      record.second.query.remote_name);
 
-                if (info->id.toStdString() != record.first)
+                // The latest image may already have been fetched, with this one kept for the
+                // instances based on it
+                const auto latest_id = info->id.toStdString();
+                if (latest_id != record.first &&
+                    prepared_image_records.find(latest_id) == prepared_image_records.end())
                 {
                     keys_to_update.push_back(record.first);
                 }
@@ -574,7 +615,7 @@ void mp::DefaultVMImageVault::update_images(const FetchType& fetch_type,
 
     for (const auto& key : keys_to_update)
     {
-        const auto& record = prepared_image_records[key];
+        auto& record = prepared_image_records[key];
         mpl::log(mpl::Level::info,
                  category,
                  fmt::format("Updating {} source image to latest", record.query.release));
@@ -587,8 +628,16 @@ void mp::DefaultVMImageVault::update_images(const FetchType& fetch_type,
                         std::nullopt,
                         QFileInfo{record.image.image_path}.absolutePath());
 
-            // Remove old image
+            // Remove old image, unless instances are still based on it. In that case it is kept
+            // only for them, so that new instances are launched from the latest image instead
             std::lock_guard<decltype(fetch_mutex)> lock{fetch_mutex};
+            if (is_backing_image(record.image))
+            {
+                record.image.aliases.clear();
+                persist_image_records();
+                continue;
+            }
+
             delete_image_dir(record.image.image_path);
             prepared_image_records.erase(key);
             persist_image_records();
@@ -683,28 +732,16 @@ mp::VMImage mp::DefaultVMImageVault::download_and_prepare_source_image(
         }
     }
 
+    // xz-encoded images are decoded as they arrive, so only the decoded image is written out
+    const auto xz_encoded = source_image.image_path.endsWith(".xz");
+    if (xz_encoded)
+        source_image.image_path.chop(3);
+
     mp::vault::DeleteOnException image_file{source_image.image_path};
 
     try
     {
-        url_downloader->download_to(info.image_location,
-                                    source_image.image_path,
-                                    info.size,
-                                    LaunchProgress::IMAGE,
-                                    monitor);
-
-        if (info.verify)
-        {
-            mpl::log(mpl::Level::debug, category, fmt::format("Verifying hash \"{}\"", id));
-            monitor(LaunchProgress::VERIFY, -1);
-            MP_IMAGE_VAULT_UTILS.verify_file_hash(source_image.image_path, id);
-        }
-
-        if (source_image.image_path.endsWith(".xz"))
-        {
-            source_image.image_path =
-                MP_IMAGE_VAULT_UTILS.extract_file(source_image.image_path, monitor, true);
-        }
+        download_source_image(info, source_image.image_path, xz_encoded, monitor);
 
         auto prepared_image = prepare(source_image);
         remove_source_images(source_image, prepared_image);
@@ -721,6 +758,76 @@ mp::VMImage mp::DefaultVMImageVault::download_and_prepare_source_image(
     }
 }
 
+void mp::DefaultVMImageVault::download_source_image(const VMImageInfo& info,
+                                                    const mp::Path& image_path,
+                                                    bool xz_encoded,
+                                                    const ProgressMonitor& monitor)
+{
+    const mpl::TraceSpan span{"download_source_image"};
+
+    QFile image_file{image_path};
+    if (!MP_FILEOPS.open(image_file, QIODevice::WriteOnly | QIODevice::Truncate))
+        throw std::runtime_error(fmt::format("failed to open {} for writing", image_path));
+
+    // The image is hashed and decoded in a single pass over the data, as it is downloaded
+    QCryptographicHash hash{QCryptographicHash::Sha256};
+    SparseFileWriter writer{image_file};
+    const XzImageDecoder decoder;
+    auto stream_ended = false;
+    std::exception_ptr error;
+
+    auto process_data = [&](const QByteArray& data) {
+        try
+        {
+            if (info.verify)
+                hash.addData(data);
+
+            if (!xz_encoded)
+                writer.write(data);
+            else if (!stream_ended)
+                stream_ended = !decoder.decode_chunk(data, writer);
+
+            return true;
+        }
+        catch (...)
+        {
+            // Exceptions cannot propagate through the downloader's event loop
+            error = std::current_exception();
+            return false;
+        }
+    };
+
+    try
+    {
+        url_downloader->stream_to(info.image_location,
+                                  process_data,
+                                  info.size,
+                                  LaunchProgress::IMAGE,
+                                  monitor);
+    }
+    catch (const AbortedDownloadException&)
+    {
+        if (error)
+            std::rethrow_exception(error);
+
+        throw;
+    }
+
+    if (xz_encoded && !stream_ended)
+        throw std::runtime_error("xz file is truncated");
+
+    writer.finish();
+
+    if (info.verify)
+    {
+        mpl::log(mpl::Level::debug, category, fmt::format("Verifying hash \"{}\"", info.id));
+        const QString digest = hash.result().toHex();
+        if (digest != info.id)
+            throw std::runtime_error(
+                fmt::format("Hash of {} does not match {}", info.image_location, info.id));
+    }
+}
+
 QString mp::DefaultVMImageVault::extract_image_from(const VMImage& source_image,
                                                     const ProgressMonitor& monitor,
                                                     const mp::Path& dest_dir)
@@ -746,6 +853,73 @@ mp::VMImage mp::DefaultVMImageVault::image_instance_from(const VMImage& prepared
             {}};
 }
 
+mp::VMImage mp::DefaultVMImageVault::overlay_instance_from(const VMImage& prepared_image,
+                                                           const mp::Path& dest_dir)
+{
+    MP_UTILS.make_dir(dest_dir);
+
+    const auto backing_path = QFileInfo{prepared_image.image_path}.absoluteFilePath();
+    const auto overlay_path = QDir{dest_dir}.filePath(QFileInfo{backing_path}.fileName());
+
+    QStringList qemuimg_parameters{
+        {"create", "-f", "qcow2", "-F", "qcow2", "-b", backing_path, overlay_path}};
+    auto qemuimg_process = mp::platform::make_process(
+        std::make_unique<mp::QemuImgProcessSpec>(qemuimg_parameters, backing_path, overlay_path));
+    auto process_state = qemuimg_process->execute();
+
+    if (!process_state.completed_successfully())
+        throw std::runtime_error(
+            fmt::format("Cannot create instance image: qemu-img failed ({}) with output:\n{}",
+                        process_state.failure_message(),
+                        qemuimg_process->read_all_standard_error()));
+
+    return {overlay_path,
+            prepared_image.id,
+            prepared_image.original_release,
+            prepared_image.current_release,
+            prepared_image.release_date,
+            {}};
+}
+
+bool mp::DefaultVMImageVault::is_backing_image(const VMImage& prepared_image) const
+{
+    // Instance images from before thin images were enabled are included too, to stay on the safe
+    // side
+    return thin_instance_images &&
+           std::any_of(instance_image_records.cbegin(),
+                       instance_image_records.cend(),
+                       [&prepared_image](const std::pair<std::string, VaultRecord>& record) {
+                           return record.second.query.query_type != Query::Type::LocalFile &&
+                                  record.second.image.id == prepared_image.id;
+                       });
+}
+
+bool mp::DefaultVMImageVault::holds_backing_image(const QString& dir_path) const
+{
+    return std::any_of(prepared_image_records.cbegin(),
+                       prepared_image_records.cend(),
+                       [this, &dir_path](const std::pair<std::string, VaultRecord>& record) {
+                           return QFileInfo{record.second.image.image_path}.absolutePath() ==
+                                      dir_path &&
+                                  is_backing_image(record.second.image);
+                       });
+}
+
+mp::Path mp::DefaultVMImageVault::make_image_dir(const QString& dir_name) const
+{
+    // An image that instances are based on must not be written over, nor removed if the download
+    // fails, so the download goes to a new directory if such an image is already in this one
+    const auto dir_path = [this](const QString& name) {
+        return QFileInfo{images_dir.filePath(name)}.absoluteFilePath();
+    };
+
+    auto unique_name = dir_name;
+    for (auto i = 1; holds_backing_image(dir_path(unique_name)); ++i)
+        unique_name = QString("%1.%2").arg(dir_name).arg(i);
+
+    return MP_UTILS.make_dir(images_dir, unique_name);
+}
+
 std::optional<QFuture<mp::VMImage>> mp::DefaultVMImageVault::get_image_future(const std::string& id)
 {
     auto it = in_progress_image_fetches.find(id);
@@ -766,7 +940,8 @@ mp::VMImage mp::DefaultVMImageVault::finalize_image_records(const Query& query,
 
     if (!query.name.empty())
     {
-        vm_image = image_instance_from(prepared_image, dest_dir);
+        vm_image = thin_instance_images ? overlay_instance_from(prepared_image, dest_dir)
+                                        : image_instance_from(prepared_image, dest_dir);
         instance_image_records[query.name] = {vm_image, query, std::chrono::system_clock::now()};
     }
 
@@ -48,7 +48,8 @@ public:
                         URLDownloader* downloader,
                         const multipass::Path& cache_dir_path,
                         const multipass::Path& data_dir_path,
-                        const multipass::days& days_to_expire);
+                        const multipass::days& days_to_expire,
+                        bool thin_instance_images = false);
     ~DefaultVMImageVault();
 
     VMImage fetch_image(const FetchType& fetch_type,
@@ -69,12 +70,20 @@ public:
 
 private:
     VMImage image_instance_from(const VMImage& prepared_image, const Path& dest_dir);
+    VMImage overlay_instance_from(const VMImage& prepared_image, const Path& dest_dir);
+    bool is_backing_image(const VMImage& prepared_image) const;
+    bool holds_backing_image(const QString& dir_path) const;
+    Path make_image_dir(const QString& dir_name) const;
     VMImage download_and_prepare_source_image(const VMImageInfo& info,
                                               std::optional<VMImage>& existing_source_image,
                                               const QDir& image_dir,
                                               const FetchType& fetch_type,
                                               const PrepareAction& prepare,
                                               const ProgressMonitor& monitor);
+    void download_source_image(const VMImageInfo& info,
+                               const Path& image_path,
+                               bool xz_encoded,
+                               const ProgressMonitor& monitor);
     QString extract_image_from(const VMImage& source_image,
                                const ProgressMonitor& monitor,
                                const Path& dest_dir);
@@ -91,6 +100,9 @@ private:
     const QDir data_dir;
     const QDir images_dir;
     const days days_to_expire;
+    // Whether instance images are created as qcow2 overlays on top of the cached images, rather
+    // than as full copies
+    const bool thin_instance_images;
     std::mutex fetch_mutex;
 
     std::unordered_map<std::string, VaultRecord> prepared_image_records;
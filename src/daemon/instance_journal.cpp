@@ -0,0 +1,166 @@
+/*
+ * Copyright (C) Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "instance_journal.h"
+
+#include <multipass/file_ops.h>
+#include <multipass/format.h>
+#include <multipass/logging/log.h>
+
+#include <QCryptographicHash>
+#include <QFile>
+#include <QJsonDocument>
+
+#ifdef MULTIPASS_PLATFORM_WINDOWS
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace mp = multipass;
+namespace mpl = multipass::logging;
+
+namespace
+{
+constexpr auto category = "instance journal";
+
+QByteArray digest_of(const QByteArray& db_contents)
+{
+    return QCryptographicHash::hash(db_contents, QCryptographicHash::Sha256).toHex();
+}
+
+bool sync_to_disk(QFile& file)
+{
+#ifdef MULTIPASS_PLATFORM_WINDOWS
+    return _commit(file.handle()) == 0;
+#else
+    return ::fsync(file.handle()) == 0;
+#endif
+}
+} // namespace
+
+mp::InstanceJournal::InstanceJournal(const QString& file_path, int max_entries)
+    : file_path{file_path}, max_entries{max_entries}
+{
+}
+
+QJsonObject mp::InstanceJournal::replay(const QByteArray& db_contents, QJsonObject records)
+{
+    std::lock_guard lock{mutex};
+
+    db_digest = digest_of(db_contents);
+    num_entries = 0;
+
+    QFile file{file_path};
+    if (!MP_FILEOPS.exists(file) || !MP_FILEOPS.open(file, QIODevice::ReadOnly))
+        return records;
+
+    const auto contents = MP_FILEOPS.read_all(file);
+    const auto lines = contents.split('\n');
+    if (lines.first() != db_digest)
+    {
+        mpl::log(mpl::Level::debug, category, "Ignoring journal of a previous instance database");
+        file.close();
+        MP_FILEOPS.remove(file);
+        return records;
+    }
+
+    qint64 good_size = lines.first().size() + 1; // up to the end of the last complete line
+    for (auto it = std::next(lines.cbegin()); it != lines.cend(); ++it)
+    {
+        const auto last = std::next(it) == lines.cend(); // not terminated by a newline
+        if (last && it->isEmpty())
+            break;
+
+        const auto entry = QJsonDocument::fromJson(*it);
+        if (last || !entry.isObject())
+        {
+            // Only the last entry can be incomplete, if the daemon stopped while logging it
+            mpl::log(mpl::Level::warning, category, "Ignoring incomplete instance journal entry");
+            break;
+        }
+
+        const auto object = entry.object();
+        for (auto record = object.constBegin(); record != object.constEnd(); ++record)
+            records.insert(record.key(), record.value());
+
+        good_size += it->size() + 1;
+        ++num_entries;
+    }
+
+    file.close();
+    if (good_size < contents.size() && !MP_FILEOPS.resize(file, good_size))
+    {
+        // New entries must not follow the broken one, or they would be ignored along with it
+        mpl::log(mpl::Level::warning,
+                 category,
+                 fmt::format("Could not drop incomplete entry from {}: {}",
+                             file_path,
+                             file.errorString()));
+        num_entries = max_entries; // so that the next change rewrites the database instead
+    }
+
+    mpl::log(mpl::Level::debug,
+             category,
+             fmt::format("Replayed {} instance journal entries", num_entries));
+
+    return records;
+}
+
+bool mp::InstanceJournal::append(const QString& instance_name, const QJsonObject& record)
+{
+    std::lock_guard lock{mutex};
+
+    // Without a database to refer to, or with too many entries to replay, rewrite the database
+    if (db_digest.isEmpty() || num_entries >= max_entries)
+        return false;
+
+    QFile file{file_path};
+    const auto mode = num_entries ? QIODevice::Append : QIODevice::WriteOnly | QIODevice::Truncate;
+    if (!MP_FILEOPS.open(file, mode))
+        return false;
+
+    QByteArray data = num_entries ? QByteArray{} : db_digest + '\n';
+    data += QJsonDocument{QJsonObject{{instance_name, record}}}.toJson(QJsonDocument::Compact);
+    data += '\n';
+
+    if (MP_FILEOPS.write(file, data) != data.size() || !MP_FILEOPS.flush(file) ||
+        !sync_to_disk(file))
+    {
+        mpl::log(mpl::Level::warning,
+                 category,
+                 fmt::format("Could not log instance record to {}: {}",
+                             file_path,
+                             file.errorString()));
+        return false;
+    }
+
+    ++num_entries;
+    return true;
+}
+
+void mp::InstanceJournal::reset(const QByteArray& db_contents)
+{
+    std::lock_guard lock{mutex};
+
+    db_digest = digest_of(db_contents);
+    num_entries = 0;
+
+    QFile file{file_path};
+    if (MP_FILEOPS.exists(file))
+        MP_FILEOPS.remove(file);
+}
@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <QByteArray>
+#include <QJsonObject>
+#include <QString>
+
+#include <mutex>
+
+namespace multipass
+{
+// Append-only log of instance records, kept next to the instance database so that a change to a
+// single instance does not require rewriting the whole database. Each entry holds the latest record
+// of one instance. The first line identifies the database contents that the entries apply to, so
+// that a log left behind by an interrupted rewrite of the database is not replayed over it.
+class InstanceJournal
+{
+public:
+    explicit InstanceJournal(const QString& file_path, int max_entries = 256);
+
+    // Returns the records brought up to date with the entries logged after db_contents was written
+    QJsonObject replay(const QByteArray& db_contents, QJsonObject records);
+
+    // Returns false when the entry could not be logged, or when the log has grown enough that the
+    // database should be rewritten instead
+    bool append(const QString& instance_name, const QJsonObject& record);
+
+    // Discards all entries, to follow the database that was just written with db_contents
+    void reset(const QByteArray& db_contents);
+
+private:
+    const QString file_path;
+    const int max_entries;
+    QByteArray db_digest;
+    int num_entries{0};
+    std::mutex mutex;
+};
+} // namespace multipass
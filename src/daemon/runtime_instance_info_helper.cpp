@@ -87,6 +87,9 @@ void mp::RuntimeInstanceInfoHelper::populate_runtime_info(mp::VirtualMachine& vm
                                                           const std::string& original_release,
                                                           bool parallelize)
 {
+    // Gathered on demand, rather than streamed by a reporter that would keep every instance busy
+    // whether or not anyone asks. ssh_exec runs this on a channel of the instance's persistent
+    // session, so it costs no SSH handshake and does not hold up other commands to the instance.
     const auto& cmd = parallelize ? Cmds::parallel_composite_cmd : Cmds::sequential_composite_cmd;
     auto results = YAML::Load(vm.ssh_exec(cmd, /* whisper = */ true));
 
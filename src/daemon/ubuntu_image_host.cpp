@@ -33,6 +33,7 @@
 #include <QUrl>
 
 #include <algorithm>
+#include <functional>
 #include <unordered_set>
 
 namespace mp = multipass;
@@ -70,6 +71,21 @@ mp::VMImageInfo with_location_fully_resolved(const QString& host_url, const mp::
             info.verify};
 }
 
+// Returns the products whose hash starts with the given prefix, in the order of the manifest
+std::vector<const mp::VMImageInfo*> products_matching(const QString& hash_prefix,
+                                                      const mp::SimpleStreamsManifest& manifest)
+{
+    std::vector<const mp::VMImageInfo*> matches;
+    for (auto it = manifest.images_by_id.lowerBound(hash_prefix);
+         it != manifest.images_by_id.cend() && it.key().startsWith(hash_prefix);
+         ++it)
+        matches.push_back(it.value());
+
+    // Products are stored contiguously, so their addresses follow the order of the manifest
+    std::sort(matches.begin(), matches.end(), std::less<const mp::VMImageInfo*>{});
+    return matches;
+}
+
 auto key_from(const std::string& search_string)
 {
     auto key = QString::fromStdString(search_string);
@@ -144,18 +160,17 @@ std::vector<std::pair<std::string, mp::VMImageInfo>> mp::UbuntuVMImageHost::all_
         {
             std::unordered_set<std::string> found_hashes;
 
-            for (const auto& entry : manifest->products)
+            for (const auto* entry : products_matching(key, *manifest))
             {
-                if (entry.id.startsWith(key) && remote.admits_image(entry) &&
-                    (entry.supported || query.allow_unsupported) &&
-                    found_hashes.find(entry.id.toStdString()) == found_hashes.end())
+                if (remote.admits_image(*entry) && (entry->supported || query.allow_unsupported) &&
+                    found_hashes.find(entry->id.toStdString()) == found_hashes.end())
                 {
                     images.push_back(
                         std::make_pair(remote_name,
                                        with_location_fully_resolved(
                                            QString::fromStdString(remote_url_from(remote_name)),
-                                           entry)));
-                    found_hashes.insert(entry.id.toStdString());
+                                           *entry)));
+                    found_hashes.insert(entry->id.toStdString());
                 }
             }
         }
@@ -166,16 +181,17 @@ std::vector<std::pair<std::string, mp::VMImageInfo>> mp::UbuntuVMImageHost::all_
 
 mp::VMImageInfo mp::UbuntuVMImageHost::info_for_full_hash_impl(const std::string& full_hash)
 {
+    const auto hash = QString::fromStdString(full_hash);
     for (const auto& manifest : manifests)
     {
-        for (const auto& product : manifest.second->products)
+        const auto [first, last] = manifest.second->images_by_id.equal_range(hash);
+        if (first != last)
         {
-            if (product.id.toStdString() == full_hash)
-            {
-                return with_location_fully_resolved(
-                    QString::fromStdString(remote_url_from(manifest.first)),
-                    product);
-            }
+            // The earliest product in the manifest takes precedence
+            const auto product = *std::min_element(first, last, std::less<const VMImageInfo*>{});
+            return with_location_fully_resolved(
+                QString::fromStdString(remote_url_from(manifest.first)),
+                *product);
         }
     }
 
@@ -20,6 +20,7 @@
 #include <multipass/cloud_init_iso.h>
 #include <multipass/file_ops.h>
 #include <multipass/format.h>
+#include <multipass/logging/trace.h>
 #include <multipass/yaml_node_utils.h>
 
 #include <array>
@@ -27,6 +28,7 @@
 #include <stdexcept>
 
 namespace mp = multipass;
+namespace mpl = multipass::logging;
 namespace mpu = multipass::utils;
 
 // ISO9660 + Joliet Extension format
@@ -543,6 +545,8 @@ bool mp::CloudInitIso::erase(const std::string& name)
 
 void mp::CloudInitIso::write_to(const std::filesystem::path& path)
 {
+    const mpl::TraceSpan span{"write_cloud_init_iso"};
+
     std::ofstream f{path, std::ios::binary | std::ios::out};
     if (!f.is_open())
         throw std::runtime_error{
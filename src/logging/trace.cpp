@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <multipass/logging/trace.h>
+
+#include <QCoreApplication>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <unordered_map>
+
+namespace mpl = multipass::logging;
+
+namespace
+{
+std::atomic<int> live_recordings{0};
+std::mutex recordings_mutex;
+std::vector<mpl::TraceRecording*> recordings;
+
+std::uint64_t current_thread()
+{
+    return std::hash<std::thread::id>{}(std::this_thread::get_id());
+}
+
+double in_microseconds(std::chrono::steady_clock::duration duration)
+{
+    return std::chrono::duration<double, std::micro>{duration}.count();
+}
+} // namespace
+
+mpl::TraceRecording::TraceRecording(std::string name)
+    : name{std::move(name)}, start{std::chrono::steady_clock::now()}, thread{current_thread()}
+{
+    std::lock_guard lock{recordings_mutex};
+    recordings.push_back(this);
+    ++live_recordings;
+}
+
+mpl::TraceRecording::~TraceRecording()
+{
+    finish();
+}
+
+void mpl::TraceRecording::add(TraceEvent event)
+{
+    std::lock_guard lock{mutex};
+    if (!finished && event.start >= start) // spans that started earlier belong to something else
+        recorded_events.push_back(std::move(event));
+}
+
+void mpl::TraceRecording::finish()
+{
+    {
+        std::lock_guard lock{recordings_mutex};
+        if (auto it = std::find(recordings.begin(), recordings.end(), this); it != recordings.end())
+        {
+            recordings.erase(it);
+            --live_recordings;
+        }
+    }
+
+    std::lock_guard lock{mutex};
+    if (!finished)
+    {
+        recorded_events.push_back({name, start, std::chrono::steady_clock::now() - start, thread});
+        finished = true;
+    }
+}
+
+std::vector<mpl::TraceEvent> mpl::TraceRecording::events() const
+{
+    std::lock_guard lock{mutex};
+    return recorded_events;
+}
+
+QByteArray mpl::TraceRecording::to_chrome_trace() const
+{
+    auto sorted_events = events();
+
+    // Enclosing spans go first, so that viewers nest the ones starting at the same time correctly
+    std::sort(sorted_events.begin(), sorted_events.end(), [](const auto& a, const auto& b) {
+        return a.start != b.start ? a.start < b.start : a.duration > b.duration;
+    });
+
+    const auto pid = QCoreApplication::applicationPid();
+    std::unordered_map<std::uint64_t, int> thread_numbers; // viewers expect small thread IDs
+    QJsonArray trace_events;
+    for (const auto& event : sorted_events)
+    {
+        const auto [it, _] =
+            thread_numbers.emplace(event.thread, static_cast<int>(thread_numbers.size()) + 1);
+
+        trace_events.append(QJsonObject{{"name", QString::fromStdString(event.name)},
+                                        {"cat", "multipass"},
+                                        {"ph", "X"}, // a complete event, with its duration
+                                        {"ts", in_microseconds(event.start - start)},
+                                        {"dur", in_microseconds(event.duration)},
+                                        {"pid", pid},
+                                        {"tid", it->second}});
+    }
+
+    return QJsonDocument{QJsonObject{{"traceEvents", trace_events}, {"displayTimeUnit", "ms"}}}
+        .toJson(QJsonDocument::Compact);
+}
+
+mpl::TraceSpan::TraceSpan(std::string_view name)
+{
+    if (live_recordings.load(std::memory_order_relaxed) > 0)
+    {
+        this->name = name;
+        start = std::chrono::steady_clock::now();
+    }
+}
+
+mpl::TraceSpan::~TraceSpan()
+{
+    if (!start)
+        return;
+
+    const auto duration = std::chrono::steady_clock::now() - *start;
+    const TraceEvent event{name, *start, duration, current_thread()};
+
+    std::lock_guard lock{recordings_mutex};
+    for (auto recording : recordings)
+        recording->add(event);
+}
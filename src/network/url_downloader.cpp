@@ -251,12 +251,41 @@ void mp::URLDownloader::download_to(const QUrl& url,
                                     const int download_type,
                                     const mp::ProgressMonitor& monitor)
 {
-    std::atomic_bool abort_download{false};
-    auto manager{MP_NETMGRFACTORY.make_network_manager(cache_dir_path)};
-
     QFile file{file_name};
     file.open(QIODevice::ReadWrite | QIODevice::Truncate);
 
+    auto write_to_file = [&file](const QByteArray& data) {
+        if (MP_FILEOPS.write(file, data) < 0)
+        {
+            mpl::log(mpl::Level::error,
+                     category,
+                     fmt::format("error writing image: {}", file.errorString()));
+            return false;
+        }
+
+        return true;
+    };
+
+    try
+    {
+        URLDownloader::stream_to(url, write_to_file, size, download_type, monitor);
+    }
+    catch (...)
+    {
+        file.remove();
+        throw;
+    }
+}
+
+void mp::URLDownloader::stream_to(const QUrl& url,
+                                  const DataHandler& on_data,
+                                  int64_t size,
+                                  const int download_type,
+                                  const mp::ProgressMonitor& monitor)
+{
+    std::atomic_bool abort_download{false};
+    auto manager{MP_NETMGRFACTORY.make_network_manager(cache_dir_path)};
+
     auto progress_monitor = [this, &abort_download, &monitor, download_type, size](
                                 QNetworkReply* reply,
                                 qint64 bytes_received,
@@ -280,8 +309,8 @@ void mp::URLDownloader::download_to(const QUrl& url,
         }
     };
 
-    auto on_download = [this, &abort_download, &file](QNetworkReply* reply,
-                                                      QTimer& download_timeout) {
+    auto on_download = [this, &abort_download, &on_data](QNetworkReply* reply,
+                                                         QTimer& download_timeout) {
         abort_download = abort_download || abort_downloads;
 
         if (abort_download)
@@ -295,25 +324,20 @@ void mp::URLDownloader::download_to(const QUrl& url,
         else
             return;
 
-        if (MP_FILEOPS.write(file, reply->readAll()) < 0)
+        if (!on_data(reply->readAll()))
         {
-            mpl::log(mpl::Level::error,
-                     category,
-                     fmt::format("error writing image: {}", file.errorString()));
             abort_download = true;
             reply->abort();
         }
         download_timeout.start();
     };
 
-    auto on_error = [&file]() { file.remove(); };
-
     ::download(manager.get(),
                timeout,
                url,
                progress_monitor,
                on_download,
-               on_error,
+               [] {},
                abort_download);
 }
 
@@ -387,7 +387,10 @@ void mp::HyperVVirtualMachine::shutdown(ShutdownPolicy shutdown_policy)
         state_wait.wait(lock, [this] { return shutdown_while_starting; });
     }
 
-    ip = std::nullopt;
+    {
+        std::lock_guard<std::mutex> ip_lock{management_ip_mutex};
+        ip = std::nullopt;
+    }
     update_state();
 }
 
@@ -455,16 +458,22 @@ std::string mp::HyperVVirtualMachine::ssh_username()
 
 std::string mp::HyperVVirtualMachine::management_ipv4()
 {
-    if (!ip)
     {
-        // Not using cached SSH session for this because a) the underlying functions do not
-        // guarantee constness; b) we endure the penalty of creating a new session only when we
-        // don't have the IP yet.
-        auto result =
-            remote_ip(VirtualMachine::ssh_hostname(), ssh_port(), ssh_username(), key_provider);
-        if (result)
-            ip.emplace(result.value());
+        std::lock_guard<std::mutex> lock{management_ip_mutex};
+        if (ip)
+            return ip.value().as_string();
     }
+
+    // Not using cached SSH session for this because a) the underlying functions do not
+    // guarantee constness; b) we endure the penalty of creating a new session only when we
+    // don't have the IP yet. The lookup runs unlocked, not to hold up others meanwhile.
+    auto result =
+        remote_ip(VirtualMachine::ssh_hostname(), ssh_port(), ssh_username(), key_provider);
+
+    std::lock_guard<std::mutex> lock{management_ip_mutex};
+    if (result && !ip)
+        ip.emplace(result.value());
+
     return ip ? ip.value().as_string() : "UNKNOWN";
 }
 
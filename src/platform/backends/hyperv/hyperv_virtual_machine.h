@@ -95,7 +95,7 @@ private:
 
     VirtualMachineDescription desc; // TODO we should probably keep this in the base class instead
     const QString name;
-    std::optional<multipass::IPAddress> ip;
+    std::optional<multipass::IPAddress> ip; // guarded by management_ip_mutex
     std::unique_ptr<PowerShell> power_shell;
     VMStatusMonitor* monitor;
     bool update_suspend_status{true};
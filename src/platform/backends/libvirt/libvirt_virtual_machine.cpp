@@ -293,9 +293,11 @@ void update_max_and_property(virDomainPtr domain_ptr,
 }
 
 std::string management_ipv4_impl(std::optional<mp::IPAddress>& management_ip,
+                                 std::mutex& management_ip_mutex,
                                  const std::string& mac_addr,
                                  const mp::LibvirtWrapper::UPtr& libvirt_wrapper)
 {
+    std::lock_guard<std::mutex> lock{management_ip_mutex};
     if (!management_ip)
     {
         auto result = instance_ip_for(mac_addr, libvirt_wrapper);
@@ -518,7 +520,7 @@ std::string mp::LibVirtVirtualMachine::ssh_username()
 
 std::string mp::LibVirtVirtualMachine::management_ipv4()
 {
-    return management_ipv4_impl(management_ip, mac_addr, libvirt_wrapper);
+    return management_ipv4_impl(management_ip, management_ip_mutex, mac_addr, libvirt_wrapper);
 }
 
 std::string mp::LibVirtVirtualMachine::ipv6()
@@ -544,7 +546,8 @@ mp::LibVirtVirtualMachine::DomainUPtr mp::LibVirtVirtualMachine::initialize_doma
     if (mac_addr.empty())
         mac_addr = instance_mac_addr_for(domain.get(), libvirt_wrapper);
 
-    management_ipv4_impl(management_ip, mac_addr, libvirt_wrapper); // To set the IP.
+    // To set the IP
+    management_ipv4_impl(management_ip, management_ip_mutex, mac_addr, libvirt_wrapper);
     state = refresh_instance_state_for_domain(domain.get(), state, libvirt_wrapper);
 
     return domain;
@@ -400,6 +400,7 @@ std::string mp::LXDVirtualMachine::ssh_username()
 
 std::string mp::LXDVirtualMachine::management_ipv4()
 {
+    std::lock_guard<std::mutex> lock{management_ip_mutex};
     if (!management_ip)
     {
         management_ip = get_ip_for(mac_addr, manager, network_leases_url());
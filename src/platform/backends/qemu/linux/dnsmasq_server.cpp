@@ -28,12 +28,20 @@
 
 #include <fstream>
 
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
 namespace mp = multipass;
 namespace mpl = multipass::logging;
 
 namespace
 {
 constexpr auto immediate_wait = 100; // period to wait for immediate dnsmasq failures, in ms
+constexpr auto leases_filename = "dnsmasq.leases";
 
 auto make_dnsmasq_process(const mp::Path& data_dir,
                           const QString& bridge_name,
@@ -63,6 +71,8 @@ mp::DNSMasqServer::DNSMasqServer(const Path& data_dir,
         dnsmasq_hosts.open(QIODevice::WriteOnly);
     }
 
+    watch_leases();
+
     dnsmasq_cmd = make_dnsmasq_process(data_dir, bridge_name, subnet, conf_file.fileName());
     start_dnsmasq();
 }
@@ -85,25 +95,146 @@ mp::DNSMasqServer::~DNSMasqServer()
                 mpl::log(mpl::Level::warning, "dnsmasq", "failed to kill");
         }
     }
+
+    if (inotify_fd != -1)
+        ::close(inotify_fd);
 }
 
 std::optional<mp::IPAddress> mp::DNSMasqServer::get_ip_for(const std::string& hw_addr)
 {
+    std::lock_guard<std::mutex> lock{leases_mutex};
+    refresh_leases();
+
+    if (auto it = leases.find(hw_addr); it != leases.end())
+        return it->second;
+
+    return std::nullopt;
+}
+
+std::optional<mp::IPAddress> mp::DNSMasqServer::wait_for_ip_for(const std::string& hw_addr,
+                                                                 std::chrono::milliseconds timeout)
+{
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+
+    std::unique_lock<std::mutex> lock{leases_mutex};
+    while (true)
+    {
+        refresh_leases();
+        if (auto it = leases.find(hw_addr); it != leases.end())
+            return it->second;
+
+        const auto now = std::chrono::steady_clock::now();
+        if (now >= deadline)
+            return std::nullopt;
+
+        if (waiting_on_leases) // let whoever is waiting on inotify wake us up
+        {
+            leases_cv.wait_until(lock, deadline);
+            continue;
+        }
+
+        const auto remaining = std::chrono::ceil<std::chrono::milliseconds>(deadline - now);
+        waiting_on_leases = true;
+        lock.unlock();
+
+        if (inotify_fd == -1)
+            MP_UTILS.sleep_for(remaining);
+        else
+        {
+            pollfd leases_watch{inotify_fd, POLLIN, 0};
+            ::poll(&leases_watch, 1, static_cast<int>(remaining.count()));
+        }
+
+        lock.lock();
+        waiting_on_leases = false;
+        leases_cv.notify_all();
+    }
+}
+
+void mp::DNSMasqServer::watch_leases()
+{
+    inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd != -1 &&
+        inotify_add_watch(inotify_fd,
+                          qPrintable(data_dir),
+                          IN_MODIFY | IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_TO |
+                              IN_MOVED_FROM | IN_ONLYDIR) != -1)
+        return;
+
+    mpl::log(mpl::Level::warning,
+             "dnsmasq",
+             fmt::format("Cannot watch for DHCP leases, reading them on every lookup: {}",
+                         std::strerror(errno)));
+
+    if (inotify_fd != -1)
+        ::close(inotify_fd);
+    inotify_fd = -1;
+}
+
+void mp::DNSMasqServer::refresh_leases()
+{
+    // Events are left alone while someone is blocked on them, so that they are sure to wake up
+    if (inotify_fd == -1 || (waiting_on_leases ? lease_events_pending() : consume_lease_events()))
+        leases_stale = true;
+
+    if (!leases_stale)
+        return;
+
     // DNSMasq leases entries consist of:
     // <lease expiration> <mac addr> <ipv4> <name> * * *
-    const auto path = QDir(data_dir).filePath("dnsmasq.leases").toStdString();
+    const auto path = QDir(data_dir).filePath(leases_filename).toStdString();
     const std::string delimiter{" "};
     const int hw_addr_idx{1};
     const int ipv4_idx{2};
     std::ifstream leases_file{path};
     std::string line;
+
+    leases.clear();
     while (getline(leases_file, line))
     {
         const auto fields = mp::utils::split(line, delimiter);
-        if (fields.size() > 2 && fields[hw_addr_idx] == hw_addr)
-            return fields[ipv4_idx];
+        if (fields.size() > 2)
+        {
+            try
+            {
+                leases.emplace(fields[hw_addr_idx], fields[ipv4_idx]); // the first one wins
+            }
+            catch (const std::invalid_argument&)
+            {
+                // not an IPv4 lease
+            }
+        }
     }
-    return std::nullopt;
+
+    leases_stale = false;
+}
+
+bool mp::DNSMasqServer::consume_lease_events()
+{
+    auto leases_changed = false;
+
+    alignas(inotify_event) char buffer[4 * 1024];
+    ssize_t len;
+    while ((len = ::read(inotify_fd, buffer, sizeof(buffer))) > 0)
+    {
+        for (auto ptr = buffer; ptr < buffer + len;)
+        {
+            const auto event = reinterpret_cast<const inotify_event*>(ptr);
+            ptr += sizeof(inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW ||
+                (event->len && std::strcmp(event->name, leases_filename) == 0))
+                leases_changed = true;
+        }
+    }
+
+    return leases_changed;
+}
+
+bool mp::DNSMasqServer::lease_events_pending() const
+{
+    pollfd leases_watch{inotify_fd, POLLIN, 0};
+    return ::poll(&leases_watch, 1, 0) > 0;
 }
 
 void mp::DNSMasqServer::release_mac(const std::string& hw_addr)
@@ -24,9 +24,13 @@
 
 #include <QTemporaryFile>
 
+#include <chrono>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <string>
+#include <unordered_map>
 
 namespace multipass
 {
@@ -41,6 +45,9 @@ public:
     virtual ~DNSMasqServer(); // inherited by mock for testing
 
     virtual std::optional<IPAddress> get_ip_for(const std::string& hw_addr);
+    // like get_ip_for, but waiting up to timeout for the address to be leased
+    virtual std::optional<IPAddress> wait_for_ip_for(const std::string& hw_addr,
+                                                     std::chrono::milliseconds timeout);
     virtual void release_mac(const std::string& hw_addr);
     virtual void check_dnsmasq_running();
 
@@ -49,6 +56,10 @@ protected:
 
 private:
     void start_dnsmasq();
+    void watch_leases();
+    void refresh_leases(); // requires leases_mutex
+    bool consume_lease_events();
+    bool lease_events_pending() const;
 
     const QString data_dir;
     const QString bridge_name;
@@ -56,6 +67,15 @@ private:
     std::unique_ptr<Process> dnsmasq_cmd;
     QMetaObject::Connection finish_connection;
     QTemporaryFile conf_file;
+
+    /* Leases are indexed by MAC address and only parsed again when inotify tells us that dnsmasq
+       updated them. Without inotify, they are parsed on every lookup, as there is no telling. */
+    std::unordered_map<std::string, IPAddress> leases;
+    bool leases_stale{true};
+    int inotify_fd{-1};
+    bool waiting_on_leases{false}; // someone is blocked on inotify_fd
+    std::mutex leases_mutex;
+    std::condition_variable leases_cv;
 };
 
 #define MP_DNSMASQ_SERVER_FACTORY multipass::DNSMasqServerFactory::instance()
@@ -37,6 +37,8 @@ public:
     virtual ~QemuPlatformDetail();
 
     std::optional<IPAddress> get_ip_for(const std::string& hw_addr) override;
+    std::optional<IPAddress> wait_for_ip_for(const std::string& hw_addr,
+                                             std::chrono::milliseconds timeout) override;
     void remove_resources_for(const std::string& name) override;
     void platform_health_check() override;
     QStringList vm_platform_args(const VirtualMachineDescription& vm_desc) override;
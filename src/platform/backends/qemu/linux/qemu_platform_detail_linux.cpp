@@ -147,6 +147,13 @@ std::optional<mp::IPAddress> mp::QemuPlatformDetail::get_ip_for(const std::strin
     return dnsmasq_server->get_ip_for(hw_addr);
 }
 
+std::optional<mp::IPAddress> mp::QemuPlatformDetail::wait_for_ip_for(
+    const std::string& hw_addr,
+    std::chrono::milliseconds timeout)
+{
+    return dnsmasq_server->wait_for_ip_for(hw_addr, timeout);
+}
+
 void mp::QemuPlatformDetail::remove_resources_for(const std::string& name)
 {
     auto it = name_to_net_device_map.find(name);
@@ -16,11 +16,18 @@
  */
 
 #include "qemu_mount_handler.h"
+#include "virtiofsd_process_spec.h"
 
+#include <multipass/constants.h>
+#include <multipass/file_ops.h>
+#include <multipass/platform.h>
 #include <multipass/utils.h>
 
+#include <QFile>
 #include <QUuid>
 
+#include <thread>
+
 namespace mp = multipass;
 namespace mpl = multipass::logging;
 namespace mpu = multipass::utils;
@@ -28,6 +35,10 @@ namespace mpu = multipass::utils;
 namespace
 {
 constexpr auto category = "qemu-mount-handler";
+constexpr auto virtiofs_device = "vhost-user-fs-pci";
+constexpr auto virtiofsd_timeout = std::chrono::seconds{10};
+constexpr auto virtiofsd_timeout_ms =
+    std::chrono::duration_cast<std::chrono::milliseconds>(virtiofsd_timeout).count();
 } // namespace
 
 namespace multipass
@@ -35,16 +46,22 @@ namespace multipass
 QemuMountHandler::QemuMountHandler(QemuVirtualMachine* vm,
                                    const SSHKeyProvider* ssh_key_provider,
                                    const std::string& target,
-                                   VMMount mount_spec)
+                                   VMMount mount_spec,
+                                   std::optional<VirtiofsOptions> virtiofs)
     : MountHandler{vm, ssh_key_provider, std::move(mount_spec), target},
       vm_mount_args{vm->modifiable_mount_args()},
       // Create a reproducible unique mount tag for each mount. The cmd arg can only be 31 bytes
       // long so part of the uuid must be truncated. First character of tag must also be
       // alphabetical.
-      tag{mp::utils::make_uuid(target).remove("-").left(30).prepend('m').toStdString()}
+      tag{mp::utils::make_uuid(target).remove("-").left(30).prepend('m').toStdString()},
+      uses_virtiofs{virtiofs.has_value()},
+      // Unix socket paths are limited to 108 bytes, so keep the name short
+      virtiofs_socket{vm->instance_directory().filePath(
+          QString{"virtiofs-%1.sock"}.arg(QString::fromStdString(tag.substr(1, 8))))}
 {
     auto state = vm->current_state();
-    if (state == VirtualMachine::State::suspended && vm_mount_args.find(tag) != vm_mount_args.end())
+    if (const auto it = vm_mount_args.find(tag);
+        state == VirtualMachine::State::suspended && it != vm_mount_args.end())
     {
         mpl::log(mpl::Level::info,
                  category,
@@ -52,6 +69,12 @@ QemuMountHandler::QemuMountHandler(QemuVirtualMachine* vm,
                              source,
                              target,
                              vm->vm_name));
+
+        // The instance resumes with the devices it was suspended with, whatever the settings now
+        uses_virtiofs = !it->second.second.filter(QString{virtiofs_device}).isEmpty();
+        if (uses_virtiofs)
+            add_virtiofs_helper(vm, virtiofs.value_or(VirtiofsOptions{virtiofs_cache_default}));
+
         return;
     }
 
@@ -70,6 +93,20 @@ QemuMountHandler::QemuMountHandler(QemuVirtualMachine* vm,
         category,
         fmt::format("initializing native mount {} => {} in '{}'", source, target, vm->vm_name));
 
+    // With virtiofs, QEMU only relays requests to virtiofsd, which applies the ID mappings
+    if (uses_virtiofs)
+    {
+        vm_mount_args[tag] = {
+            source,
+            {"-chardev",
+             QString::fromStdString(fmt::format("socket,id={},path={}", tag, virtiofs_socket)),
+             "-device",
+             QString::fromStdString(
+                 fmt::format("{},queue-size=1024,chardev={},tag={}", virtiofs_device, tag, tag))}};
+        add_virtiofs_helper(vm, *virtiofs);
+        return;
+    }
+
     const auto uid_map = this->mount_spec.get_uid_mappings().empty()
                              ? std::make_pair(1000, 1000)
                              : this->mount_spec.get_uid_mappings()[0];
@@ -97,14 +134,15 @@ try
 {
     return active &&
            !SSHSession{vm->ssh_hostname(), vm->ssh_port(), vm->ssh_username(), *ssh_key_provider}
-                .exec(fmt::format("findmnt --type 9p | grep '{} {}'", target, tag))
+                .exec(fmt::format("findmnt --type {} | grep '{} {}'", fs_type(), target, tag))
                 .exit_code();
 }
 catch (const std::exception& e)
 {
     mpl::log(mpl::Level::warning,
              category,
-             fmt::format("Failed checking 9p mount \"{}\" in instance '{}': {}",
+             fmt::format("Failed checking {} mount \"{}\" in instance '{}': {}",
+                         fs_type(),
                          target,
                          vm->vm_name,
                          e.what()));
@@ -135,11 +173,15 @@ void QemuMountHandler::activate_impl(ServerVariant, std::chrono::milliseconds)
         mpu::set_owner_for(session, leading, missing, default_uid, default_gid);
     }
 
-    MP_UTILS.run_in_ssh_session(
-        session,
-        fmt::format("sudo mount -t 9p {} {} -o trans=virtio,version=9p2000.L,msize=536870912",
-                    tag,
-                    target));
+    if (uses_virtiofs)
+        MP_UTILS.run_in_ssh_session(session,
+                                    fmt::format("sudo mount -t virtiofs {} {}", tag, target));
+    else
+        MP_UTILS.run_in_ssh_session(
+            session,
+            fmt::format("sudo mount -t 9p {} {} -o trans=virtio,version=9p2000.L,msize=536870912",
+                        tag,
+                        target));
 }
 
 void QemuMountHandler::deactivate_impl(bool force)
@@ -169,5 +211,57 @@ QemuMountHandler::~QemuMountHandler()
 {
     deactivate(/*force=*/true);
     vm_mount_args.erase(tag);
+
+    if (vm_mount_helpers)
+        vm_mount_helpers->erase(tag);
+
+    if (virtiofsd && virtiofsd->running())
+    {
+        virtiofsd->terminate();
+        if (!virtiofsd->wait_for_finished(virtiofsd_timeout_ms))
+            virtiofsd->kill();
+    }
+}
+
+const char* QemuMountHandler::fs_type() const
+{
+    return uses_virtiofs ? "virtiofs" : "9p";
+}
+
+void QemuMountHandler::add_virtiofs_helper(QemuVirtualMachine* vm, const VirtiofsOptions& options)
+{
+    vm_mount_helpers = &vm->modifiable_mount_helpers();
+    (*vm_mount_helpers)[tag] = [this, options] { start_virtiofsd(options); };
+}
+
+// QEMU connects to virtiofsd when it starts, and virtiofsd exits when QEMU goes away, so a new
+// one is needed for every launch of the instance
+void QemuMountHandler::start_virtiofsd(const VirtiofsOptions& options)
+{
+    QFile socket{virtiofs_socket};
+    MP_FILEOPS.remove(socket); // left behind if a previous virtiofsd was killed
+
+    virtiofsd = mp::platform::make_process(
+        std::make_unique<VirtiofsdProcessSpec>(VirtiofsdConfig{vm->vm_name,
+                                                               tag,
+                                                               source,
+                                                               virtiofs_socket,
+                                                               options.cache_mode,
+                                                               mount_spec.get_gid_mappings(),
+                                                               mount_spec.get_uid_mappings()}));
+    virtiofsd->start();
+
+    const auto deadline = std::chrono::steady_clock::now() + virtiofsd_timeout;
+    while (!MP_FILEOPS.exists(socket))
+    {
+        if (!virtiofsd->running() || std::chrono::steady_clock::now() > deadline)
+            throw std::runtime_error(
+                fmt::format("virtiofsd failed to share \"{}\" with instance '{}': {}",
+                            source,
+                            vm->vm_name,
+                            virtiofsd->read_all_standard_error()));
+
+        std::this_thread::sleep_for(std::chrono::milliseconds{10});
+    }
 }
 } // namespace multipass
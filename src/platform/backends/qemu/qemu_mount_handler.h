@@ -20,16 +20,26 @@
 #include "qemu_virtual_machine.h"
 
 #include <multipass/mount_handler.h>
+#include <multipass/process/process.h>
+
+#include <optional>
 
 namespace multipass
 {
 class QemuMountHandler : public MountHandler
 {
 public:
+    struct VirtiofsOptions
+    {
+        QString cache_mode;
+    };
+
+    // Mounts are shared over 9p, unless virtiofs options are given
     QemuMountHandler(QemuVirtualMachine* vm,
                      const SSHKeyProvider* ssh_key_provider,
                      const std::string& target,
-                     VMMount mount_spec);
+                     VMMount mount_spec,
+                     std::optional<VirtiofsOptions> virtiofs = std::nullopt);
     ~QemuMountHandler() override;
 
     void activate_impl(ServerVariant server, std::chrono::milliseconds timeout) override;
@@ -37,8 +47,16 @@ public:
     bool is_active() override;
 
 private:
+    const char* fs_type() const;
+    void add_virtiofs_helper(QemuVirtualMachine* vm, const VirtiofsOptions& options);
+    void start_virtiofsd(const VirtiofsOptions& options);
+
     QemuVirtualMachine::MountArgs& vm_mount_args;
+    QemuVirtualMachine::MountHelpers* vm_mount_helpers{nullptr};
     std::string tag;
+    bool uses_virtiofs;
+    QString virtiofs_socket;
+    std::unique_ptr<Process> virtiofsd;
 };
 
 } // namespace multipass
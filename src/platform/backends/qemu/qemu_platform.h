@@ -28,6 +28,7 @@
 #include <QString>
 #include <QStringList>
 
+#include <chrono>
 #include <memory>
 #include <optional>
 #include <string>
@@ -42,6 +43,12 @@ public:
     virtual ~QemuPlatform() = default;
 
     virtual std::optional<IPAddress> get_ip_for(const std::string& hw_addr) = 0;
+    // platforms that can be told about new leases wait up to timeout for one, others just check
+    virtual std::optional<IPAddress> wait_for_ip_for(const std::string& hw_addr,
+                                                     std::chrono::milliseconds /*timeout*/)
+    {
+        return get_ip_for(hw_addr);
+    }
     virtual void remove_resources_for(const std::string&) = 0;
     virtual void platform_health_check() = 0;
     virtual QStringList vmstate_platform_args()
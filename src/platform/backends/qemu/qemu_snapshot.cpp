@@ -65,6 +65,7 @@ mp::QemuSnapshot::QemuSnapshot(const std::string& name,
                                QemuVirtualMachine& vm,
                                VirtualMachineDescription& desc)
     : BaseSnapshot{name, comment, cloud_init_instance_id, std::move(parent), specs, vm},
+      vm{vm},
       desc{desc},
       image_path{desc.image.image_path}
 {
@@ -73,14 +74,23 @@ mp::QemuSnapshot::QemuSnapshot(const std::string& name,
 mp::QemuSnapshot::QemuSnapshot(const QString& filename,
                                QemuVirtualMachine& vm,
                                VirtualMachineDescription& desc)
-    : BaseSnapshot{filename, vm, desc}, desc{desc}, image_path{desc.image.image_path}
+    : BaseSnapshot{filename, vm, desc}, vm{vm}, desc{desc}, image_path{desc.image.image_path}
 {
 }
 
+bool mp::QemuSnapshot::vm_is_running() const
+{
+    return vm.current_state() == VirtualMachine::State::running;
+}
+
 void mp::QemuSnapshot::capture_impl()
 {
     const auto& tag = get_id();
 
+    // QEMU holds a lock on the image while it runs, so we go through it (it rejects repeated tags)
+    if (vm_is_running())
+        return vm.capture_live_snapshot(tag);
+
     // Avoid creating more than one snapshot with the same tag (creation would succeed, but we'd
     // then be unable to identify the snapshot by tag)
     if (backend::instance_image_has_snapshot(image_path, tag))
@@ -95,9 +105,15 @@ void mp::QemuSnapshot::capture_impl()
 void mp::QemuSnapshot::erase_impl()
 {
     const auto& tag = get_id();
-    if (backend::instance_image_has_snapshot(image_path, tag))
+    auto erase_from_image = [this, &tag] {
+        if (!backend::instance_image_has_snapshot(image_path, tag))
+            return false;
+
         mp::backend::checked_exec_qemu_img(make_delete_spec(tag, image_path));
-    else
+        return true;
+    };
+
+    if (!(vm_is_running() ? vm.erase_live_snapshot(tag) : erase_from_image()))
         mpl::log(mpl::Level::warning,
                  BaseSnapshot::get_name(),
                  fmt::format("Could not find the underlying QEMU snapshot. Assuming it is already "
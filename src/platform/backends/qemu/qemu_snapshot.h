@@ -46,6 +46,9 @@ protected:
     void apply_impl() override;
 
 private:
+    bool vm_is_running() const;
+
+    QemuVirtualMachine& vm;
     VirtualMachineDescription& desc;
     const Path& image_path;
 };
@@ -24,12 +24,15 @@
 #include <shared/qemu_img_utils/qemu_img_utils.h>
 #include <shared/shared_backend_utils.h>
 
+#include <multipass/constants.h>
+#include <multipass/exceptions/settings_exceptions.h>
 #include <multipass/exceptions/virtual_machine_state_exceptions.h>
 #include <multipass/format.h>
 #include <multipass/logging/log.h>
 #include <multipass/memory_size.h>
 #include <multipass/platform.h>
 #include <multipass/process/qemuimg_process_spec.h>
+#include <multipass/settings/settings.h>
 #include <multipass/top_catch_all.h>
 #include <multipass/utils.h>
 #include <multipass/vm_mount.h>
@@ -43,7 +46,9 @@
 #include <QString>
 #include <QTemporaryFile>
 
+#include <algorithm>
 #include <cassert>
+#include <thread>
 
 namespace mp = multipass;
 namespace mpl = multipass::logging;
@@ -58,9 +63,61 @@ constexpr auto arguments_key = "arguments";
 constexpr auto mount_data_key = "mount_data";
 constexpr auto mount_source_key = "source";
 constexpr auto mount_arguments_key = "arguments";
+constexpr auto suspend_timings_key = "suspend_timings";
+
+constexpr auto disk_device = "hda"; // the id of the instance's drive in the QEMU command line
 
 constexpr int shutdown_timeout = 300000;   // unit: ms, 5 minute timeout for shutdown/suspend
 constexpr int kill_process_timeout = 5000; // unit: ms, 5 seconds timeout for killing the process
+constexpr auto qmp_reply_timeout = 5min;   // saving or loading large states can be slow
+constexpr auto migration_poll_interval = 50ms;
+constexpr auto ip_wait_step = 1s; // how often to check on the VM while waiting for its address
+
+bool has_suspend_file(const mp::VirtualMachineDescription& desc)
+{
+    return QFile::exists(mp::QemuVMProcessSpec::suspend_file_for(desc));
+}
+
+QString setting_or(const QString& key, const QString& fallback)
+{
+    try
+    {
+        return MP_SETTINGS.get(key);
+    }
+    catch (const mp::UnrecognizedSettingException&)
+    {
+        return fallback; // settings are not always registered (e.g. on teardown)
+    }
+}
+
+// Migrating into a file, QEMU writes each page at a fixed offset, skipping zero pages (which
+// leaves holes in the file), and spreads the work over several channels. It also reports how
+// migrations end with events, so that loading a state need not be waited for.
+QJsonObject migration_capabilities()
+{
+    QJsonArray capabilities;
+    for (const auto* capability : {"mapped-ram", "multifd", "events"})
+        capabilities.append(QJsonObject{{"capability", capability}, {"state", true}});
+
+    return QJsonObject{{"capabilities", capabilities}};
+}
+
+QJsonObject migration_parameters()
+{
+    const auto channels = std::clamp(std::thread::hardware_concurrency(), 2u, 8u);
+    return QJsonObject{{"multifd-channels", static_cast<int>(channels)}};
+}
+
+qint64 milliseconds_since(std::chrono::steady_clock::time_point start)
+{
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+}
+
+QJsonObject migration_uri(const mp::VirtualMachineDescription& desc)
+{
+    return QJsonObject{{"uri", "file:" + mp::QemuVMProcessSpec::suspend_file_for(desc)}};
+}
 
 bool use_cdrom_set(const QJsonObject& metadata)
 {
@@ -126,7 +183,8 @@ auto make_qemu_process(const mp::VirtualMachineDescription& desc,
         resume_data = mp::QemuVMProcessSpec::ResumeData{suspend_tag,
                                                         get_vm_machine(data),
                                                         use_cdrom_set(data),
-                                                        get_arguments(data)};
+                                                        get_arguments(data),
+                                                        has_suspend_file(desc)};
     }
 
     auto process_spec =
@@ -145,25 +203,6 @@ auto make_qemu_process(const mp::VirtualMachineDescription& desc,
     return process;
 }
 
-auto qmp_execute_json(const QString& cmd)
-{
-    QJsonObject qmp;
-    qmp.insert("execute", cmd);
-    return QJsonDocument(qmp).toJson();
-}
-
-auto hmc_to_qmp_json(const QString& command_line)
-{
-    auto qmp = QJsonDocument::fromJson(qmp_execute_json("human-monitor-command")).object();
-
-    QJsonObject cmd_line;
-    cmd_line.insert("command-line", command_line);
-
-    qmp.insert("arguments", cmd_line);
-
-    return QJsonDocument(qmp).toJson();
-}
-
 auto get_qemu_machine_type(const QStringList& platform_args)
 {
     QTemporaryFile dump_file;
@@ -207,12 +246,17 @@ auto mount_args_to_json(const mp::QemuVirtualMachine::MountArgs& mount_args)
 
 auto generate_metadata(const QStringList& platform_args,
                        const QStringList& proc_args,
-                       const mp::QemuVirtualMachine::MountArgs& mount_args)
+                       const mp::QemuVirtualMachine::MountArgs& mount_args,
+                       const QJsonObject& old_metadata)
 {
     QJsonObject metadata;
     metadata[machine_type_key] = get_qemu_machine_type(platform_args);
     metadata[arguments_key] = QJsonArray::fromStringList(proc_args);
     metadata[mount_data_key] = mount_args_to_json(mount_args);
+
+    if (old_metadata.contains(suspend_timings_key))
+        metadata[suspend_timings_key] = old_metadata[suspend_timings_key];
+
     return metadata;
 }
 
@@ -250,8 +294,9 @@ mp::QemuVirtualMachine::QemuVirtualMachine(const VirtualMachineDescription& desc
                                            const SSHKeyProvider& key_provider,
                                            const Path& instance_dir,
                                            bool remove_snapshots)
-    : BaseVirtualMachine{mp::backend::instance_image_has_snapshot(desc.image.image_path,
-                                                                  suspend_tag)
+    : BaseVirtualMachine{has_suspend_file(desc) ||
+                                 mp::backend::instance_image_has_snapshot(desc.image.image_path,
+                                                                          suspend_tag)
                              ? State::suspended
                              : State::off,
                          desc.vm_name,
@@ -294,13 +339,15 @@ void mp::QemuVirtualMachine::start()
 {
     initialize_vm_process();
 
+    is_resuming_from_file = state == State::suspended && has_suspend_file(desc);
     if (state == State::suspended)
     {
         mpl::log(mpl::Level::info, vm_name, fmt::format("Resuming from a suspended state"));
 
         update_shutdown_status = true;
         is_starting_from_suspend = true;
-        network_deadline = std::chrono::steady_clock::now() + 5s;
+        resume_start = std::chrono::steady_clock::now();
+        network_deadline = resume_start + 5s;
     }
     else
     {
@@ -311,11 +358,16 @@ void mp::QemuVirtualMachine::start()
             for (const auto& arg : mount_data.second)
                 proc_args.removeOne(arg);
 
-        monitor->update_metadata_for(
-            vm_name,
-            generate_metadata(qemu_platform->vmstate_platform_args(), proc_args, mount_args));
+        monitor->update_metadata_for(vm_name,
+                                     generate_metadata(qemu_platform->vmstate_platform_args(),
+                                                       proc_args,
+                                                       mount_args,
+                                                       monitor->retrieve_metadata_for(vm_name)));
     }
 
+    for (const auto& [_, helper] : mount_helpers)
+        helper();
+
     vm_process->start();
     connect_vm_signals();
 
@@ -343,7 +395,23 @@ void mp::QemuVirtualMachine::start()
         }
     }
 
-    vm_process->write(qmp_execute_json("qmp_capabilities"));
+    qmp->execute("qmp_capabilities");
+
+    if (is_resuming_from_file)
+    {
+        try
+        {
+            load_state_from_file();
+        }
+        catch (const std::exception& e)
+        {
+            // Nothing is waiting for this start to complete, so QEMU going away is not a shutdown
+            // while starting
+            state = State::off;
+            fail_resume_from_file(e.what());
+            throw std::runtime_error{saved_error_msg};
+        }
+    }
 }
 
 void mp::QemuVirtualMachine::shutdown(ShutdownPolicy shutdown_policy)
@@ -383,13 +451,21 @@ void mp::QemuVirtualMachine::shutdown(ShutdownPolicy shutdown_policy)
             mpl::log(mpl::Level::debug, vm_name, "No process to kill");
         }
 
+        const auto has_suspension_file = has_suspend_file(desc);
         const auto has_suspend_snapshot =
             mp::backend::instance_image_has_snapshot(desc.image.image_path, suspend_tag);
-        if (has_suspend_snapshot != (state == State::suspended)) // clang-format off
+        const auto has_suspension = has_suspension_file || has_suspend_snapshot;
+        if (has_suspension != (state == State::suspended)) // clang-format off
             mpl::log(mpl::Level::warning, vm_name, fmt::format("Image has {} suspension snapshot, but the state is {}",
-                                                               has_suspend_snapshot ? "a" : "no",
+                                                               has_suspension ? "a" : "no",
                                                                static_cast<short>(state))); // clang-format on
 
+        if (has_suspension_file)
+        {
+            mpl::log(mpl::Level::info, vm_name, "Deleting suspension file");
+            QFile::remove(QemuVMProcessSpec::suspend_file_for(desc));
+        }
+
         if (has_suspend_snapshot)
         {
             mpl::log(mpl::Level::info, vm_name, "Deleting suspend image");
@@ -406,7 +482,7 @@ void mp::QemuVirtualMachine::shutdown(ShutdownPolicy shutdown_policy)
 
         if (vm_process && vm_process->running())
         {
-            vm_process->write(qmp_execute_json("system_powerdown"));
+            qmp->execute("system_powerdown");
             if (vm_process->wait_for_finished(shutdown_timeout))
             {
                 lock.lock();
@@ -426,6 +502,11 @@ void mp::QemuVirtualMachine::suspend()
 {
     if ((state == State::running || state == State::delayed_shutdown) && vm_process->running())
     {
+        // QEMU refuses to save the state of vhost-user devices, which only virtiofs mounts add
+        if (!mount_helpers.empty())
+            throw std::runtime_error{
+                fmt::format("Cannot suspend instance '{}' while it has virtiofs mounts", vm_name)};
+
         if (update_shutdown_status)
         {
             state = State::suspending;
@@ -434,10 +515,21 @@ void mp::QemuVirtualMachine::suspend()
         }
 
         drop_ssh_session();
-        vm_process->write(hmc_to_qmp_json(QString{"savevm "} + suspend_tag));
-        vm_process->wait_for_finished(shutdown_timeout);
 
+        const auto suspend_start = std::chrono::steady_clock::now();
+        auto format = setting_or(suspend_format_key, suspend_format_snapshot);
+        if (format != suspend_format_file || !save_state_to_file())
+        {
+            format = suspend_format_snapshot;
+            awaiting_savevm = true;
+            qmp->human_monitor_command(QString{"savevm "} + suspend_tag);
+        }
+
+        vm_process->wait_for_finished(shutdown_timeout);
         vm_process.reset(nullptr);
+
+        record_suspend_timings(
+            QJsonObject{{"format", format}, {"suspend_ms", milliseconds_since(suspend_start)}});
     }
     else if (state == State::off || state == State::suspended)
     {
@@ -491,7 +583,10 @@ void mp::QemuVirtualMachine::on_shutdown()
             state_wait.wait(lock, [this] { return shutdown_while_starting; });
         }
 
-        management_ip = std::nullopt;
+        {
+            std::lock_guard<std::mutex> ip_lock{management_ip_mutex};
+            management_ip = std::nullopt;
+        }
         drop_ssh_session();
         update_state();
         vm_process.reset(nullptr);
@@ -513,7 +608,10 @@ void mp::QemuVirtualMachine::on_restart()
     state = State::restarting;
     update_state();
 
-    management_ip = std::nullopt;
+    {
+        std::lock_guard<std::mutex> lock{management_ip_mutex};
+        management_ip = std::nullopt;
+    }
 
     monitor->on_restart(vm_name);
 }
@@ -542,11 +640,35 @@ void mp::QemuVirtualMachine::ensure_vm_is_running()
 
 std::string mp::QemuVirtualMachine::ssh_hostname(std::chrono::milliseconds timeout)
 {
-    auto get_ip = [this]() -> std::optional<IPAddress> {
-        return qemu_platform->get_ip_for(desc.default_mac_address);
-    };
+    // Rather than retrying lookups, wait on the platform to be told about the lease
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    std::unique_lock<std::mutex> lock{management_ip_mutex};
+    while (!management_ip)
+    {
+        const auto now = std::chrono::steady_clock::now();
+        if (now >= deadline)
+        {
+            state = State::unknown;
+            throw InternalTimeoutException{"determine IP address", timeout};
+        }
+
+        lock.unlock(); // not to hold up others while waiting
+        ensure_vm_is_running();
 
-    return mp::backend::ip_address_for(this, get_ip, timeout);
+        const auto step_end = std::min<std::chrono::steady_clock::time_point>(deadline,
+                                                                              now + ip_wait_step);
+        const auto step = std::chrono::ceil<std::chrono::milliseconds>(step_end - now);
+        auto ip = qemu_platform->wait_for_ip_for(desc.default_mac_address, step);
+        if (!ip)
+            if (const auto left = step_end - std::chrono::steady_clock::now(); left > 0ms)
+                MP_UTILS.sleep_for(std::chrono::ceil<std::chrono::milliseconds>(left)); // no wait
+
+        lock.lock();
+        if (ip && !management_ip)
+            management_ip.emplace(*ip);
+    }
+
+    return management_ip->as_string();
 }
 
 std::string mp::QemuVirtualMachine::ssh_username()
@@ -556,6 +678,7 @@ std::string mp::QemuVirtualMachine::ssh_username()
 
 std::string mp::QemuVirtualMachine::management_ipv4()
 {
+    std::lock_guard<std::mutex> lock{management_ip_mutex};
     if (!management_ip)
     {
         auto result = qemu_platform->get_ip_for(desc.default_mac_address);
@@ -584,8 +707,45 @@ void mp::QemuVirtualMachine::wait_until_ssh_up(std::chrono::milliseconds timeout
     }
 }
 
+void mp::QemuVirtualMachine::on_qmp_event(const QString& event, const QJsonObject& data)
+{
+    if (event == "RESET" && state != State::restarting)
+    {
+        mpl::log(mpl::Level::info, vm_name, "VM restarting");
+        on_restart();
+    }
+    else if (event == "POWERDOWN")
+    {
+        mpl::log(mpl::Level::info, vm_name, "VM powering down");
+    }
+    else if (event == "SHUTDOWN")
+    {
+        mpl::log(mpl::Level::info, vm_name, "VM shut down");
+    }
+    else if (event == "STOP")
+    {
+        mpl::log(mpl::Level::info, vm_name, "VM suspending");
+    }
+    else if (event == "RESUME" && awaiting_savevm)
+    {
+        // savevm resumes the guest once the snapshot is taken
+        mpl::log(mpl::Level::info, vm_name, "VM suspended");
+        awaiting_savevm = false;
+        if (state == State::suspending || state == State::running)
+        {
+            vm_process->kill();
+            on_suspend();
+        }
+    }
+    else if (event == "MIGRATION" && is_resuming_from_file)
+    {
+        on_incoming_migration(data["status"].toString());
+    }
+}
+
 void mp::QemuVirtualMachine::initialize_vm_process()
 {
+    awaiting_savevm = false;
     vm_process = make_qemu_process(
         desc,
         ((state == State::suspended) ? std::make_optional(monitor->retrieve_metadata_for(vm_name))
@@ -598,41 +758,22 @@ void mp::QemuVirtualMachine::initialize_vm_process()
         on_started();
     });
 
+    // QMP messages may be split across reads, or several may arrive at once, so the client does
+    // the framing
+    qmp = std::make_unique<QmpClient>([this](const QByteArray& data) {
+        if (vm_process)
+            vm_process->write(data);
+    });
+    QObject::connect(qmp.get(),
+                     &QmpClient::event_received,
+                     [this](const QString& event, const QJsonObject& data) {
+                         on_qmp_event(event, data);
+                     });
+
     QObject::connect(vm_process.get(), &Process::ready_read_standard_output, [this]() {
         auto qmp_output = vm_process->read_all_standard_output();
         mpl::log(mpl::Level::debug, vm_name, fmt::format("QMP: {}", qmp_output));
-        auto qmp_object = QJsonDocument::fromJson(qmp_output.split('\n').first()).object();
-        auto event = qmp_object["event"];
-
-        if (!event.isNull())
-        {
-            if (event.toString() == "RESET" && state != State::restarting)
-            {
-                mpl::log(mpl::Level::info, vm_name, "VM restarting");
-                on_restart();
-            }
-            else if (event.toString() == "POWERDOWN")
-            {
-                mpl::log(mpl::Level::info, vm_name, "VM powering down");
-            }
-            else if (event.toString() == "SHUTDOWN")
-            {
-                mpl::log(mpl::Level::info, vm_name, "VM shut down");
-            }
-            else if (event.toString() == "STOP")
-            {
-                mpl::log(mpl::Level::info, vm_name, "VM suspending");
-            }
-            else if (event.toString() == "RESUME")
-            {
-                mpl::log(mpl::Level::info, vm_name, "VM suspended");
-                if (state == State::suspending || state == State::running)
-                {
-                    vm_process->kill();
-                    on_suspend();
-                }
-            }
-        }
+        qmp->receive(qmp_output);
     });
 
     QObject::connect(vm_process.get(), &Process::ready_read_standard_error, [this]() {
@@ -668,6 +809,8 @@ void mp::QemuVirtualMachine::initialize_vm_process()
                      });
 
     QObject::connect(vm_process.get(), &Process::finished, [this](ProcessState process_state) {
+        qmp->abandon_pending("QEMU process finished");
+
         if (process_state.exit_code)
         {
             mpl::log(
@@ -715,9 +858,21 @@ void mp::QemuVirtualMachine::connect_vm_signals()
         &QemuVirtualMachine::on_delete_memory_snapshot,
         this,
         [this] {
-            mpl::log(mpl::Level::debug, vm_name, fmt::format("Deleted memory snapshot"));
-            vm_process->write(hmc_to_qmp_json(QString("delvm ") + suspend_tag));
+            // Resuming is timed up to SSH being available. The metadata is only updated from the
+            // instance's own thread.
+            auto timings = monitor->retrieve_metadata_for(vm_name)[suspend_timings_key].toObject();
+            timings["resume_ms"] = milliseconds_since(resume_start);
+            record_suspend_timings(timings);
+
+            // a suspension file is removed as soon as it is loaded
+            if (!is_resuming_from_file)
+            {
+                mpl::log(mpl::Level::debug, vm_name, fmt::format("Deleted memory snapshot"));
+                qmp->human_monitor_command(QString("delvm ") + suspend_tag);
+            }
+
             is_starting_from_suspend = false;
+            is_resuming_from_file = false;
         },
         Qt::QueuedConnection);
 
@@ -730,18 +885,13 @@ void mp::QemuVirtualMachine::connect_vm_signals()
         [this] {
             mpl::log(mpl::Level::debug, vm_name, fmt::format("Resetting the network"));
 
-            auto qmp = QJsonDocument::fromJson(qmp_execute_json("set_link")).object();
             QJsonObject args;
             args.insert("name", "virtio-net-pci.0");
             args.insert("up", false);
-            qmp.insert("arguments", args);
-
-            vm_process->write(QJsonDocument(qmp).toJson());
+            qmp->execute("set_link", args);
 
             args["up"] = true;
-            qmp["arguments"] = args;
-
-            vm_process->write(QJsonDocument(qmp).toJson());
+            qmp->execute("set_link", args);
         },
         Qt::QueuedConnection);
 
@@ -808,7 +958,15 @@ void mp::QemuVirtualMachine::add_network_interface(int /* not used on this backe
 mp::MountHandler::UPtr mp::QemuVirtualMachine::make_native_mount_handler(const std::string& target,
                                                                          const VMMount& mount)
 {
-    return std::make_unique<QemuMountHandler>(this, &key_provider, target, mount);
+    if (setting_or(native_mount_type_key, native_mount_type_9p) != native_mount_type_virtiofs)
+        return std::make_unique<QemuMountHandler>(this, &key_provider, target, mount);
+
+    return std::make_unique<QemuMountHandler>(
+        this,
+        &key_provider,
+        target,
+        mount,
+        QemuMountHandler::VirtiofsOptions{setting_or(virtiofs_cache_key, virtiofs_cache_default)});
 }
 
 void mp::QemuVirtualMachine::remove_snapshots_from_backend() const
@@ -822,11 +980,200 @@ void mp::QemuVirtualMachine::remove_snapshots_from_backend() const
     }
 }
 
+void mp::QemuVirtualMachine::capture_live_snapshot(const QString& tag)
+{
+    // The guest keeps running: block jobs are drained for the snapshot, so the disk is captured in
+    // a crash-consistent state, like the one it would have after a power cut
+    QJsonObject args;
+    args.insert("device", disk_device);
+    args.insert("name", tag);
+
+    execute_qmp_and_wait("blockdev-snapshot-internal-sync", args);
+}
+
+bool mp::QemuVirtualMachine::erase_live_snapshot(const QString& tag)
+{
+    bool found = false;
+    for (const auto& block : execute_qmp_and_wait("query-block", {}).toArray())
+    {
+        const auto block_info = block.toObject();
+        if (block_info["device"].toString() != disk_device)
+            continue;
+
+        for (const auto& snapshot : block_info["inserted"]["image"]["snapshots"].toArray())
+            found = found || snapshot["name"].toString() == tag;
+    }
+
+    if (!found)
+        return false;
+
+    QJsonObject args;
+    args.insert("device", disk_device);
+    args.insert("name", tag);
+
+    execute_qmp_and_wait("blockdev-snapshot-delete-internal-sync", args);
+    return true;
+}
+
+QJsonValue mp::QemuVirtualMachine::execute_qmp_and_wait(const QString& command,
+                                                        const QJsonObject& arguments)
+{
+    if (!vm_process || !vm_process->running())
+        throw std::runtime_error{
+            fmt::format("Cannot execute QMP command {}: QEMU is not running", command)};
+
+    // Replies arrive on QEMU's standard output, which is normally read from the event loop. We may
+    // well be blocking that loop here, so pump the output ourselves until the reply comes in
+    auto reply = qmp->execute(command, arguments);
+    const auto deadline = std::chrono::steady_clock::now() + qmp_reply_timeout;
+    while (reply.wait_for(0s) != std::future_status::ready)
+    {
+        if (!vm_process || std::chrono::steady_clock::now() > deadline)
+            throw std::runtime_error{fmt::format("No reply from QEMU to QMP command {}", command)};
+
+        vm_process->wait_for_ready_read(100);
+    }
+
+    return reply.get();
+}
+
+bool mp::QemuVirtualMachine::save_state_to_file()
+{
+    try
+    {
+        execute_qmp_and_wait("migrate-set-capabilities", migration_capabilities());
+        execute_qmp_and_wait("migrate-set-parameters", migration_parameters());
+    }
+    catch (const QmpError& e)
+    {
+        mpl::log(mpl::Level::warning,
+                 vm_name,
+                 fmt::format("Cannot suspend to a file, falling back to a snapshot: {}", e.what()));
+        return false;
+    }
+
+    // Pausing first spares migration from chasing pages that the guest keeps dirtying
+    execute_qmp_and_wait("stop", {});
+    try
+    {
+        execute_qmp_and_wait("migrate", migration_uri(desc));
+        wait_for_migration();
+    }
+    catch (...)
+    {
+        QFile::remove(QemuVMProcessSpec::suspend_file_for(desc));
+
+        // Back to running before the guest is, so that its resumption is not taken for the end of
+        // a suspension
+        if (state == State::suspending)
+        {
+            state = State::running;
+            update_state();
+            update_shutdown_status = true;
+        }
+
+        top_catch_all(vm_name, [this] { execute_qmp_and_wait("cont", {}); });
+        throw;
+    }
+
+    mpl::log(mpl::Level::info, vm_name, "VM suspended");
+    on_suspend();
+    vm_process->kill();
+
+    return true;
+}
+
+void mp::QemuVirtualMachine::load_state_from_file()
+{
+    // Only the setup is waited for. QEMU loads the state in the background and then reports how
+    // that went, while the start carries on waiting for SSH.
+    execute_qmp_and_wait("migrate-set-capabilities", migration_capabilities());
+    execute_qmp_and_wait("migrate-set-parameters", migration_parameters());
+    execute_qmp_and_wait("migrate-incoming", migration_uri(desc));
+}
+
+void mp::QemuVirtualMachine::on_incoming_migration(const QString& status)
+{
+    if (status == "completed")
+    {
+        // The state is now in memory and will diverge from the file as soon as the guest runs
+        const auto suspend_file = QemuVMProcessSpec::suspend_file_for(desc);
+        if (!QFile::remove(suspend_file))
+            mpl::log(mpl::Level::warning,
+                     vm_name,
+                     fmt::format("Could not remove suspension file {}", suspend_file));
+
+        qmp->execute("cont");
+    }
+    else if (status == "failed" || status == "cancelled")
+    {
+        // Whoever waits for the start finds QEMU gone, and reports the error
+        fail_resume_from_file(fmt::format("migration {}", status));
+    }
+}
+
+void mp::QemuVirtualMachine::fail_resume_from_file(const std::string& reason)
+{
+    // A state that cannot be loaded would fail every later start too, so it is dropped
+    const auto suspend_file = QemuVMProcessSpec::suspend_file_for(desc);
+    QFile::remove(suspend_file);
+    is_starting_from_suspend = false;
+    is_resuming_from_file = false;
+
+    auto error = fmt::format("Could not restore the suspended state from {}: {}. The state was "
+                             "discarded, the instance will boot afresh when started again.",
+                             suspend_file,
+                             reason);
+    mpl::log(mpl::Level::error, vm_name, error);
+
+    if (!saved_error_msg.empty())
+        error.append("\n").append(saved_error_msg); // what QEMU had to say about it
+    saved_error_msg = error;
+
+    if (vm_process)
+        vm_process->kill();
+}
+
+void mp::QemuVirtualMachine::wait_for_migration()
+{
+    const auto deadline = std::chrono::steady_clock::now() + qmp_reply_timeout;
+    while (true)
+    {
+        const auto info = execute_qmp_and_wait("query-migrate", {}).toObject();
+        const auto status = info["status"].toString();
+
+        if (status == "completed")
+            return;
+
+        if (status == "failed" || status == "cancelled")
+            throw std::runtime_error{
+                fmt::format("Migration {}: {}", status, info["error-desc"].toString())};
+
+        if (std::chrono::steady_clock::now() > deadline)
+            throw std::runtime_error{
+                fmt::format("Migration did not complete in time (status: {})", status)};
+
+        std::this_thread::sleep_for(migration_poll_interval);
+    }
+}
+
+void mp::QemuVirtualMachine::record_suspend_timings(const QJsonObject& timings)
+{
+    auto metadata = monitor->retrieve_metadata_for(vm_name);
+    metadata[suspend_timings_key] = timings;
+    monitor->update_metadata_for(vm_name, metadata);
+}
+
 mp::QemuVirtualMachine::MountArgs& mp::QemuVirtualMachine::modifiable_mount_args()
 {
     return mount_args;
 }
 
+mp::QemuVirtualMachine::MountHelpers& mp::QemuVirtualMachine::modifiable_mount_helpers()
+{
+    return mount_helpers;
+}
+
 auto mp::QemuVirtualMachine::make_specific_snapshot(const std::string& snapshot_name,
                                                     const std::string& comment,
                                                     const std::string& instance_id,
@@ -834,8 +1181,8 @@ auto mp::QemuVirtualMachine::make_specific_snapshot(const std::string& snapshot_
                                                     std::shared_ptr<Snapshot> parent)
     -> std::shared_ptr<Snapshot>
 {
-    assert(state == VirtualMachine::State::off ||
-           state == VirtualMachine::State::stopped); // would need QMP otherwise
+    assert(state == VirtualMachine::State::off || state == VirtualMachine::State::stopped ||
+           state == VirtualMachine::State::running); // running ones are captured through QMP
     return std::make_shared<QemuSnapshot>(snapshot_name,
                                           comment,
                                           instance_id,
@@ -18,6 +18,7 @@
 #pragma once
 
 #include "qemu_platform.h"
+#include "qmp_client.h"
 
 #include <shared/base_virtual_machine.h>
 
@@ -28,6 +29,7 @@
 #include <QObject>
 #include <QStringList>
 
+#include <functional>
 #include <unordered_map>
 
 namespace multipass
@@ -40,6 +42,8 @@ class QemuVirtualMachine : public QObject, public BaseVirtualMachine
     Q_OBJECT
 public:
     using MountArgs = std::unordered_map<std::string, std::pair<std::string, QStringList>>;
+    // Per-mount callbacks that run before every launch of QEMU (e.g. to start a server it needs)
+    using MountHelpers = std::unordered_map<std::string, std::function<void()>>;
 
     QemuVirtualMachine(const VirtualMachineDescription& desc,
                        QemuPlatform* qemu_platform,
@@ -68,8 +72,14 @@ public:
                                        const std::string& default_mac_addr,
                                        const NetworkInterface& extra_interface) override;
     virtual MountArgs& modifiable_mount_args();
+    virtual MountHelpers& modifiable_mount_helpers();
     std::unique_ptr<MountHandler> make_native_mount_handler(const std::string& target,
                                                             const VMMount& mount) override;
+    bool supports_live_snapshots() const override;
+
+    // Internal snapshots of the disk of a running instance, taken and removed through QMP
+    virtual void capture_live_snapshot(const QString& tag);
+    virtual bool erase_live_snapshot(const QString& tag); // false if there was no such snapshot
 signals:
     void on_delete_memory_snapshot();
     void on_reset_network();
@@ -98,20 +108,33 @@ private:
     void on_shutdown();
     void on_suspend();
     void on_restart();
+    void on_qmp_event(const QString& event, const QJsonObject& data);
     void initialize_vm_process();
 
     void connect_vm_signals();
     void disconnect_vm_signals();
     void remove_snapshots_from_backend() const;
+    QJsonValue execute_qmp_and_wait(const QString& command, const QJsonObject& arguments);
+    bool save_state_to_file(); // false if QEMU cannot migrate to a file
+    void load_state_from_file();
+    void on_incoming_migration(const QString& status);
+    void fail_resume_from_file(const std::string& reason);
+    void wait_for_migration();
+    void record_suspend_timings(const QJsonObject& timings);
 
     VirtualMachineDescription desc;
     std::unique_ptr<Process> vm_process{nullptr};
+    std::unique_ptr<QmpClient> qmp{nullptr};
     QemuPlatform* qemu_platform;
     VMStatusMonitor* monitor;
     MountArgs mount_args;
+    MountHelpers mount_helpers;
     std::string saved_error_msg;
     bool update_shutdown_status{true};
     bool is_starting_from_suspend{false};
+    bool is_resuming_from_file{false};
+    bool awaiting_savevm{false};
+    std::chrono::steady_clock::time_point resume_start;
     bool force_shutdown{false};
     std::mutex vm_signal_mutex;
     bool vm_signals_connected{false};
@@ -119,6 +142,11 @@ private:
 };
 } // namespace multipass
 
+inline bool multipass::QemuVirtualMachine::supports_live_snapshots() const
+{
+    return true;
+}
+
 inline void multipass::QemuVirtualMachine::require_snapshots_support() const
 {
 }
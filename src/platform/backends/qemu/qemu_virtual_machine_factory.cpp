@@ -81,6 +81,22 @@ void mp::QemuVirtualMachineFactory::prepare_instance_image(const mp::VMImage& in
     mp::backend::resize_instance_image(desc.disk_space, instance_image.image_path);
 }
 
+mp::VMImageVault::UPtr mp::QemuVirtualMachineFactory::create_image_vault(
+    std::vector<VMImageHost*> image_hosts,
+    URLDownloader* downloader,
+    const Path& cache_dir_path,
+    const Path& data_dir_path,
+    const days& days_to_expire)
+{
+    // Prepared images are always qcow2 here, so instances can be thin overlays on top of them
+    return std::make_unique<DefaultVMImageVault>(image_hosts,
+                                                 downloader,
+                                                 cache_dir_path,
+                                                 data_dir_path,
+                                                 days_to_expire,
+                                                 /* thin_instance_images = */ true);
+}
+
 void mp::QemuVirtualMachineFactory::hypervisor_health_check()
 {
     qemu_platform->platform_health_check();
@@ -45,6 +45,11 @@ public:
     void require_snapshots_support() const override;
     void require_clone_support() const override;
     void prepare_networking(std::vector<NetworkInterface>& extra_interfaces) override;
+    VMImageVault::UPtr create_image_vault(std::vector<VMImageHost*> image_hosts,
+                                          URLDownloader* downloader,
+                                          const Path& cache_dir_path,
+                                          const Path& data_dir_path,
+                                          const days& days_to_expire) override;
 
 protected:
     void remove_resources_for_impl(const std::string& name) override;
@@ -20,9 +20,15 @@
 #include <multipass/exceptions/snap_environment_exception.h>
 #include <multipass/format.h>
 #include <multipass/logging/log.h>
+#include <multipass/process/qemuimg_process_spec.h>
 #include <multipass/snap_utils.h>
 #include <shared/linux/backend_utils.h>
 
+#include <QDir>
+#include <QFileInfo>
+
+#include <algorithm>
+
 namespace mp = multipass;
 namespace mpl = multipass::logging;
 namespace mpu = multipass::utils;
@@ -44,7 +50,11 @@ QStringList mp::QemuVMProcessSpec::arguments() const
         args = resume_data->arguments;
 
         // need to append extra arguments for resume
-        args << "-loadvm" << resume_data->suspend_tag;
+        if (resume_data->from_file)
+            args << "-incoming"
+                 << "defer"; // the state is migrated in once QMP is up
+        else
+            args << "-loadvm" << resume_data->suspend_tag;
 
         QString machine_type = resume_data->machine_type;
         if (!machine_type.isEmpty())
@@ -82,6 +92,12 @@ in `man qemu-system`, under `-m` option; including suffix to avoid relying on de
         args << "-smp" << QString::number(desc.num_cores);
         // Memory to use for VM
         args << "-m" << mem_size;
+        // vhost-user devices (i.e. virtiofs mounts) need guest memory that their servers can map
+        if (has_vhost_user_mounts())
+            args << "-object"
+                 << QString("memory-backend-memfd,id=mem,size=%1,share=on").arg(mem_size)
+                 << "-machine"
+                 << "memory-backend=mem";
         // Control interface
         args << "-qmp"
              << "stdio";
@@ -188,6 +204,11 @@ profile %1 flags=(attach_disconnected) {
   # Disk images
   %6 rwk,  # QCow2 filesystem image
   %7 rk,   # cloud-init ISO
+  %9 rw,   # suspended state, when saved to a file
+  %10 rw,  # virtiofsd sockets
+
+  # QCow2 backing images, read-only
+  %11
 
   # allow full access just to user-specified mount directories on the host
   %8
@@ -195,10 +216,14 @@ profile %1 flags=(attach_disconnected) {
     )END");
 
     /* Customisations depending on if running inside snap or not */
-    QString root_dir;    // root directory: either "" or $SNAP
-    QString signal_peer; // who can send kill signal to qemu
-    QString firmware;    // location of bootloader firmware needed by qemu
-    QString mount_dirs;  // directories on host that are mounted
+    QString root_dir;       // root directory: either "" or $SNAP
+    QString signal_peer;    // who can send kill signal to qemu
+    QString firmware;       // location of bootloader firmware needed by qemu
+    QString mount_dirs;     // directories on host that are mounted
+    QString backing_images; // cached images that the instance image is an overlay on
+
+    for (const auto& backing_image : QemuImgProcessSpec::backing_images_of(desc.image.image_path))
+        backing_images += backing_image + " rk,\n  ";
 
     for (const auto& [_, mount_data] : mount_args)
     {
@@ -226,7 +251,23 @@ profile %1 flags=(attach_disconnected) {
                                 program(),
                                 desc.image.image_path,
                                 desc.cloud_init_iso,
-                                mount_dirs);
+                                mount_dirs,
+                                suspend_file_for(desc),
+                                QFileInfo{desc.image.image_path}.absoluteDir().filePath(
+                                    "virtiofs-*.sock"),
+                                backing_images);
+}
+
+bool mp::QemuVMProcessSpec::has_vhost_user_mounts() const
+{
+    return std::any_of(mount_args.begin(), mount_args.end(), [](const auto& entry) {
+        return !entry.second.second.filter(QStringLiteral("vhost-user-")).isEmpty();
+    });
+}
+
+QString mp::QemuVMProcessSpec::suspend_file_for(const VirtualMachineDescription& desc)
+{
+    return desc.image.image_path + ".suspend";
 }
 
 QString mp::QemuVMProcessSpec::identifier() const
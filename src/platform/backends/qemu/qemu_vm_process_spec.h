@@ -37,9 +37,11 @@ public:
         QString machine_type;
         bool use_cdrom_flag; // to be removed, should be replaced by "arguments"
         QStringList arguments;
+        bool from_file{false}; // migrate the state in from suspend_file_for(desc), not suspend_tag
     };
 
     static QString default_machine_type();
+    static QString suspend_file_for(const VirtualMachineDescription& desc);
 
     explicit QemuVMProcessSpec(const VirtualMachineDescription& desc,
                                const QStringList& platform_args,
@@ -52,6 +54,8 @@ public:
     QString identifier() const override;
 
 private:
+    bool has_vhost_user_mounts() const;
+
     const VirtualMachineDescription desc;
     const QStringList platform_args;
     const QemuVirtualMachine::MountArgs mount_args;
@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "qmp_client.h"
+
+#include <multipass/format.h>
+#include <multipass/logging/log.h>
+
+#include <QJsonDocument>
+
+namespace mp = multipass;
+namespace mpl = multipass::logging;
+
+namespace
+{
+constexpr auto category = "qmp";
+} // namespace
+
+mp::QmpClient::QmpClient(Writer writer) : writer{std::move(writer)}
+{
+}
+
+std::future<QJsonValue> mp::QmpClient::execute(const QString& command,
+                                               const QJsonObject& arguments)
+{
+    QJsonObject qmp;
+    qmp.insert("execute", command);
+    if (!arguments.isEmpty())
+        qmp.insert("arguments", arguments);
+
+    std::future<QJsonValue> reply;
+    {
+        std::lock_guard lock{pending_mutex};
+        const auto id = next_id++;
+        qmp.insert("id", static_cast<qint64>(id));
+        reply = pending[id].get_future();
+    }
+
+    writer(QJsonDocument(qmp).toJson(QJsonDocument::Compact) + '\n');
+    return reply;
+}
+
+std::future<QJsonValue> mp::QmpClient::human_monitor_command(const QString& command_line)
+{
+    QJsonObject arguments;
+    arguments.insert("command-line", command_line);
+
+    return execute("human-monitor-command", arguments);
+}
+
+void mp::QmpClient::receive(const QByteArray& data)
+{
+    partial_message += data;
+
+    qsizetype start = 0;
+    for (auto end = partial_message.indexOf('\n'); end != -1;
+         start = end + 1, end = partial_message.indexOf('\n', start))
+    {
+        const auto line = partial_message.mid(start, end - start).trimmed();
+        if (!line.isEmpty())
+            handle_message(line);
+    }
+
+    partial_message.remove(0, start);
+}
+
+void mp::QmpClient::abandon_pending(const std::string& reason)
+{
+    std::lock_guard lock{pending_mutex};
+    for (auto& [id, reply] : pending)
+        reply.set_exception(std::make_exception_ptr(QmpError{reason}));
+
+    pending.clear();
+}
+
+void mp::QmpClient::handle_message(const QByteArray& line)
+{
+    QJsonParseError parse_error;
+    const auto message = QJsonDocument::fromJson(line, &parse_error).object();
+    if (parse_error.error != QJsonParseError::NoError)
+    {
+        mpl::log(
+            mpl::Level::debug,
+            category,
+            fmt::format("Ignoring malformed message ({}): {}", parse_error.errorString(), line));
+        return;
+    }
+
+    if (const auto event = message["event"]; event.isString())
+    {
+        emit event_received(event.toString(), message["data"].toObject());
+        return;
+    }
+
+    // Anything else without an id is either the greeting, or a reply to a command sent elsewhere
+    if (!message.contains("id"))
+        return;
+
+    std::promise<QJsonValue> reply;
+    {
+        std::lock_guard lock{pending_mutex};
+        const auto found = pending.find(message["id"].toInteger(-1));
+        if (found == pending.end())
+            return;
+
+        reply = std::move(found->second);
+        pending.erase(found);
+    }
+
+    if (const auto error = message["error"]; error.isObject())
+        reply.set_exception(std::make_exception_ptr(
+            QmpError{fmt::format("{}: {}",
+                                 error["class"].toString(),
+                                 error["desc"].toString())}));
+    else
+        reply.set_value(message["return"]);
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <QByteArray>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QObject>
+#include <QString>
+
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace multipass
+{
+class QmpError : public std::runtime_error
+{
+public:
+    using std::runtime_error::runtime_error;
+};
+
+// Speaks QMP with a QEMU process: commands are tagged with ids so that their replies can be
+// matched up, and output is split into messages, with events passed on as they arrive
+class QmpClient : public QObject
+{
+    Q_OBJECT
+public:
+    using Writer = std::function<void(const QByteArray&)>;
+
+    explicit QmpClient(Writer writer);
+
+    // The future holds the "return" member of the reply, or a QmpError if QEMU reports an error
+    std::future<QJsonValue> execute(const QString& command, const QJsonObject& arguments = {});
+    std::future<QJsonValue> human_monitor_command(const QString& command_line);
+
+    // Takes output from QEMU, which may hold any number of messages, or parts of them
+    void receive(const QByteArray& data);
+
+    // Fails the replies still outstanding, for when QEMU goes away
+    void abandon_pending(const std::string& reason);
+
+signals:
+    void event_received(const QString& event, const QJsonObject& data);
+
+private:
+    void handle_message(const QByteArray& line);
+
+    const Writer writer;
+    QByteArray partial_message;
+    std::mutex pending_mutex;
+    std::uint64_t next_id{0};
+    std::unordered_map<std::uint64_t, std::promise<QJsonValue>> pending;
+};
+} // namespace multipass
@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "virtiofsd_process_spec.h"
+
+#include <multipass/exceptions/snap_environment_exception.h>
+#include <multipass/snap_utils.h>
+
+namespace mp = multipass;
+namespace mpu = multipass::utils;
+
+namespace
+{
+// virtiofsd translates IDs from the guest to the host, so mappings are given in the reverse order
+QString translation_arg(const QString& option, const mp::id_mappings& xid_mappings)
+{
+    const auto [host_id, guest_id] =
+        xid_mappings.empty() ? std::make_pair(1000, 1000) : xid_mappings.front();
+    return QString("--%1=map:%2:%3:1")
+        .arg(option)
+        .arg(guest_id == -1 ? 1000 : guest_id)
+        .arg(host_id);
+}
+} // namespace
+
+mp::VirtiofsdProcessSpec::VirtiofsdProcessSpec(const VirtiofsdConfig& config) : config{config}
+{
+}
+
+QString mp::VirtiofsdProcessSpec::program() const
+{
+    try
+    {
+        return mpu::snap_dir().append("/usr/libexec/virtiofsd");
+    }
+    catch (const mp::SnapEnvironmentException&)
+    {
+        return "/usr/libexec/virtiofsd"; // where distributions install it, outside of $PATH
+    }
+}
+
+QStringList mp::VirtiofsdProcessSpec::arguments() const
+{
+    return QStringList()
+           << QString("--socket-path=%1").arg(config.socket_path)
+           << QString("--shared-dir=%1").arg(QString::fromStdString(config.source_path))
+           << QString("--cache=%1").arg(config.cache_mode)
+           << "--sandbox=chroot" // we run as root, no need for user namespaces
+           << translation_arg("translate-uid", config.uid_mappings)
+           << translation_arg("translate-gid", config.gid_mappings);
+}
+
+mp::logging::Level mp::VirtiofsdProcessSpec::error_log_level() const
+{
+    return mp::logging::Level::debug;
+}
+
+QString mp::VirtiofsdProcessSpec::apparmor_profile() const
+{
+    QString profile_template(R"END(
+#include <tunables/global>
+profile %1 flags=(attach_disconnected) {
+  #include <abstractions/base>
+  #include <abstractions/nameservice>
+
+  # Required for reading and searching host directories
+  capability dac_override,
+  capability dac_read_search,
+  # Enables modifying of file ownership and permissions
+  capability chown,
+  capability fsetid,
+  capability fowner,
+  capability mknod,
+  # Needed to switch credentials per request and to sandbox itself
+  capability setuid,
+  capability setgid,
+  capability sys_chroot,
+  capability sys_resource,
+
+  # Allow multipassd send virtiofsd signals
+  signal (receive) peer=%2,
+
+  # binary and its libs
+  %3 ixr,
+  %4/{usr/,}lib/** rm,
+
+  # CLASSIC ONLY: need to specify required libs from core snap
+  /{,var/lib/snapd/}snap/core18/*/{,usr/}lib/@{multiarch}/{,**/}*.so* rm,
+
+  # the socket QEMU connects to
+  %5 rw,
+
+  # allow full access just to this user-specified source directory on the host
+  %6/ rw,
+  %6/** rwlk,
+}
+    )END");
+
+    /* Customisations depending on if running inside snap or not */
+    QString root_dir;    // root directory: either "" or $SNAP
+    QString signal_peer; // who can send kill signal to virtiofsd
+
+    try
+    {
+        root_dir = mpu::snap_dir();
+        signal_peer = "snap.multipass.multipassd"; // only multipassd can send virtiofsd signals
+    }
+    catch (const mp::SnapEnvironmentException&)
+    {
+        signal_peer = "unconfined";
+    }
+
+    return profile_template.arg(apparmor_profile_name(),
+                                signal_peer,
+                                program(),
+                                root_dir,
+                                config.socket_path,
+                                QString::fromStdString(config.source_path));
+}
+
+QString mp::VirtiofsdProcessSpec::identifier() const
+{
+    return QString::fromStdString(config.instance + "." + config.tag);
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <multipass/id_mappings.h>
+#include <multipass/process/process_spec.h>
+
+#include <string>
+
+namespace multipass
+{
+
+struct VirtiofsdConfig
+{
+    std::string instance;
+    std::string tag;
+    std::string source_path;
+    QString socket_path;
+    QString cache_mode;
+    id_mappings gid_mappings;
+    id_mappings uid_mappings;
+};
+
+class VirtiofsdProcessSpec : public ProcessSpec
+{
+public:
+    explicit VirtiofsdProcessSpec(const VirtiofsdConfig& config);
+
+    QString program() const override;
+    QStringList arguments() const override;
+    logging::Level error_log_level() const override;
+
+    QString apparmor_profile() const override;
+    QString identifier() const override;
+
+private:
+    const VirtiofsdConfig config;
+};
+
+} // namespace multipass
@@ -56,6 +56,15 @@ constexpr auto head_filename = "snapshot-head";
 constexpr auto count_filename = "snapshot-count";
 constexpr auto yes_overwrite = true;
 
+// Waits in the instance for cloud-init to finish, for less than the SSH exit code timeout. The
+// bound is a plain shell counter, since not every image has coreutils' timeout.
+constexpr auto cloud_init_wait_command =
+    "sh -c 'i=0; until [ -e /var/lib/cloud/instance/boot-finished ]; do "
+    "[ $i -lt 40 ] || exit 1; i=$((i + 1)); sleep 0.1; done'";
+
+// Spares listing instances a round trip over SSH to each of them every time
+constexpr auto ipv4_cache_ttl = 10s;
+
 void assert_vm_stopped(St state)
 {
     assert(state == St::off || state == St::stopped);
@@ -93,6 +102,8 @@ std::optional<mp::SSHSession> wait_until_ssh_up_helper(mp::VirtualMachine* virtu
                                                        const mp::SSHKeyProvider& key_provider)
 {
     static constexpr auto wait_step = 1s;
+    // Attempts that fail because SSH is not listening yet are cheap, so retry them more often
+    static constexpr auto retry_interval = 250ms;
     mpl::log(mpl::Level::debug, virtual_machine->vm_name, "Waiting for SSH to be up");
 
     std::optional<mp::SSHSession> session = std::nullopt;
@@ -133,7 +144,7 @@ std::optional<mp::SSHSession> wait_until_ssh_up_helper(mp::VirtualMachine* virtu
             fmt::format("{}: timed out waiting for response", virtual_machine->vm_name));
     };
 
-    mp::utils::try_action_for(on_timeout, timeout, action);
+    mp::utils::try_action_every(retry_interval, on_timeout, timeout, action);
     return session;
 }
 } // namespace
@@ -249,14 +260,18 @@ std::string mp::BaseVirtualMachine::ssh_exec(const std::string& cmd, bool whispe
             lock.lock();
         }
 
+        // The session runs commands concurrently, so it is not kept locked while this one runs
+        const auto session = ssh_session;
+        lock.unlock();
+
         try
         {
-            return MP_UTILS.run_in_ssh_session(*ssh_session, cmd, whisper);
+            return MP_UTILS.run_in_ssh_session(*session, cmd, whisper);
         }
         catch (const SSHException& e)
         {
-            assert(ssh_session);
-            if (ssh_session->is_connected() || !reconnect)
+            lock.lock();
+            if (session->is_connected() || !reconnect)
                 throw;
 
             log_details = e.what();
@@ -280,28 +295,59 @@ void mp::BaseVirtualMachine::renew_ssh_session()
              vm_name,
              fmt::format("{} SSH session", ssh_session ? "Renewing cached" : "Caching new"));
 
-    ssh_session.emplace(ssh_hostname(), ssh_port(), ssh_username(), key_provider);
+    invalidate_ipv4_cache(); // the instance may have rebooted
+
+    auto session =
+        std::make_shared<SSHSession>(ssh_hostname(), ssh_port(), ssh_username(), key_provider);
+
+    const std::unique_lock lock{state_mutex};
+    ssh_session = std::move(session);
 }
 
 void mp::BaseVirtualMachine::wait_until_ssh_up(std::chrono::milliseconds timeout)
 {
     drop_ssh_session();
-    ssh_session = wait_until_ssh_up_helper(this, timeout, key_provider);
+    if (auto session = wait_until_ssh_up_helper(this, timeout, key_provider))
+        ssh_session = std::make_shared<SSHSession>(std::move(*session));
     mpl::log(logging::Level::debug, vm_name, "Caching initial SSH session");
 }
 
 void mp::BaseVirtualMachine::wait_for_cloud_init(std::chrono::milliseconds timeout)
 {
-    auto action = [this] {
+    // The wait happens in the instance, so that we hear back as soon as cloud-init is done. It
+    // uses a session of its own, to avoid holding the state lock in the meantime.
+    std::optional<SSHSession> session;
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+
+    auto action = [this, &session, deadline] {
         ensure_vm_is_running();
         try
         {
-            ssh_exec("[ -e /var/lib/cloud/instance/boot-finished ]");
-            return mp::utils::TimeoutAction::done;
+            if (!session || !session->is_connected())
+                session.emplace(ssh_hostname(), ssh_port(), ssh_username(), key_provider);
+
+            do
+            {
+                const auto attempt_start = std::chrono::steady_clock::now();
+                try
+                {
+                    MP_UTILS.run_in_ssh_session(*session, cloud_init_wait_command);
+                    return mp::utils::TimeoutAction::done;
+                }
+                catch (const SSHExecFailure& e)
+                {
+                    // Only a wait that ran its course means cloud-init is still going, and we can
+                    // wait again right away. Quicker failures are retried at the usual pace.
+                    if (std::chrono::steady_clock::now() - attempt_start < 1s)
+                        return mp::utils::TimeoutAction::retry;
+                }
+            } while (std::chrono::steady_clock::now() < deadline);
+
+            return mp::utils::TimeoutAction::retry;
         }
-        catch (const SSHExecFailure& e)
+        catch (const SSHException& e)
         {
-            return mp::utils::TimeoutAction::retry;
+            return log_and_retry(e, this);
         }
         catch (const std::exception& e) // transitioning away from catching generic runtime errors
         {                               // TODO remove once we're confident this is an anomaly
@@ -322,6 +368,15 @@ std::vector<std::string> mp::BaseVirtualMachine::get_all_ipv4()
 
     if (MP_UTILS.is_running(current_state()))
     {
+        std::uint64_t generation;
+        {
+            const std::lock_guard lock{ipv4_cache_mutex};
+            if (cached_ipv4 && std::chrono::steady_clock::now() < cached_ipv4_expiry)
+                return *cached_ipv4;
+
+            generation = ipv4_cache_generation;
+        }
+
         try
         {
             auto ip_a_output = QString::fromStdString(
@@ -339,6 +394,13 @@ std::vector<std::string> mp::BaseVirtualMachine::get_all_ipv4()
 
                 all_ipv4.push_back(ip);
             }
+
+            const std::lock_guard lock{ipv4_cache_mutex};
+            if (generation == ipv4_cache_generation)
+            {
+                cached_ipv4 = all_ipv4;
+                cached_ipv4_expiry = std::chrono::steady_clock::now() + ipv4_cache_ttl;
+            }
         }
         catch (const SSHException& e)
         {
@@ -444,7 +506,13 @@ std::shared_ptr<const mp::Snapshot> mp::BaseVirtualMachine::take_snapshot(
     require_snapshots_support();
 
     std::unique_lock lock{snapshot_mutex};
-    assert_vm_stopped(state); // precondition
+    assert(state == St::off || state == St::stopped ||
+           (state == St::running && supports_live_snapshots())); // precondition
+
+    // Live snapshots capture disks only, so restoring them leaves the instance stopped
+    auto snapshot_specs = specs;
+    if (state == St::running)
+        snapshot_specs.state = St::stopped;
 
     auto sname = snapshot_name.empty() ? generate_snapshot_name() : snapshot_name;
 
@@ -463,7 +531,7 @@ std::shared_ptr<const mp::Snapshot> mp::BaseVirtualMachine::take_snapshot(
         make_specific_snapshot(sname,
                                comment,
                                get_instance_id_from_the_cloud_init(),
-                               specs,
+                               snapshot_specs,
                                head_snapshot);
     ret->capture();
 
@@ -838,8 +906,18 @@ std::shared_ptr<mp::Snapshot> mp::BaseVirtualMachine::make_specific_snapshot(
     throw NotImplementedOnThisBackendException{"snapshots"};
 }
 
+void mp::BaseVirtualMachine::invalidate_ipv4_cache()
+{
+    const std::lock_guard lock{ipv4_cache_mutex};
+    cached_ipv4.reset();
+    ++ipv4_cache_generation;
+}
+
+// Sessions are dropped when instances stop, suspend or restart, so the addresses go with them
 void mp::BaseVirtualMachine::drop_ssh_session()
 {
+    invalidate_ipv4_cache();
+
     if (ssh_session)
     {
         mpl::log(mpl::Level::debug, vm_name, "Dropping cached SSH session");
@@ -28,6 +28,8 @@
 #include <QRegularExpression>
 #include <QString>
 
+#include <chrono>
+#include <cstdint>
 #include <memory>
 #include <mutex>
 #include <optional>
@@ -75,6 +77,8 @@ public:
     std::shared_ptr<Snapshot> get_snapshot(const std::string& name) override;
     std::shared_ptr<Snapshot> get_snapshot(int index) override;
 
+    bool supports_live_snapshots() const override;
+
     // TODO: the VM should know its directory, but that is true of everything in its VMDescription;
     // pulling that from derived classes is a big refactor
     std::shared_ptr<const Snapshot> take_snapshot(const VMSpecs& specs,
@@ -97,6 +101,7 @@ protected:
                                                              std::shared_ptr<Snapshot> parent);
     virtual void drop_ssh_session(); // virtual to allow mocking
     void renew_ssh_session();
+    void invalidate_ipv4_cache();
 
     virtual void add_extra_interface_to_instance_cloud_init(
         const std::string& default_mac_addr,
@@ -161,7 +166,11 @@ protected:
     const SSHKeyProvider& key_provider;
 
 private:
-    std::optional<SSHSession> ssh_session = std::nullopt;
+    std::shared_ptr<SSHSession> ssh_session; // shared with the commands running on it
+    std::optional<std::vector<std::string>> cached_ipv4;
+    std::chrono::steady_clock::time_point cached_ipv4_expiry;
+    std::uint64_t ipv4_cache_generation = 0; // bumped on invalidation, to discard lookups in flight
+    std::mutex ipv4_cache_mutex;
     SnapshotMap snapshots;
     std::shared_ptr<Snapshot> head_snapshot = nullptr;
     int snapshot_count = 0; // tracks the number of snapshots ever taken (regardless of deletes)
@@ -183,6 +192,11 @@ inline int multipass::BaseVirtualMachine::get_snapshot_count() const
     return snapshot_count;
 }
 
+inline bool multipass::BaseVirtualMachine::supports_live_snapshots() const
+{
+    return false;
+}
+
 inline void multipass::BaseVirtualMachine::require_snapshots_support() const
 {
     throw NotImplementedOnThisBackendException{"snapshots"};
@@ -19,6 +19,7 @@
 
 #include <multipass/constants.h>
 #include <multipass/format.h>
+#include <multipass/logging/trace.h>
 #include <multipass/memory_size.h>
 #include <multipass/platform.h>
 #include <multipass/process/qemuimg_process_spec.h>
@@ -30,6 +31,7 @@
 #include <QStringList>
 
 namespace mp = multipass;
+namespace mpl = multipass::logging;
 namespace mpp = multipass::platform;
 
 auto mp::backend::checked_exec_qemu_img(std::unique_ptr<mp::QemuImgProcessSpec> spec,
@@ -52,6 +54,8 @@ auto mp::backend::checked_exec_qemu_img(std::unique_ptr<mp::QemuImgProcessSpec>
 
 void mp::backend::resize_instance_image(const MemorySize& disk_space, const mp::Path& image_path)
 {
+    const mpl::TraceSpan span{"resize_instance_image"};
+
     auto disk_size = QString::number(
         disk_space.in_bytes()); // format documented in `man qemu-img` (look for "size")
     QStringList qemuimg_parameters{{"resize", image_path, disk_size}};
@@ -64,6 +68,8 @@ void mp::backend::resize_instance_image(const MemorySize& disk_space, const mp::
 
 mp::Path mp::backend::convert_to_qcow_if_necessary(const mp::Path& image_path)
 {
+    const mpl::TraceSpan span{"convert_to_qcow"};
+
     // Check if raw image file, and if so, convert to qcow2 format.
     // TODO: we could support converting from other the image formats that qemu-img can deal with
     const auto qcow2_path{image_path + ".qcow2"};
@@ -23,6 +23,7 @@
 #include <multipass/virtual_machine.h>
 
 #include <chrono>
+#include <mutex>
 #include <string>
 
 namespace multipass
@@ -36,31 +37,40 @@ std::string ip_address_for(VirtualMachine* virtual_machine,
                            Callable&& get_ip,
                            std::chrono::milliseconds timeout)
 {
-    if (!virtual_machine->management_ip)
     {
-        auto action = [virtual_machine, get_ip] {
-            virtual_machine->ensure_vm_is_running();
-            auto result = get_ip();
-            if (result)
-            {
+        std::lock_guard<std::mutex> lock{virtual_machine->management_ip_mutex};
+        if (virtual_machine->management_ip)
+            return virtual_machine->management_ip->as_string();
+    }
+
+    // The lookup runs unlocked, not to hold up others while waiting
+    std::string ip;
+    auto action = [virtual_machine, get_ip, &ip] {
+        virtual_machine->ensure_vm_is_running();
+        auto result = get_ip();
+        if (result)
+        {
+            std::lock_guard<std::mutex> lock{virtual_machine->management_ip_mutex};
+            if (!virtual_machine->management_ip)
                 virtual_machine->management_ip.emplace(*result);
-                return utils::TimeoutAction::done;
-            }
-            else
-            {
-                return utils::TimeoutAction::retry;
-            }
-        };
 
-        auto on_timeout = [virtual_machine, &timeout] {
-            virtual_machine->state = VirtualMachine::State::unknown;
-            throw InternalTimeoutException{"determine IP address", timeout};
-        };
+            ip = virtual_machine->management_ip->as_string();
+            return utils::TimeoutAction::done;
+        }
+        else
+        {
+            return utils::TimeoutAction::retry;
+        }
+    };
 
-        utils::try_action_for(on_timeout, timeout, action);
-    }
+    auto on_timeout = [virtual_machine, &timeout] {
+        virtual_machine->state = VirtualMachine::State::unknown;
+        throw InternalTimeoutException{"determine IP address", timeout};
+    };
+
+    utils::try_action_for(on_timeout, timeout, action);
 
-    return virtual_machine->management_ip->as_string();
+    return ip;
 }
 
 template <typename Callable>
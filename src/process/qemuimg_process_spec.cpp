@@ -19,9 +19,50 @@
 #include <multipass/process/qemuimg_process_spec.h>
 #include <multipass/snap_utils.h>
 
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QtEndian>
+
 namespace mp = multipass;
 namespace mpu = multipass::utils;
 
+namespace
+{
+constexpr auto max_backing_chain = 16;  // enough for any image we create, and guards against loops
+constexpr auto max_backing_name = 1023; // as per the qcow2 specification
+
+QString backing_image_of(const QString& image_path)
+{
+    // The qcow2 header starts with the magic, the version and the offset and size of the backing
+    // file name, all big-endian
+    QFile image{image_path};
+    if (!image.open(QIODevice::ReadOnly))
+        return {};
+
+    const auto header = image.read(20);
+    if (header.size() < 20 || !header.startsWith("QFI\xfb"))
+        return {};
+
+    const auto name_offset = qFromBigEndian<quint64>(header.constData() + 8);
+    const auto name_size = qFromBigEndian<quint32>(header.constData() + 16);
+    if (!name_offset || !name_size || name_size > max_backing_name || !image.seek(name_offset))
+        return {};
+
+    const auto name = QString::fromUtf8(image.read(name_size));
+    return name.isEmpty() ? name : QFileInfo{image_path}.absoluteDir().absoluteFilePath(name);
+}
+
+QString read_only_rules_for_backing_images_of(const QString& image_path)
+{
+    QString rules;
+    for (const auto& backing_image : mp::QemuImgProcessSpec::backing_images_of(image_path))
+        rules.append(QString("  %1 rk,\n").arg(backing_image));
+
+    return rules;
+}
+} // namespace
+
 mp::QemuImgProcessSpec::QemuImgProcessSpec(const QStringList& args,
                                            const QString& source_image,
                                            const QString& target_image)
@@ -84,11 +125,28 @@ profile %1 flags=(attach_disconnected) {
     }
 
     if (!source_image.isEmpty())
+    {
         images.append(QString("  %1 rwk,\n").arg(source_image)); // allow amending to qcow2 v3
+        images.append(read_only_rules_for_backing_images_of(source_image));
+    }
 
     if (!target_image.isEmpty())
+    {
         images.append(QString("  %1 rwk,\n").arg(target_image));
+        images.append(read_only_rules_for_backing_images_of(target_image));
+    }
 
     return profile_template
         .arg(apparmor_profile_name(), extra_capabilities, root_dir, program(), images, signal_peer);
 }
+
+QStringList mp::QemuImgProcessSpec::backing_images_of(const QString& image_path)
+{
+    QStringList ret;
+    for (auto image = backing_image_of(image_path);
+         !image.isEmpty() && !ret.contains(image) && ret.size() < max_backing_chain;
+         image = backing_image_of(image))
+        ret.append(image);
+
+    return ret;
+}
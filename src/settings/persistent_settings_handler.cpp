@@ -22,6 +22,10 @@
 #include <multipass/logging/log.h>
 #include <multipass/settings/persistent_settings_handler.h>
 
+#include <QCoreApplication>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+
 #include <cassert>
 
 namespace mp = multipass;
@@ -60,11 +64,8 @@ void check_status(const mp::WrappedQSettings& qsettings, const QString& attempte
 
 QString checked_get(mp::WrappedQSettings& qsettings,
                     const QString& key,
-                    const mp::SettingSpec& spec,
-                    std::mutex& mutex)
+                    const mp::SettingSpec& spec)
 {
-    std::lock_guard<std::mutex> lock{mutex};
-
     const auto& fallback = spec.get_default();
     auto ret = qsettings.value(key, fallback).toString();
 
@@ -88,13 +89,8 @@ QString checked_get(mp::WrappedQSettings& qsettings,
     return ret;
 }
 
-void checked_set(mp::WrappedQSettings& qsettings,
-                 const QString& key,
-                 const QString& val,
-                 std::mutex& mutex)
+void checked_set(mp::WrappedQSettings& qsettings, const QString& key, const QString& val)
 {
-    std::lock_guard<std::mutex> lock{mutex};
-
     qsettings.setValue(key, val);
 
     qsettings.sync(); // flush to confirm we can write
@@ -104,17 +100,33 @@ void checked_set(mp::WrappedQSettings& qsettings,
 
 mp::PersistentSettingsHandler::PersistentSettingsHandler(QString filename,
                                                          SettingSpec::Set settings)
-    : filename{std::move(filename)}, settings{convert(std::move(settings))}
+    : filename{std::move(filename)},
+      settings{convert(std::move(settings))},
+      snapshot{std::make_shared<const Snapshot>()}
 {
+    watch_file();
 }
 
+mp::PersistentSettingsHandler::~PersistentSettingsHandler() = default;
+
 // TODO try installing yaml backend
 QString mp::PersistentSettingsHandler::get(const QString& key) const
 {
     const auto& setting_spec =
         get_setting(key); // make sure the key is valid before reading from disk
+
+    if (const auto current = std::atomic_load(&snapshot); current->count(key))
+        return current->at(key);
+
+    std::lock_guard<std::mutex> lock{mutex};
+    if (snapshot->count(key)) // someone else got here first
+        return snapshot->at(key);
+
     auto settings_file = persistent_settings(filename);
-    return checked_get(*settings_file, key, setting_spec, mutex);
+    auto ret = checked_get(*settings_file, key, setting_spec);
+    publish(key, ret);
+
+    return ret;
 }
 
 auto mp::PersistentSettingsHandler::get_setting(const QString& key) const -> const SettingSpec&
@@ -136,8 +148,17 @@ void mp::PersistentSettingsHandler::set(const QString& key, const QString& val)
     auto interpreted = get_setting(key).interpret(
         val); // check both key and value validity, convert as appropriate
 
-    auto settings_file = persistent_settings(filename);
-    checked_set(*settings_file, key, interpreted, mutex);
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        auto settings_file = persistent_settings(filename);
+        checked_set(*settings_file, key, interpreted);
+        publish(key, interpreted);
+    }
+
+    if (watcher) // the file (or even its directory) may have just been created
+        QMetaObject::invokeMethod(watcher.get(), [this] { watch_paths(); });
+
+    notify({{key, interpreted}});
 }
 
 std::set<QString> mp::PersistentSettingsHandler::keys() const
@@ -152,6 +173,95 @@ std::set<QString> mp::PersistentSettingsHandler::keys() const
     return ret;
 }
 
+void mp::PersistentSettingsHandler::subscribe(Observer observer)
+{
+    std::lock_guard<std::mutex> lock{observers_mutex};
+    observers.push_back(std::move(observer));
+}
+
+void mp::PersistentSettingsHandler::publish(const QString& key, const QString& val) const
+{
+    auto next = std::make_shared<Snapshot>(*snapshot);
+    (*next)[key] = val;
+
+    std::atomic_store(&snapshot, std::shared_ptr<const Snapshot>{std::move(next)});
+}
+
+void mp::PersistentSettingsHandler::watch_file()
+{
+    if (!QCoreApplication::instance())
+        return; // no event loop to tell us about changes, so we keep to our own
+
+    watcher = std::make_unique<QFileSystemWatcher>();
+    QObject::connect(watcher.get(), &QFileSystemWatcher::fileChanged, [this] { reload(); });
+    QObject::connect(watcher.get(), &QFileSystemWatcher::directoryChanged, [this] { reload(); });
+
+    watch_paths();
+}
+
+void mp::PersistentSettingsHandler::watch_paths()
+{
+    /* QSettings saves by replacing the file, which drops it from the watcher, so we also watch the
+       directory to find out about the new file */
+    for (const auto& path : {QFileInfo{filename}.absolutePath(), filename})
+        if (QFileInfo::exists(path) && !watcher->files().contains(path) &&
+            !watcher->directories().contains(path))
+            watcher->addPath(path);
+}
+
+void mp::PersistentSettingsHandler::reload()
+{
+    watch_paths();
+
+    Snapshot changes;
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        if (snapshot->empty())
+            return;
+
+        auto next = std::make_shared<Snapshot>();
+        try
+        {
+            auto settings_file = persistent_settings(filename);
+            for (const auto& [key, val] : *snapshot)
+            {
+                auto fresh = checked_get(*settings_file, key, get_setting(key));
+                if (fresh != val)
+                    changes.emplace(key, fresh);
+
+                next->emplace(key, std::move(fresh));
+            }
+        }
+        catch (const PersistentSettingsException& e)
+        {
+            mpl::log(mpl::Level::warning,
+                     "settings",
+                     fmt::format("Could not reload settings: {}", e.what()));
+            next->clear(); // leave it to the next reads to find out and report
+        }
+
+        std::atomic_store(&snapshot, std::shared_ptr<const Snapshot>{std::move(next)});
+    }
+
+    notify(changes);
+}
+
+void mp::PersistentSettingsHandler::notify(const Snapshot& changes)
+{
+    if (changes.empty())
+        return;
+
+    std::vector<Observer> current_observers;
+    {
+        std::lock_guard<std::mutex> lock{observers_mutex};
+        current_observers = observers;
+    }
+
+    for (const auto& [key, val] : changes)
+        for (const auto& observer : current_observers)
+            observer(key, val);
+}
+
 auto mp::PersistentSettingsHandler::convert(SettingSpec::Set settings) -> SettingMap
 {
     SettingMap ret;
@@ -82,13 +82,25 @@ QMap<QString, const mp::VMImageInfo*> qmap_aliases_to_vm_info_for(
     return map;
 }
 
+QMultiMap<QString, const mp::VMImageInfo*> qmultimap_ids_to_vm_info_for(
+    const std::vector<mp::VMImageInfo>& images)
+{
+    QMultiMap<QString, const mp::VMImageInfo*> map;
+
+    for (const auto& image : images)
+        map.insert(image.id, &image);
+
+    return map;
+}
+
 } // namespace
 
 mp::SimpleStreamsManifest::SimpleStreamsManifest(const QString& updated_at,
                                                  std::vector<VMImageInfo>&& images)
     : updated_at{updated_at},
       products{std::move(images)},
-      image_records{qmap_aliases_to_vm_info_for(products)}
+      image_records{qmap_aliases_to_vm_info_for(products)},
+      images_by_id{qmultimap_ids_to_vm_info_for(products)}
 {
 }
 
@@ -25,11 +25,15 @@
 #include <multipass/ssh/throw_on_error.h>
 #include <multipass/utils.h>
 
+#include <scope_guard.hpp>
+
 #include <array>
+#include <deque>
 #include <fcntl.h>
 #include <fmt/std.h>
 
 constexpr int file_mode = 0664;
+constexpr std::size_t max_requests_in_flight = 16;
 const std::string stream_file_name{"stream_output.dat"};
 const char* log_category = "sftp";
 
@@ -377,15 +381,44 @@ void SFTPClient::do_push_file(std::istream& source, const fs::path& target_path)
                         target_path,
                         ssh_get_error(sftp->session)};
 
-    // create an uninitialized buffer to use.
+    // create an uninitialized buffer to use. libssh copies it into the request, so it can be reused
+    // as soon as a write is sent.
     const auto max_write = sftp_limits(sftp.get())->max_write_length;
     const std::unique_ptr<char[]> buffer{new char[max_write]};
 
+    // keep a window of writes in flight, so that throughput is not bound by the round trip time
+    std::deque<sftp_aio> in_flight;
+    auto free_in_flight = sg::make_scope_guard([&in_flight]() noexcept {
+        for (auto aio : in_flight)
+            sftp_aio_free(aio);
+    });
+
+    auto wait_for_oldest_write = [&] {
+        auto aio = in_flight.front();
+        in_flight.pop_front();
+
+        if (sftp_aio_wait_write(&aio) < 0)
+            throw SFTPError{"cannot write to remote file {}: {}",
+                            target_path,
+                            ssh_get_error(sftp->session)};
+    };
+
     while (auto r = source.read(buffer.get(), max_write).gcount())
-        if (sftp_write(remote_file.get(), buffer.get(), r) < 0)
+    {
+        if (in_flight.size() == max_requests_in_flight)
+            wait_for_oldest_write();
+
+        sftp_aio aio{};
+        if (sftp_aio_begin_write(remote_file.get(), buffer.get(), r, &aio) < 0)
             throw SFTPError{"cannot write to remote file {}: {}",
                             target_path,
                             ssh_get_error(sftp->session)};
+
+        in_flight.push_back(aio);
+    }
+
+    while (!in_flight.empty())
+        wait_for_oldest_write();
 }
 
 void SFTPClient::do_pull_file(const fs::path& source_path, std::ostream& target)
@@ -400,14 +433,55 @@ void SFTPClient::do_pull_file(const fs::path& source_path, std::ostream& target)
     const auto max_read = sftp_limits(sftp.get())->max_read_length;
     const std::unique_ptr<char[]> buffer{new char[max_read]};
 
-    while (auto r = sftp_read(remote_file.get(), buffer.get(), max_read))
-    {
+    // keep a window of reads in flight, so that throughput is not bound by the round trip time
+    std::deque<sftp_aio> in_flight;
+    auto free_in_flight = sg::make_scope_guard([&in_flight]() noexcept {
+        for (auto aio : in_flight)
+            sftp_aio_free(aio);
+    });
+
+    auto wait_for_oldest_read = [&] {
+        auto aio = in_flight.front();
+        in_flight.pop_front();
+
+        auto r = sftp_aio_wait_read(&aio, buffer.get(), max_read);
         if (r < 0)
             throw SFTPError{"cannot read from remote file {}: {}",
                             source_path,
                             ssh_get_error(sftp->session)};
 
+        return static_cast<uint64_t>(r);
+    };
+
+    uint64_t offset = 0;
+    auto eof = false;
+    while (!eof)
+    {
+        while (in_flight.size() < max_requests_in_flight)
+        {
+            sftp_aio aio{};
+            if (sftp_aio_begin_read(remote_file.get(), max_read, &aio) < 0)
+                throw SFTPError{"cannot read from remote file {}: {}",
+                                source_path,
+                                ssh_get_error(sftp->session)};
+
+            in_flight.push_back(aio);
+        }
+
+        auto r = wait_for_oldest_read();
         target.write(buffer.get(), r);
+        offset += r;
+
+        // The later requests were made at offsets past what a short read returned, so drop them;
+        // either this was the end of the file, or reading resumes from where the data stopped
+        if (r < max_read)
+        {
+            while (!in_flight.empty())
+                wait_for_oldest_read();
+
+            eof = r == 0;
+            sftp_seek64(remote_file.get(), offset);
+        }
     }
 }
 
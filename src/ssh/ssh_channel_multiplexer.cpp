@@ -0,0 +1,256 @@
+/*
+ * Copyright (C) Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "ssh_channel_multiplexer.h"
+
+#include <multipass/exceptions/exitless_sshprocess_exceptions.h>
+#include <multipass/exceptions/ssh_exception.h>
+#include <multipass/format.h>
+#include <multipass/ssh/throw_on_error.h>
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+
+namespace mp = multipass;
+
+namespace
+{
+// Channels are polled without waiting, to leave the session free for others in between
+constexpr auto poll_interval = std::chrono::milliseconds{10};
+
+void exit_status_cb(ssh_session, ssh_channel, int exit_status, void* userdata)
+{
+    *static_cast<std::optional<int>*>(userdata) = exit_status;
+}
+
+// Appends what is available in the given stream, waiting up to the timeout for it
+void read_stream(ssh_channel channel,
+                 const std::string& cmd,
+                 bool is_std_err,
+                 int timeout,
+                 std::string& output)
+{
+    if (ssh_channel_is_closed(channel))
+        return;
+
+    std::array<char, 4096> buffer;
+    int num_bytes{0};
+    do
+    {
+        num_bytes =
+            ssh_channel_read_timeout(channel, buffer.data(), buffer.size(), is_std_err, timeout);
+        if (num_bytes < 0)
+        {
+            if (ssh_channel_is_closed(channel))
+                return;
+
+            throw mp::SSHException(
+                fmt::format("error while reading ssh channel for remote process '{}' - error: {}",
+                            cmd,
+                            num_bytes));
+        }
+        output.append(buffer.data(), num_bytes);
+    } while (num_bytes > 0);
+}
+} // namespace
+
+mp::SSHChannelMultiplexer::SSHChannelMultiplexer(ssh_session session, std::mutex& session_mutex)
+    : session{session}, session_mutex{session_mutex}, loop{[this] { run(); }}
+{
+}
+
+mp::SSHChannelMultiplexer::~SSHChannelMultiplexer()
+{
+    {
+        std::lock_guard lock{queue_mutex};
+        stopping = true;
+    }
+
+    queue_cv.notify_one();
+    loop.join();
+}
+
+std::future<mp::SSHCommandResult> mp::SSHChannelMultiplexer::exec(
+    const std::string& cmd,
+    std::chrono::milliseconds timeout)
+{
+    std::promise<SSHCommandResult> promise;
+    auto future = promise.get_future();
+
+    {
+        std::lock_guard lock{queue_mutex};
+        queue.push_back({cmd, timeout, std::move(promise)});
+    }
+
+    queue_cv.notify_one();
+    return future;
+}
+
+void mp::SSHChannelMultiplexer::run()
+{
+    std::unique_ptr<ssh_event_struct, decltype(ssh_event_free)*> event{ssh_event_new(),
+                                                                       ssh_event_free};
+
+    // The session is only in the event while there are channels to drive. Others that poll the
+    // session themselves, like SSHProcess waiting for an exit status, fail while it is in there.
+    auto session_in_event = false;
+    auto update_event = [this, &event, &session_in_event] {
+        if (running.empty() == session_in_event)
+        {
+            if (session_in_event)
+                ssh_event_remove_session(event.get(), session);
+            else
+                ssh_event_add_session(event.get(), session);
+
+            session_in_event = !session_in_event;
+        }
+    };
+
+    while (true)
+    {
+        std::vector<PendingCommand> new_commands;
+        {
+            std::unique_lock lock{queue_mutex};
+            auto ready = [this] { return stopping || !queue.empty(); };
+            if (running.empty())
+                queue_cv.wait(lock, ready);
+            else
+                queue_cv.wait_for(lock, poll_interval, ready);
+
+            if (stopping)
+            {
+                for (auto& command : queue)
+                    command.promise.set_exception(std::make_exception_ptr(SSHException{
+                        fmt::format("SSH session closed before running '{}'", command.cmd)}));
+                break;
+            }
+
+            new_commands.swap(queue);
+        }
+
+        std::lock_guard lock{session_mutex};
+        for (auto& command : new_commands)
+            start(command);
+
+        update_event();
+        poll(event.get());
+        update_event();
+    }
+
+    std::lock_guard lock{session_mutex};
+    fail_all(std::make_exception_ptr(SSHException{"SSH session closed"}));
+    update_event();
+}
+
+void mp::SSHChannelMultiplexer::start(PendingCommand& command)
+{
+    try
+    {
+        if (!ssh_is_connected(session))
+            throw SSHException(fmt::format("unable to create a channel for remote process: '{}', "
+                                           "the SSH session is not connected",
+                                           command.cmd));
+
+        ChannelUPtr channel{ssh_channel_new(session), ssh_channel_free};
+        SSH::throw_on_error(channel,
+                            session,
+                            "[ssh mux] failed to open session channel",
+                            ssh_channel_open_session);
+        SSH::throw_on_error(channel,
+                            session,
+                            "[ssh mux] exec request failed",
+                            ssh_channel_request_exec,
+                            command.cmd.c_str());
+
+        auto& running_command = running.emplace_back(command, std::move(channel));
+        ssh_callbacks_init(&running_command.callbacks);
+        running_command.callbacks.userdata = &running_command.exit_status;
+        running_command.callbacks.channel_exit_status_function = exit_status_cb;
+        ssh_add_channel_callbacks(running_command.channel.get(), &running_command.callbacks);
+    }
+    catch (...)
+    {
+        command.promise.set_exception(std::current_exception());
+    }
+}
+
+void mp::SSHChannelMultiplexer::poll(ssh_event event)
+{
+    if (running.empty())
+        return;
+
+    const auto rc = ssh_event_dopoll(event, 0);
+    const auto error = rc == SSH_ERROR ? std::strerror(errno) : "";
+    const auto now = std::chrono::steady_clock::now();
+
+    for (auto it = running.begin(); it != running.end();)
+    {
+        auto& command = *it;
+        try
+        {
+            if (!command.exit_status && rc == SSH_ERROR)
+                throw SSHProcessExitError{command.cmd, error};
+
+            // Keep reading while the process runs, so that its output does not fill the window
+            const auto channel = command.channel.get();
+            auto& result = command.result;
+            read_stream(channel, command.cmd, false, 0, result.std_output);
+            read_stream(channel, command.cmd, true, 0, result.std_error);
+
+            if (command.exit_status)
+            {
+                // Output can trail the exit status. The end of it is polled for like the rest,
+                // rather than waited for with the session locked, and not past the deadline.
+                const auto at_end = ssh_channel_is_eof(channel) || ssh_channel_is_closed(channel);
+                if (!at_end && rc != SSH_ERROR && now < command.deadline)
+                {
+                    ++it;
+                    continue;
+                }
+
+                result.exit_code = *command.exit_status;
+                command.promise.set_value(std::move(result));
+            }
+            else if (now >= command.deadline)
+                throw SSHProcessTimeoutException{command.cmd, command.timeout};
+            else
+            {
+                ++it;
+                continue;
+            }
+        }
+        catch (...)
+        {
+            command.promise.set_exception(std::current_exception());
+        }
+
+        ssh_remove_channel_callbacks(command.channel.get(), &command.callbacks);
+        it = running.erase(it);
+    }
+}
+
+void mp::SSHChannelMultiplexer::fail_all(std::exception_ptr error)
+{
+    for (auto& command : running)
+    {
+        command.promise.set_exception(error);
+        ssh_remove_channel_callbacks(command.channel.get(), &command.callbacks);
+    }
+
+    running.clear();
+}
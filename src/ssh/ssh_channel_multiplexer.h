@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <multipass/disabled_copy_move.h>
+#include <multipass/ssh/ssh_session.h>
+
+#include <libssh/callbacks.h>
+#include <libssh/libssh.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace multipass
+{
+// Runs commands concurrently over channels of a single SSH session. All the channels are driven
+// from one event loop, in a thread of its own, which only holds the session lock while polling.
+class SSHChannelMultiplexer : private DisabledCopyMove
+{
+public:
+    SSHChannelMultiplexer(ssh_session session, std::mutex& session_mutex);
+    ~SSHChannelMultiplexer(); // fails whatever is still pending
+
+    std::future<SSHCommandResult> exec(const std::string& cmd, std::chrono::milliseconds timeout);
+
+private:
+    struct PendingCommand
+    {
+        std::string cmd;
+        std::chrono::milliseconds timeout;
+        std::promise<SSHCommandResult> promise;
+    };
+
+    using ChannelUPtr = std::unique_ptr<ssh_channel_struct, void (*)(ssh_channel)>;
+
+    struct RunningCommand
+    {
+        RunningCommand(PendingCommand& command, ChannelUPtr channel)
+            : cmd{std::move(command.cmd)},
+              timeout{command.timeout},
+              deadline{std::chrono::steady_clock::now() + timeout},
+              promise{std::move(command.promise)},
+              channel{std::move(channel)}
+        {
+        }
+
+        std::string cmd;
+        std::chrono::milliseconds timeout;
+        std::chrono::steady_clock::time_point deadline;
+        std::promise<SSHCommandResult> promise;
+        ChannelUPtr channel;
+        ssh_channel_callbacks_struct callbacks{};
+        std::optional<int> exit_status;
+        SSHCommandResult result{};
+    };
+
+    void run();
+    void start(PendingCommand& command);
+    void poll(ssh_event event);
+    void fail_all(std::exception_ptr error);
+
+    ssh_session session;
+    std::mutex& session_mutex;
+
+    std::mutex queue_mutex;
+    std::condition_variable queue_cv;
+    std::vector<PendingCommand> queue;
+    bool stopping{false};
+
+    std::list<RunningCommand> running; // only touched by the loop, stable addresses for callbacks
+    std::thread loop;
+};
+} // namespace multipass
@@ -15,6 +15,8 @@
  *
  */
 
+#include "ssh_channel_multiplexer.h"
+
 #include <multipass/exceptions/ssh_exception.h>
 #include <multipass/format.h>
 #include <multipass/logging/log.h>
@@ -75,7 +77,7 @@ mp::SSHSession::SSHSession(const std::string& host,
 }
 
 multipass::SSHSession::SSHSession(multipass::SSHSession&& other)
-    : SSHSession(std::move(other), std::unique_lock{other.mut})
+    : SSHSession(std::move(other), other.lock_for_move())
 {
 }
 
@@ -88,6 +90,9 @@ multipass::SSHSession& multipass::SSHSession::operator=(multipass::SSHSession&&
 {
     if (this != &other)
     {
+        stop_multiplexer();
+        other.stop_multiplexer();
+
         std::scoped_lock lock{mut, other.mut};
         session = std::move(other.session);
     }
@@ -97,6 +102,8 @@ multipass::SSHSession& multipass::SSHSession::operator=(multipass::SSHSession&&
 
 multipass::SSHSession::~SSHSession()
 {
+    stop_multiplexer();
+
     std::unique_lock lock{mut};
     ssh_disconnect(session.get());
     force_shutdown(); // do we really need this?
@@ -110,6 +117,32 @@ mp::SSHProcess mp::SSHSession::exec(const std::string& cmd, bool whisper)
     return {session.get(), cmd, std::unique_lock{mut}};
 }
 
+std::future<mp::SSHCommandResult> mp::SSHSession::exec_async(const std::string& cmd,
+                                                             bool whisper,
+                                                             std::chrono::milliseconds timeout)
+{
+    auto lvl = whisper ? mpl::Level::trace : mpl::Level::debug;
+    mpl::log(lvl, "ssh session", fmt::format("Executing '{}'", cmd));
+
+    std::lock_guard lock{multiplexer_mutex};
+    if (!multiplexer)
+        multiplexer = std::make_unique<SSHChannelMultiplexer>(session.get(), mut);
+
+    return multiplexer->exec(cmd, timeout);
+}
+
+std::unique_lock<std::mutex> mp::SSHSession::lock_for_move()
+{
+    stop_multiplexer(); // it refers to the session being moved, and needs the lock to wind down
+    return std::unique_lock{mut};
+}
+
+void mp::SSHSession::stop_multiplexer()
+{
+    std::lock_guard lock{multiplexer_mutex};
+    multiplexer.reset();
+}
+
 void mp::SSHSession::force_shutdown()
 {
     auto socket = ssh_get_fd(session.get());
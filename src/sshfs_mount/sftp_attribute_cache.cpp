@@ -0,0 +1,259 @@
+/*
+ * Copyright (C) Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "sftp_attribute_cache.h"
+
+#include <multipass/format.h>
+#include <multipass/logging/log.h>
+
+#ifdef MULTIPASS_PLATFORM_LINUX
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include <cstring>
+
+namespace mp = multipass;
+namespace mpl = multipass::logging;
+
+namespace
+{
+constexpr auto category = "sftp server";
+constexpr auto max_watched_dirs = 4096u;
+
+std::string parent_of(const std::string& path)
+{
+    const auto pos = path.find_last_of('/');
+    if (pos == std::string::npos)
+        return {};
+
+    return pos == 0 ? "/" : path.substr(0, pos);
+}
+
+bool is_dir(const sftp_attributes_struct& attr)
+{
+    return (attr.permissions & SSH_S_IFMT) == SSH_S_IFDIR;
+}
+} // namespace
+
+mp::SftpAttributeCache::SftpAttributeCache(std::size_t capacity, std::chrono::milliseconds ttl)
+    : capacity{capacity}, ttl{ttl}
+{
+#ifdef MULTIPASS_PLATFORM_LINUX
+    inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd == -1)
+        mpl::log(mpl::Level::warning,
+                 category,
+                 fmt::format("Cannot watch for file changes, attribute caching disabled: {}",
+                             std::strerror(errno)));
+#endif
+}
+
+mp::SftpAttributeCache::~SftpAttributeCache()
+{
+#ifdef MULTIPASS_PLATFORM_LINUX
+    if (inotify_fd != -1)
+        ::close(inotify_fd);
+#endif
+}
+
+std::optional<mp::CachedAttributes> mp::SftpAttributeCache::find(const std::string& path)
+{
+    process_events();
+
+    auto it = entries.find(path);
+    if (it == entries.end() || it->second.expiry <= std::chrono::steady_clock::now())
+    {
+        if (it != entries.end())
+            erase(it);
+
+        ++miss_count;
+        return std::nullopt;
+    }
+
+    lru.splice(lru.begin(), lru, it->second.lru_position);
+    ++hit_count;
+
+    return it->second.attributes;
+}
+
+void mp::SftpAttributeCache::insert(const std::string& path, const CachedAttributes& attributes)
+{
+    if (inotify_fd == -1 || capacity == 0)
+        return;
+
+    process_events();
+
+    // Directories are watched too, so that their own timestamps are refreshed when their entries
+    // change
+    if (!watch(parent_of(path)) || (is_dir(attributes.attr) && !watch(path)))
+        return;
+
+    if (auto it = entries.find(path); it != entries.end())
+        erase(it);
+
+    while (entries.size() >= capacity)
+        erase(entries.find(lru.back()));
+
+    lru.push_front(path);
+    entries.emplace(path,
+                    Entry{attributes, std::chrono::steady_clock::now() + ttl, lru.begin()});
+}
+
+void mp::SftpAttributeCache::invalidate(const std::string& path)
+{
+    if (auto it = entries.find(path); it != entries.end())
+        erase(it);
+
+    if (auto it = entries.find(parent_of(path)); it != entries.end())
+        erase(it);
+}
+
+void mp::SftpAttributeCache::invalidate_tree(const std::string& path)
+{
+    invalidate(path);
+
+    const auto prefix = path + "/";
+    for (auto it = entries.begin(); it != entries.end();)
+    {
+        auto next = std::next(it);
+        if (it->first.compare(0, prefix.size(), prefix) == 0)
+            erase(it);
+        it = next;
+    }
+}
+
+void mp::SftpAttributeCache::clear()
+{
+    entries.clear();
+    lru.clear();
+
+#ifdef MULTIPASS_PLATFORM_LINUX
+    for (const auto& [wd, _] : watched_dirs)
+        inotify_rm_watch(inotify_fd, wd);
+#endif
+
+    watched_dirs.clear();
+    watch_descriptors.clear();
+}
+
+std::uint64_t mp::SftpAttributeCache::hits() const
+{
+    return hit_count;
+}
+
+std::uint64_t mp::SftpAttributeCache::misses() const
+{
+    return miss_count;
+}
+
+void mp::SftpAttributeCache::erase(std::unordered_map<std::string, Entry>::iterator it)
+{
+    lru.erase(it->second.lru_position);
+    entries.erase(it);
+}
+
+bool mp::SftpAttributeCache::watch(const std::string& dir)
+{
+#ifdef MULTIPASS_PLATFORM_LINUX
+    if (dir.empty())
+        return false;
+
+    if (watch_descriptors.count(dir))
+        return true;
+
+    // Watches are a per-user system resource, so start over rather than hold on to too many
+    if (watched_dirs.size() >= max_watched_dirs)
+        clear();
+
+    const auto wd = inotify_add_watch(inotify_fd,
+                                      dir.c_str(),
+                                      IN_ATTRIB | IN_MODIFY | IN_CREATE | IN_DELETE |
+                                          IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF |
+                                          IN_MOVE_SELF | IN_ONLYDIR);
+    if (wd == -1)
+        return false;
+
+    watched_dirs[wd] = dir;
+    watch_descriptors[dir] = wd;
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+void mp::SftpAttributeCache::process_events()
+{
+#ifdef MULTIPASS_PLATFORM_LINUX
+    if (inotify_fd == -1)
+        return;
+
+    alignas(inotify_event) char buffer[16 * 1024];
+    while (true)
+    {
+        const auto len = ::read(inotify_fd, buffer, sizeof(buffer));
+        if (len <= 0)
+            return;
+
+        for (auto ptr = buffer; ptr < buffer + len;)
+        {
+            const auto event = reinterpret_cast<const inotify_event*>(ptr);
+            ptr += sizeof(inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW)
+            {
+                mpl::log(mpl::Level::debug, category, "File change events lost, clearing cache");
+                clear();
+                continue;
+            }
+
+            const auto found = watched_dirs.find(event->wd);
+            if (found == watched_dirs.end())
+                continue;
+
+            const auto dir = found->second;
+
+            if (event->mask & IN_IGNORED)
+            {
+                invalidate_tree(dir);
+                watch_descriptors.erase(dir);
+                watched_dirs.erase(found);
+                continue;
+            }
+
+            if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF))
+            {
+                invalidate_tree(dir);
+                continue;
+            }
+
+            if (event->len == 0)
+            {
+                invalidate(dir);
+                continue;
+            }
+
+            const auto path = fmt::format("{}/{}", dir == "/" ? "" : dir, event->name);
+            if (event->mask & IN_ISDIR)
+                invalidate_tree(path);
+            else
+                invalidate(path);
+        }
+    }
+#endif
+}
@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <libssh/sftp.h>
+
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+namespace multipass
+{
+struct CachedAttributes
+{
+    sftp_attributes_struct attr;
+    std::string longname;
+};
+
+// Bounded LRU cache of the attributes that the SFTP server reports for host paths, as seen by
+// lstat(). Entries are dropped as soon as inotify reports a change to them or to their directory,
+// and in any case once they are older than the given TTL. Where inotify is not available the cache
+// stays empty, because changes made on the host would otherwise go unnoticed.
+class SftpAttributeCache
+{
+public:
+    SftpAttributeCache(std::size_t capacity, std::chrono::milliseconds ttl);
+    ~SftpAttributeCache();
+
+    SftpAttributeCache(const SftpAttributeCache&) = delete;
+    SftpAttributeCache& operator=(const SftpAttributeCache&) = delete;
+
+    std::optional<CachedAttributes> find(const std::string& path);
+    void insert(const std::string& path, const CachedAttributes& attributes);
+    void invalidate(const std::string& path);
+    void invalidate_tree(const std::string& path);
+    void clear();
+
+    std::uint64_t hits() const;
+    std::uint64_t misses() const;
+
+private:
+    struct Entry
+    {
+        CachedAttributes attributes;
+        std::chrono::steady_clock::time_point expiry;
+        std::list<std::string>::iterator lru_position;
+    };
+
+    void process_events();
+    bool watch(const std::string& dir);
+    void erase(std::unordered_map<std::string, Entry>::iterator it);
+
+    const std::size_t capacity;
+    const std::chrono::milliseconds ttl;
+    std::list<std::string> lru; // most recently used first
+    std::unordered_map<std::string, Entry> entries;
+    std::unordered_map<int, std::string> watched_dirs;
+    std::unordered_map<std::string, int> watch_descriptors;
+    int inotify_fd{-1};
+    std::uint64_t hit_count{0};
+    std::uint64_t miss_count{0};
+};
+} // namespace multipass
@@ -25,10 +25,20 @@
 #include <multipass/ssh/throw_on_error.h>
 #include <multipass/utils.h>
 
+#include <QDateTime>
 #include <QDir>
 #include <QFile>
 
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 #include <fcntl.h>
+#include <sys/stat.h>
 
 namespace mp = multipass;
 namespace mpl = multipass::logging;
@@ -36,6 +46,13 @@ namespace mpl = multipass::logging;
 namespace
 {
 constexpr auto category = "sftp server";
+constexpr auto max_packet_size = 65536u;
+constexpr auto max_io_in_flight = 64u;
+constexpr auto attribute_cache_capacity = 65536u;
+constexpr auto attribute_cache_ttl = std::chrono::seconds{5};
+constexpr auto attribute_cache_stats_interval = 10000u;
+constexpr auto max_names_reply_size = 65536ul;
+constexpr auto names_entry_overhead = 64ul; // lengths and attributes
 using SftpHandleUPtr = std::unique_ptr<ssh_string_struct, void (*)(ssh_string)>;
 using namespace std::literals::chrono_literals;
 
@@ -96,73 +113,27 @@ fmt::memory_buffer& operator<<(fmt::memory_buffer& buf, const char* v)
     return buf;
 }
 
-auto longname_from(const QFileInfo& file_info, const std::string& filename)
+auto longname_from(const sftp_attributes_struct& attr, const std::string& filename)
 {
     fmt::memory_buffer out;
-    auto mode = file_info.permissions();
+    const auto type = attr.permissions & SSH_S_IFMT;
 
-    if (file_info.isSymLink())
+    if (type == SSH_S_IFLNK)
         out << "l";
-    else if (file_info.isDir())
+    else if (type == SSH_S_IFDIR)
         out << "d";
     else
         out << "-";
 
-    /* user */
-    if (mode & QFileDevice::ReadOwner)
-        out << "r";
-    else
-        out << "-";
-
-    if (mode & QFileDevice::WriteOwner)
-        out << "w";
-    else
-        out << "-";
-
-    if (mode & QFileDevice::ExeOwner)
-        out << "x";
-    else
-        out << "-";
-
-    /*group*/
-    if (mode & QFileDevice::ReadGroup)
-        out << "r";
-    else
-        out << "-";
-
-    if (mode & QFileDevice::WriteGroup)
-        out << "w";
-    else
-        out << "-";
-
-    if (mode & QFileDevice::ExeGroup)
-        out << "x";
-    else
-        out << "-";
-
-    /* other */
-    if (mode & QFileDevice::ReadOther)
-        out << "r";
-    else
-        out << "-";
-
-    if (mode & QFileDevice::WriteOther)
-        out << "w";
-    else
-        out << "-";
-
-    if (mode & QFileDevice::ExeOther)
-        out << "x";
-    else
-        out << "-";
+    constexpr auto mode_chars = "rwxrwxrwx";
+    for (auto i = 0; i < 9; ++i)
+        out.push_back((attr.permissions & (Permissions::read_user >> i)) ? mode_chars[i] : '-');
 
-    fmt::format_to(std::back_inserter(out),
-                   " 1 {} {} {}",
-                   file_info.ownerId(),
-                   file_info.groupId(),
-                   file_info.size());
+    fmt::format_to(std::back_inserter(out), " 1 {} {} {}", attr.uid, attr.gid, attr.size);
 
-    const auto timestamp = file_info.lastModified().toString("MMM d hh:mm:ss yyyy").toStdString();
+    const auto timestamp = QDateTime::fromSecsSinceEpoch(attr.mtime)
+                               .toString("MMM d hh:mm:ss yyyy")
+                               .toStdString();
     fmt::format_to(std::back_inserter(out), " {} {}", timestamp, filename);
 
     return out;
@@ -194,6 +165,11 @@ auto to_unix_permissions(QFile::Permissions perms)
     return out;
 }
 
+bool is_symlink(const sftp_attributes_struct& attr)
+{
+    return (attr.permissions & SSH_S_IFMT) == SSH_S_IFLNK;
+}
+
 auto validate_path(const std::string& source_path, const std::string& current_path)
 {
     if (source_path.empty())
@@ -253,8 +229,257 @@ int reverse_id_for(const mp::id_mappings& id_maps, const int id, const int defau
                ? (default_found == id_maps.cend() ? default_id : default_found->first)
                : found->first;
 }
+
+// Read buffers are recycled between requests, instead of allocating and zeroing one per READ
+class ReadBufferPool
+{
+public:
+    using Buffer = std::unique_ptr<char[]>;
+
+    Buffer acquire()
+    {
+        std::lock_guard lock{mutex};
+        if (buffers.empty())
+            return Buffer{new char[max_packet_size]};
+
+        auto buffer = std::move(buffers.back());
+        buffers.pop_back();
+        return buffer;
+    }
+
+    void release(Buffer buffer)
+    {
+        std::lock_guard lock{mutex};
+        if (buffers.size() < max_io_in_flight)
+            buffers.push_back(std::move(buffer));
+    }
+
+private:
+    std::mutex mutex;
+    std::vector<Buffer> buffers;
+};
+
+ReadBufferPool& read_buffers()
+{
+    static ReadBufferPool pool;
+    return pool;
+}
+
+// A READ or WRITE request, split into the file I/O part (which may run on a worker thread) and the
+// reply part (which must run on the thread that owns the libssh session)
+struct IoRequest
+{
+    IoRequest(sftp_client_message msg, mp::NamedFd* handle, std::size_t file_id)
+        : msg{msg}, handle{handle}, file_id{file_id}, type{sftp_client_message_get_type(msg)}
+    {
+    }
+
+    ~IoRequest()
+    {
+        if (buffer)
+            read_buffers().release(std::move(buffer));
+    }
+
+    mp::SftpServer::SftpMessageUptr owned_msg{nullptr, sftp_client_message_free};
+    sftp_client_message msg;
+    mp::NamedFd* handle;
+    std::size_t file_id;
+    uint8_t type;
+    ReadBufferPool::Buffer buffer;
+    long long result{0};
+    bool failed{false};
+    int error{0};
+};
+
+void perform_io(IoRequest& request)
+{
+    const auto& [path, file] = *request.handle;
+    auto offset = static_cast<off_t>(request.msg->offset);
+
+    if (request.type == SFTP_READ)
+    {
+        // Short reads are topped up so that the client gets as much as it asked for in one reply
+        const auto len = std::min(request.msg->len, max_packet_size);
+        request.buffer = read_buffers().acquire();
+
+        while (request.result < len)
+        {
+            const auto r = MP_FILEOPS.pread(file,
+                                            request.buffer.get() + request.result,
+                                            len - request.result,
+                                            offset + request.result);
+            if (r == -1)
+            {
+                // Data already read is still worth sending
+                if (request.result == 0)
+                {
+                    request.failed = true;
+                    request.error = errno;
+                }
+                return;
+            }
+
+            if (r == 0)
+                return;
+
+            request.result += r;
+        }
+        return;
+    }
+
+    auto len = ssh_string_len(request.msg->data);
+    auto data_ptr = ssh_string_get_char(request.msg->data);
+
+    do
+    {
+        const auto r = MP_FILEOPS.pwrite(file, data_ptr, len, offset);
+        if (r == -1)
+        {
+            request.failed = true;
+            request.error = errno;
+            return;
+        }
+
+        data_ptr += r;
+        len -= r;
+        offset += r;
+    } while (len > 0);
+}
+
+int reply_io(IoRequest& request)
+{
+    const auto& [path, file] = *request.handle;
+    const auto function = request.type == SFTP_READ ? "handle_read" : "handle_write";
+
+    if (request.failed)
+    {
+        const auto reason = std::strerror(request.error);
+        mpl::log(mpl::Level::trace,
+                 category,
+                 fmt::format("{}: {} failed for '{}': {}",
+                             function,
+                             request.type == SFTP_READ ? "read" : "write",
+                             path.string(),
+                             reason));
+        return request.type == SFTP_READ ? sftp_reply_status(request.msg, SSH_FX_FAILURE, reason)
+                                         : reply_failure(request.msg);
+    }
+
+    if (request.type == SFTP_WRITE)
+        return reply_ok(request.msg);
+
+    if (request.result == 0)
+        return sftp_reply_status(request.msg, SSH_FX_EOF, "End of file");
+
+    return sftp_reply_data(request.msg, request.buffer.get(), request.result);
+}
+
+// Identifies the file behind an open handle, so that I/O through different handles to the same file
+// can be kept in order. Falls back to the path where there are no inode numbers.
+std::size_t file_id_of(const mp::NamedFd& named_fd)
+{
+#ifndef MULTIPASS_PLATFORM_WINDOWS
+    struct stat st;
+    if (::fstat(named_fd.fd, &st) == 0)
+        return std::hash<std::uint64_t>{}(static_cast<std::uint64_t>(st.st_ino)) ^
+               (std::hash<std::uint64_t>{}(static_cast<std::uint64_t>(st.st_dev)) << 1);
+#endif
+
+    return std::hash<std::string>{}(named_fd.path.string());
+}
 } // namespace
 
+// Runs pipelined file I/O off the session thread. Requests for the same file always go to the same
+// worker, whichever handle they come through, so they are carried out in the order they were
+// received. Requests for different files proceed concurrently and may complete out of order, as
+// SFTP allows.
+class mp::SftpServer::IoWorkers
+{
+public:
+    explicit IoWorkers(int num_workers) : queues(num_workers)
+    {
+        for (auto i = 0; i < num_workers; ++i)
+            threads.emplace_back([this, i] { work(queues[i]); });
+    }
+
+    ~IoWorkers()
+    {
+        {
+            std::lock_guard lock{mutex};
+            stopping = true;
+        }
+        work_available.notify_all();
+
+        for (auto& thread : threads)
+            thread.join();
+    }
+
+    void submit(std::unique_ptr<IoRequest> request)
+    {
+        const auto index = request->file_id % queues.size();
+        {
+            std::lock_guard lock{mutex};
+            queues[index].push_back(std::move(request));
+            ++pending;
+        }
+        work_available.notify_all();
+    }
+
+    std::size_t in_flight()
+    {
+        std::lock_guard lock{mutex};
+        return pending;
+    }
+
+    // Waits up to `timeout` for at least one request to complete, then hands over all completed
+    std::vector<std::unique_ptr<IoRequest>> take_completed(std::chrono::milliseconds timeout)
+    {
+        std::unique_lock lock{mutex};
+        work_done.wait_for(lock, timeout, [this] { return !completed.empty(); });
+
+        std::vector<std::unique_ptr<IoRequest>> ret;
+        ret.swap(completed);
+        pending -= ret.size();
+
+        return ret;
+    }
+
+private:
+    void work(std::deque<std::unique_ptr<IoRequest>>& queue)
+    {
+        while (true)
+        {
+            std::unique_ptr<IoRequest> request;
+            {
+                std::unique_lock lock{mutex};
+                work_available.wait(lock, [this, &queue] { return stopping || !queue.empty(); });
+                if (queue.empty())
+                    return;
+
+                request = std::move(queue.front());
+                queue.pop_front();
+            }
+
+            perform_io(*request);
+
+            {
+                std::lock_guard lock{mutex};
+                completed.push_back(std::move(request));
+            }
+            work_done.notify_one();
+        }
+    }
+
+    std::mutex mutex;
+    std::condition_variable work_available;
+    std::condition_variable work_done;
+    std::vector<std::deque<std::unique_ptr<IoRequest>>> queues;
+    std::vector<std::unique_ptr<IoRequest>> completed;
+    std::vector<std::thread> threads;
+    std::size_t pending{0};
+    bool stopping{false};
+};
+
 mp::SftpServer::SftpServer(SSHSession&& session,
                            const std::string& source,
                            const std::string& target,
@@ -262,7 +487,8 @@ mp::SftpServer::SftpServer(SSHSession&& session,
                            const id_mappings& uid_mappings,
                            int default_uid,
                            int default_gid,
-                           const std::string& sshfs_exec_line)
+                           const std::string& sshfs_exec_line,
+                           int io_workers)
     : ssh_session{std::move(session)},
       sshfs_process{create_sshfs_process(ssh_session, sshfs_exec_line, source, target)},
       sftp_server_session{make_sftp_session(ssh_session, sshfs_process->release_channel())},
@@ -272,13 +498,21 @@ mp::SftpServer::SftpServer(SSHSession&& session,
       uid_mappings{uid_mappings},
       default_uid{default_uid},
       default_gid{default_gid},
-      sshfs_exec_line{sshfs_exec_line}
+      sshfs_exec_line{sshfs_exec_line},
+      io_workers{io_workers > 0 ? std::make_unique<IoWorkers>(io_workers) : nullptr},
+      attribute_cache{attribute_cache_capacity, attribute_cache_ttl}
 {
 }
 
 mp::SftpServer::~SftpServer()
 {
     stop_invoked = true;
+
+    mpl::log(mpl::Level::debug,
+             category,
+             fmt::format("attribute cache: {} hits, {} misses",
+                         attribute_cache.hits(),
+                         attribute_cache.misses()));
 }
 
 sftp_attributes_struct mp::SftpServer::attr_from(const QFileInfo& file_info)
@@ -306,6 +540,45 @@ sftp_attributes_struct mp::SftpServer::attr_from(const QFileInfo& file_info)
     return attr;
 }
 
+std::optional<mp::CachedAttributes> mp::SftpServer::cached_attributes_for(const std::string& path)
+{
+    auto attributes = attribute_cache.find(path);
+
+    if (const auto lookups = attribute_cache.hits() + attribute_cache.misses();
+        lookups % attribute_cache_stats_interval == 0)
+        mpl::log(mpl::Level::debug,
+                 category,
+                 fmt::format("attribute cache: {} hits, {} misses",
+                             attribute_cache.hits(),
+                             attribute_cache.misses()));
+
+    return attributes;
+}
+
+mp::CachedAttributes mp::SftpServer::entry_attributes_from(const DirectoryEntry& entry)
+{
+    const auto path = entry.path().string();
+    sftp_attributes_struct attr{};
+
+#ifdef MULTIPASS_PLATFORM_WINDOWS
+    // There is no lstat() here, symlink_attr_from() only deals with symlinks
+    if (!entry.is_symlink())
+    {
+        attr = attr_from(QFileInfo{path.c_str()});
+        return {attr, fmt::to_string(longname_from(attr, path))};
+    }
+#endif
+
+    // A single lstat() gives everything, with no need to go through QFileInfo for each entry
+    mp::platform::symlink_attr_from(path.c_str(), &attr);
+
+    auto longname = fmt::to_string(longname_from(attr, path));
+    attr.uid = mapped_uid_for(attr.uid);
+    attr.gid = mapped_gid_for(attr.gid);
+
+    return {attr, std::move(longname)};
+}
+
 inline int mp::SftpServer::mapped_uid_for(const int uid)
 {
     return mapped_id_for(uid_mappings, uid, default_uid);
@@ -431,15 +704,85 @@ void mp::SftpServer::process_message(sftp_client_message msg)
                  fmt::format("error occurred when replying to client: {}", ret));
 }
 
-void mp::SftpServer::run()
+bool mp::SftpServer::client_message_ready()
+{
+    if (!io_workers)
+        return true;
+
+    reply_to_completed_io(0ms);
+
+    // With nothing in flight there is nothing to reply to, so we can block waiting for the client
+    const auto in_flight = io_workers->in_flight();
+    if (in_flight == 0)
+        return true;
+
+    // Data, EOF or an error are all handled by sftp_get_client_message()
+    if (in_flight < max_io_in_flight &&
+        ssh_channel_poll_timeout(sftp_server_session->channel, 0, 0) != 0)
+        return true;
+
+    reply_to_completed_io(1ms);
+    return false;
+}
+
+bool mp::SftpServer::dispatch_io(SftpMessageUptr& msg)
+{
+    if (!io_workers || msg == nullptr)
+        return false;
+
+    const auto type = sftp_client_message_get_type(msg.get());
+    if (type != SFTP_READ && type != SFTP_WRITE)
+        return false;
+
+    const auto handle = get_handle<NamedFd>(msg.get());
+    if (handle == nullptr)
+        return false;
+
+    // Handles that were not opened here (there should be none) are told apart by their path
+    const auto it = open_file_ids.find(handle);
+    const auto file_id =
+        it != open_file_ids.end() ? it->second : std::hash<std::string>{}(handle->path.string());
+
+    auto request = std::make_unique<IoRequest>(msg.get(), handle, file_id);
+    request->owned_msg = std::move(msg);
+    io_workers->submit(std::move(request));
+
+    return true;
+}
+
+void mp::SftpServer::reply_to_completed_io(std::chrono::milliseconds timeout)
 {
-    using MsgUPtr =
-        std::unique_ptr<sftp_client_message_struct, decltype(sftp_client_message_free)*>;
+    for (const auto& request : io_workers->take_completed(timeout))
+        if (const auto ret = reply_io(*request); ret != 0)
+            mpl::log(mpl::Level::error,
+                     category,
+                     fmt::format("error occurred when replying to client: {}", ret));
+}
+
+void mp::SftpServer::finish_pending_io()
+{
+    if (!io_workers)
+        return;
+
+    while (io_workers->in_flight() > 0)
+        reply_to_completed_io(10ms);
+}
 
+void mp::SftpServer::run()
+{
     while (true)
     {
-        MsgUPtr client_msg{sftp_get_client_message(sftp_server_session.get()),
-                           sftp_client_message_free};
+        if (!client_message_ready())
+            continue;
+
+        SftpMessageUptr client_msg{sftp_get_client_message(sftp_server_session.get()),
+                                   sftp_client_message_free};
+        if (dispatch_io(client_msg))
+            continue;
+
+        // Anything other than file I/O may depend on the outcome of earlier requests
+        finish_pending_io();
+
         auto msg = client_msg.get();
         if (msg == nullptr)
         {
@@ -501,6 +844,7 @@ void mp::SftpServer::stop()
 int mp::SftpServer::handle_close(sftp_client_message msg)
 {
     const auto id = sftp_handle(sftp_server_session.get(), msg->handle);
+    open_file_ids.erase(id);
     if (!open_file_handles.erase(id) && !open_dir_handles.erase(id))
     {
         mpl::log(mpl::Level::trace,
@@ -526,12 +870,19 @@ int mp::SftpServer::handle_fstat(sftp_client_message msg)
 
     const auto& [path, _] = *handle;
 
+    if (auto cached = cached_attributes_for(path.string()); cached && !is_symlink(cached->attr))
+        return sftp_reply_attr(msg, &cached->attr);
+
     QFileInfo file_info(path.string().c_str());
 
-    if (file_info.isSymLink())
+    const auto symlink = file_info.isSymLink();
+    if (symlink)
         file_info = QFileInfo(file_info.symLinkTarget());
 
     auto attr = attr_from(file_info);
+    if (!symlink)
+        attribute_cache.insert(path.string(), {attr, {}});
+
     return sftp_reply_attr(msg, &attr);
 }
 
@@ -740,6 +1091,7 @@ int mp::SftpServer::handle_open(sftp_client_message msg)
         return reply_failure(msg);
     }
 
+    open_file_ids.emplace(named_fd.get(), file_id_of(*named_fd));
     open_file_handles.emplace(named_fd.get(), std::move(named_fd));
 
     return sftp_reply_handle(msg, sftp_handle.get());
@@ -814,35 +1166,10 @@ int mp::SftpServer::handle_read(sftp_client_message msg)
         return reply_bad_handle(msg, "read");
     }
 
-    const auto& [path, file] = *handle;
-
-    if (MP_FILEOPS.lseek(file, msg->offset, SEEK_SET) == -1)
-    {
-        mpl::log(mpl::Level::trace,
-                 category,
-                 fmt::format("{}: cannot seek to position {} in '{}'",
-                             __FUNCTION__,
-                             msg->offset,
-                             path.string()));
-        return reply_failure(msg);
-    }
-
-    constexpr auto max_packet_size = 65536u;
-    std::array<char, max_packet_size> buffer{};
-
-    if (const auto r = MP_FILEOPS.read(file, buffer.data(), std::min(msg->len, max_packet_size));
-        r > 0)
-        return sftp_reply_data(msg, buffer.data(), r);
-    else if (r == 0)
-        return sftp_reply_status(msg, SSH_FX_EOF, "End of file");
+    IoRequest request{msg, handle};
+    perform_io(request);
 
-    mpl::log(mpl::Level::trace,
-             category,
-             fmt::format("{}: read failed for '{}': {}",
-                         __FUNCTION__,
-                         path.string(),
-                         std::strerror(errno)));
-    return sftp_reply_status(msg, SSH_FX_FAILURE, std::strerror(errno));
+    return reply_io(request);
 }
 
 int mp::SftpServer::handle_readdir(sftp_client_message msg)
@@ -861,25 +1188,27 @@ int mp::SftpServer::handle_readdir(sftp_client_message msg)
     if (!dir_iterator.hasNext())
         return sftp_reply_status(msg, SSH_FX_EOF, nullptr);
 
-    const auto max_num_entries_per_packet = 50ll;
-    for (int i = 0; i < max_num_entries_per_packet && dir_iterator.hasNext(); i++)
+    // Fill each reply up to a size every SFTP client accepts, rather than a fixed number of entries
+    auto reply_size = 0ul;
+    while (reply_size < max_names_reply_size && dir_iterator.hasNext())
     {
         const auto& entry = dir_iterator.next();
-        QFileInfo file_info{entry.path().string().c_str()};
-        sftp_attributes_struct attr{};
-        if (entry.is_symlink())
-        {
-            mp::platform::symlink_attr_from(file_info.absoluteFilePath().toStdString().c_str(),
-                                            &attr);
-            attr.uid = mapped_uid_for(attr.uid);
-            attr.gid = mapped_gid_for(attr.gid);
-        }
-        else
+        const auto path = entry.path().string();
+
+        auto attributes = cached_attributes_for(path);
+        if (!attributes || attributes->longname.empty())
         {
-            attr = attr_from(file_info);
+            attributes = entry_attributes_from(entry);
+            attribute_cache.insert(path, *attributes);
         }
-        const auto longname = longname_from(file_info, entry.path().string());
-        sftp_reply_names_add(msg, entry.path().filename().string().c_str(), longname.data(), &attr);
+
+        const auto filename = entry.path().filename().string();
+        reply_size += filename.size() + attributes->longname.size() + names_entry_overhead;
+
+        sftp_reply_names_add(msg,
+                             filename.c_str(),
+                             attributes->longname.c_str(),
+                             &attributes->attr);
     }
 
     return sftp_reply_names(msg);
@@ -1209,8 +1538,13 @@ int mp::SftpServer::handle_stat(sftp_client_message msg, const bool follow)
         return reply_perm_denied(msg);
     }
 
+    if (auto cached = cached_attributes_for(filename);
+        cached && (!follow || !is_symlink(cached->attr)))
+        return sftp_reply_attr(msg, &cached->attr);
+
     QFileInfo file_info(filename);
-    if (!file_info.isSymLink() && !MP_FILEOPS.exists(file_info))
+    const auto symlink = file_info.isSymLink();
+    if (!symlink && !MP_FILEOPS.exists(file_info))
     {
         mpl::log(mpl::Level::trace,
                  category,
@@ -1220,7 +1554,7 @@ int mp::SftpServer::handle_stat(sftp_client_message msg, const bool follow)
 
     sftp_attributes_struct attr{};
 
-    if (!follow && file_info.isSymLink())
+    if (!follow && symlink)
     {
         mp::platform::symlink_attr_from(filename, &attr);
         attr.uid = mapped_uid_for(attr.uid);
@@ -1228,12 +1562,16 @@ int mp::SftpServer::handle_stat(sftp_client_message msg, const bool follow)
     }
     else
     {
-        if (file_info.isSymLink())
+        if (symlink)
             file_info = QFileInfo(file_info.symLinkTarget());
 
         attr = attr_from(file_info);
     }
 
+    // Only what lstat() would report is cached, the target of a symlink may be anywhere
+    if (!follow || !symlink)
+        attribute_cache.insert(filename, {attr, {}});
+
     return sftp_reply_attr(msg, &attr);
 }
 
@@ -1289,41 +1627,10 @@ int mp::SftpServer::handle_write(sftp_client_message msg)
         return reply_bad_handle(msg, "write");
     }
 
-    const auto& [path, file] = *handle;
-
-    if (MP_FILEOPS.lseek(file, msg->offset, SEEK_SET) == -1)
-    {
-        mpl::log(mpl::Level::trace,
-                 category,
-                 fmt::format("{}: cannot seek to position {} in '{}'",
-                             __FUNCTION__,
-                             msg->offset,
-                             path.string()));
-        return reply_failure(msg);
-    }
-
-    auto len = ssh_string_len(msg->data);
-    auto data_ptr = ssh_string_get_char(msg->data);
-
-    do
-    {
-        const auto r = MP_FILEOPS.write(file, data_ptr, len);
-        if (r == -1)
-        {
-            mpl::log(mpl::Level::trace,
-                     category,
-                     fmt::format("{}: write failed for '{}': {}",
-                                 __FUNCTION__,
-                                 path.string(),
-                                 std::strerror(errno)));
-            return reply_failure(msg);
-        }
+    IoRequest request{msg, handle};
+    perform_io(request);
 
-        data_ptr += r;
-        len -= r;
-    } while (len > 0);
-
-    return reply_ok(msg);
+    return reply_io(request);
 }
 
 int mp::SftpServer::handle_extended(sftp_client_message msg)
@@ -17,6 +17,8 @@
 
 #pragma once
 
+#include "sftp_attribute_cache.h"
+
 #include <multipass/file_ops.h>
 #include <multipass/id_mappings.h>
 #include <multipass/recursive_dir_iterator.h>
@@ -24,6 +26,7 @@
 
 #include <libssh/sftp.h>
 
+#include <chrono>
 #include <memory>
 #include <unordered_map>
 
@@ -45,7 +48,8 @@ public:
                const id_mappings& uid_mappings,
                int default_uid,
                int default_gid,
-               const std::string& sshfs_exec_line);
+               const std::string& sshfs_exec_line,
+               int io_workers = 0);
     SftpServer(SftpServer&& other);
     ~SftpServer();
 
@@ -55,10 +59,20 @@ public:
     using SSHSessionUptr = std::unique_ptr<ssh_session_struct, decltype(ssh_free)*>;
     using SftpSessionUptr = std::unique_ptr<sftp_session_struct, decltype(sftp_free)*>;
     using SSHFSProcUptr = std::unique_ptr<SSHProcess>;
+    using SftpMessageUptr =
+        std::unique_ptr<sftp_client_message_struct, decltype(sftp_client_message_free)*>;
 
 private:
+    class IoWorkers;
+
+    bool client_message_ready();
+    bool dispatch_io(SftpMessageUptr& msg);
+    void reply_to_completed_io(std::chrono::milliseconds timeout);
+    void finish_pending_io();
     void process_message(sftp_client_message msg);
     sftp_attributes_struct attr_from(const QFileInfo& file_info);
+    std::optional<CachedAttributes> cached_attributes_for(const std::string& path);
+    CachedAttributes entry_attributes_from(const DirectoryEntry& entry);
     int mapped_uid_for(const int uid);
     int mapped_gid_for(const int gid);
     int reverse_uid_for(const int uid, const int default_id);
@@ -96,12 +110,15 @@ private:
     const std::string source_path;
     const std::string target_path;
     std::unordered_map<void*, std::unique_ptr<NamedFd>> open_file_handles;
+    std::unordered_map<void*, std::size_t> open_file_ids; // taken at open, to order I/O per file
     std::unordered_map<void*, std::unique_ptr<DirIterator>> open_dir_handles;
     const id_mappings gid_mappings;
     const id_mappings uid_mappings;
     const int default_uid;
     const int default_gid;
     const std::string sshfs_exec_line;
+    std::unique_ptr<IoWorkers> io_workers;
+    SftpAttributeCache attribute_cache;
     bool stop_invoked{false};
 };
 } // namespace multipass
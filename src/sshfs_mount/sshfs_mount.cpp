@@ -42,6 +42,7 @@ constexpr auto category = "sshfs mount";
 const std::string fuse_version_string{"FUSE library version"};
 const std::string ld_library_path_key{"LD_LIBRARY_PATH="};
 const std::string snap_path_key{"SNAP="};
+constexpr auto sftp_io_workers = 4;
 
 auto get_sshfs_exec_and_options(mp::SSHSession& session)
 {
@@ -172,7 +173,8 @@ auto make_sftp_server(mp::SSHSession&& session,
                                             uid_mappings,
                                             default_uid,
                                             default_gid,
-                                            sshfs_exec_line);
+                                            sshfs_exec_line,
+                                            sftp_io_workers);
 }
 
 } // namespace
@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <multipass/executor.h>
+
+#include <QThread>
+
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace mp = multipass;
+
+namespace
+{
+thread_local auto current_task_priority = mp::Executor::Priority::interactive;
+
+std::int64_t in_nanoseconds(std::chrono::steady_clock::duration duration)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+}
+} // namespace
+
+mp::Executor::Executor(const Singleton<Executor>::PrivatePass& pass) noexcept
+    : Singleton<Executor>::Singleton{pass}
+{
+    // Tasks mostly wait on the network or on instances, so there are more threads than cores
+    pool.setMaxThreadCount(std::max(4 * QThread::idealThreadCount(), 8));
+}
+
+void mp::Executor::run_and_wait(std::size_t count, const std::function<void(std::size_t)>& task)
+{
+    if (count == 0)
+        return;
+
+    struct Batch
+    {
+        std::atomic<std::size_t> next{0};
+        std::mutex mutex;
+        std::condition_variable done_cv;
+        std::size_t done{0};
+        std::vector<std::exception_ptr> errors;
+    };
+
+    // Workers may only get to the batch after it is over, so they share it
+    auto batch = std::make_shared<Batch>();
+    batch->errors.resize(count);
+
+    const auto priority = current_priority();
+    const auto submitted = std::chrono::steady_clock::now();
+    auto work = [this, batch, count, priority, submitted, &task] {
+        for (auto i = batch->next++; i < count; i = batch->next++) // task is alive until all done
+        {
+            try
+            {
+                const TaskScope scope{*this, priority, submitted};
+                task(i);
+            }
+            catch (...)
+            {
+                batch->errors[i] = std::current_exception();
+            }
+
+            std::lock_guard lock{batch->mutex};
+            if (++batch->done == count)
+                batch->done_cv.notify_all();
+        }
+    };
+
+    const auto helpers = std::min(count - 1, static_cast<std::size_t>(pool.maxThreadCount()));
+    for (std::size_t i = 0; i < helpers; ++i)
+        pool.start(work, static_cast<int>(priority));
+
+    work();
+
+    {
+        std::unique_lock lock{batch->mutex};
+        batch->done_cv.wait(lock, [&batch, count] { return batch->done == count; });
+    }
+
+    for (const auto& error : batch->errors)
+        if (error)
+            std::rethrow_exception(error);
+}
+
+auto mp::Executor::current_priority() -> Priority
+{
+    return current_task_priority;
+}
+
+auto mp::Executor::counters(Priority priority) const -> Counters
+{
+    const auto& counters = all_counters[static_cast<int>(priority)];
+    return {counters.tasks.load(),
+            std::chrono::nanoseconds{counters.waiting_ns.load()},
+            std::chrono::nanoseconds{counters.running_ns.load()}};
+}
+
+int mp::Executor::max_thread_count() const
+{
+    return pool.maxThreadCount();
+}
+
+void mp::Executor::wait_for_done()
+{
+    pool.waitForDone();
+}
+
+auto mp::Executor::counters_for(Priority priority) -> AtomicCounters&
+{
+    return all_counters[static_cast<int>(priority)];
+}
+
+mp::Executor::TaskScope::TaskScope(Executor& executor,
+                                   Priority priority,
+                                   std::chrono::steady_clock::time_point submitted)
+    : executor{executor},
+      priority{priority},
+      previous_priority{current_task_priority},
+      submitted{submitted},
+      started{std::chrono::steady_clock::now()}
+{
+    current_task_priority = priority;
+}
+
+mp::Executor::TaskScope::~TaskScope()
+{
+    current_task_priority = previous_priority;
+
+    auto& counters = executor.counters_for(priority);
+    ++counters.tasks;
+    counters.waiting_ns += in_nanoseconds(started - submitted);
+    counters.running_ns += in_nanoseconds(std::chrono::steady_clock::now() - started);
+}
@@ -192,6 +192,31 @@ off_t mp::FileOps::lseek(int fd, off_t offset, int whence) const
     return ::lseek(fd, offset, whence);
 }
 
+int mp::FileOps::pread(int fd, void* buf, size_t nbytes, off_t offset) const
+{
+#ifdef MULTIPASS_PLATFORM_WINDOWS
+    // No positional I/O in the CRT, callers must not share the fd between threads
+    if (::lseek(fd, offset, SEEK_SET) == -1)
+        return -1;
+
+    return ::read(fd, buf, nbytes);
+#else
+    return ::pread(fd, buf, nbytes, offset);
+#endif
+}
+
+int mp::FileOps::pwrite(int fd, const void* buf, size_t nbytes, off_t offset) const
+{
+#ifdef MULTIPASS_PLATFORM_WINDOWS
+    if (::lseek(fd, offset, SEEK_SET) == -1)
+        return -1;
+
+    return ::write(fd, buf, nbytes);
+#else
+    return ::pwrite(fd, buf, nbytes, offset);
+#endif
+}
+
 void mp::FileOps::open(std::fstream& stream,
                        const char* filename,
                        std::ios_base::openmode mode) const
@@ -275,19 +275,19 @@ std::string mp::Utils::run_in_ssh_session(mp::SSHSession& session,
                                           const std::string& cmd,
                                           bool whisper) const
 {
-    auto proc = session.exec(cmd, whisper);
+    // Other commands can use the session in the meantime
+    auto result = session.exec_async(cmd, whisper).get();
 
-    if (auto ec = proc.exit_code() != 0)
+    if (result.exit_code != 0)
     {
-        auto error_msg = mp::utils::trim_end(proc.read_std_error());
+        auto error_msg = mp::utils::trim_end(result.std_error);
         mpl::log(mpl::Level::debug,
                  category,
                  fmt::format("failed to run '{}', error message: '{}'", cmd, error_msg));
-        throw mp::SSHExecFailure(error_msg, ec);
+        throw mp::SSHExecFailure(error_msg, result.exit_code);
     }
 
-    auto output = proc.read_std_output();
-    return mp::utils::trim_end(output);
+    return mp::utils::trim_end(result.std_output);
 }
 
 mp::Path mp::Utils::make_dir(const QDir& a_dir,
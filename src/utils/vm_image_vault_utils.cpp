@@ -16,6 +16,8 @@
  */
 
 #include <multipass/format.h>
+#include <multipass/logging/trace.h>
+#include <multipass/sparse_file_writer.h>
 #include <multipass/vm_image_host.h>
 #include <multipass/vm_image_vault.h>
 #include <multipass/vm_image_vault_utils.h>
@@ -25,8 +27,60 @@
 #include <QFileInfo>
 
 #include <stdexcept>
+#include <vector>
+
+#ifdef MULTIPASS_PLATFORM_LINUX
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <tuple>
+#endif
 
 namespace mp = multipass;
+namespace mpl = multipass::logging;
+
+namespace
+{
+// Has the kernel copy the file: by sharing its extents, where the filesystem supports that, or else
+// by copying the data between its holes, so that sparse images stay sparse. Returns false, with
+// nothing copied, if neither works here.
+bool kernel_copy(QFile& source, QFile& destination)
+{
+#ifdef MULTIPASS_PLATFORM_LINUX
+    const auto in = source.handle(), out = destination.handle();
+    if (in < 0 || out < 0)
+        return false;
+
+    if (::ioctl(out, FICLONE, in) == 0)
+        return true;
+
+    const auto size = ::lseek(in, 0, SEEK_END);
+    auto data = size > 0 ? ::lseek(in, 0, SEEK_DATA) : size;
+    auto copied = size >= 0;
+    while (copied && data >= 0 && data < size)
+    {
+        const auto hole = ::lseek(in, data, SEEK_HOLE);
+        auto in_offset = data, out_offset = data;
+        while (copied && in_offset < hole)
+            copied = ::copy_file_range(in, &in_offset, out, &out_offset, hole - in_offset, 0) > 0;
+
+        data = copied ? ::lseek(in, hole, SEEK_DATA) : -1;
+    }
+
+    // Running out of data past the last hole is fine, anything else is not
+    copied = copied && (data >= 0 || errno == ENXIO) && ::ftruncate(out, size) == 0;
+    if (!copied)
+        std::ignore = ::ftruncate(out, 0);
+
+    ::lseek(in, 0, SEEK_SET);
+    return copied;
+#else
+    return false;
+#endif
+}
+} // namespace
 
 mp::ImageVaultUtils::ImageVaultUtils(const PrivatePass& pass) noexcept : Singleton{pass}
 {
@@ -43,9 +97,39 @@ QString mp::ImageVaultUtils::copy_to_dir(const QString& file, const QDir& output
 
     auto new_location = output_dir.filePath(info.fileName());
 
-    if (!MP_FILEOPS.copy(file, new_location))
+    QFile source{file}, destination{new_location};
+    if (!MP_FILEOPS.open(source, QIODevice::ReadOnly) ||
+        !MP_FILEOPS.open(destination, QIODevice::WriteOnly | QIODevice::Truncate))
         throw std::runtime_error(fmt::format("Failed to copy {} to {}", file, new_location));
 
+    try
+    {
+        if (!kernel_copy(source, destination))
+        {
+            // Blocks of zeros are skipped rather than copied, so that sparse images stay sparse
+            SparseFileWriter writer{destination};
+            std::vector<char> buffer(1u << 20);
+            qint64 bytes_read;
+            while ((bytes_read = MP_FILEOPS.read(source, buffer.data(), buffer.size())) > 0)
+                writer.write(buffer.data(), bytes_read);
+
+            if (bytes_read < 0)
+                throw std::runtime_error(fmt::format("Failed to copy {} to {}: {}",
+                                                     file,
+                                                     new_location,
+                                                     source.errorString()));
+
+            writer.finish();
+        }
+
+        destination.setPermissions(source.permissions());
+    }
+    catch (...)
+    {
+        MP_FILEOPS.remove(destination);
+        throw;
+    }
+
     return new_location;
 }
 
@@ -69,6 +153,8 @@ QString mp::ImageVaultUtils::compute_file_hash(const QString& path) const
 
 void mp::ImageVaultUtils::verify_file_hash(const QString& file, const QString& hash) const
 {
+    const mpl::TraceSpan span{"verify_file_hash"};
+
     const auto file_hash = compute_file_hash(file);
 
     if (file_hash != hash)
@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <multipass/sparse_file_writer.h>
+
+#include <multipass/format.h>
+#include <multipass/logging/log.h>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <stdexcept>
+
+namespace mp = multipass;
+namespace mpl = multipass::logging;
+
+namespace
+{
+constexpr auto category = "sparse writer";
+
+bool is_zero_block(const char* data)
+{
+    static const std::array<char, mp::SparseFileWriter::block_size> zeros{};
+    return std::memcmp(data, zeros.data(), zeros.size()) == 0;
+}
+} // namespace
+
+mp::SparseFileWriter::SparseFileWriter(QFile& file) : file{file}
+{
+    pending.reserve(block_size);
+}
+
+void mp::SparseFileWriter::write(const char* data, qint64 size)
+{
+    // Blocks are aligned to the start of the file, so a partial one is held back until it fills
+    if (!pending.isEmpty())
+    {
+        const auto missing = std::min<qint64>(block_size - pending.size(), size);
+        pending.append(data, missing);
+        data += missing;
+        size -= missing;
+
+        if (pending.size() < block_size)
+            return;
+
+        write_blocks(pending.constData(), block_size);
+        pending.clear();
+    }
+
+    const auto whole_blocks_size = size - size % block_size;
+    write_blocks(data, whole_blocks_size);
+    pending.append(data + whole_blocks_size, size - whole_blocks_size);
+}
+
+void mp::SparseFileWriter::write(const QByteArray& data)
+{
+    write(data.constData(), data.size());
+}
+
+void mp::SparseFileWriter::finish()
+{
+    if (!pending.isEmpty())
+    {
+        write_at(position, pending.constData(), pending.size());
+        position += pending.size();
+        pending.clear();
+    }
+
+    if (file_position < position && !file.resize(position))
+        throw std::runtime_error(
+            fmt::format("failed to resize {}: {}", file.fileName(), file.errorString()));
+
+    mpl::log(mpl::Level::debug,
+             category,
+             fmt::format("Wrote {} of the {} bytes of {}, leaving the rest as holes",
+                         written,
+                         position,
+                         file.fileName()));
+}
+
+qint64 mp::SparseFileWriter::size() const
+{
+    return position + pending.size();
+}
+
+qint64 mp::SparseFileWriter::bytes_written() const
+{
+    return written;
+}
+
+void mp::SparseFileWriter::write_blocks(const char* data, qint64 size)
+{
+    // Runs of data blocks are written in one go, runs of zero blocks are skipped
+    qint64 run_start = 0;
+    for (qint64 offset = 0; offset < size; offset += block_size)
+    {
+        if (is_zero_block(data + offset))
+        {
+            write_at(position + run_start, data + run_start, offset - run_start);
+            run_start = offset + block_size;
+        }
+    }
+
+    write_at(position + run_start, data + run_start, size - run_start);
+    position += size;
+}
+
+void mp::SparseFileWriter::write_at(qint64 offset, const char* data, qint64 size)
+{
+    if (size == 0)
+        return;
+
+    if (offset != file_position && !file.seek(offset))
+        throw std::runtime_error(
+            fmt::format("failed to seek in {}: {}", file.fileName(), file.errorString()));
+
+    if (file.write(data, size) != size)
+        throw std::runtime_error(
+            fmt::format("failed to write to {}: {}", file.fileName(), file.errorString()));
+
+    file_position = offset + size;
+    written += size;
+}
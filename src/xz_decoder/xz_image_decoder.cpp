@@ -20,10 +20,18 @@
 #include <multipass/rpc/multipass.grpc.pb.h>
 
 #include <multipass/format.h>
+#include <multipass/logging/trace.h>
 
+#include <QThreadPool>
+
+#include <deque>
+#include <future>
+#include <memory>
+#include <thread>
 #include <vector>
 
 namespace mp = multipass;
+namespace mpl = multipass::logging;
 
 namespace
 {
@@ -52,9 +60,247 @@ bool verify_decode(const xz_ret& ret)
 
     return true;
 }
+
+constexpr auto stream_header_size = 12;
+constexpr auto stream_footer_size = 12;
+// Blocks are decoded whole in memory, larger ones are left to the sequential decoder
+constexpr quint64 max_parallel_block_size = 256u << 20;
+// Bounds the memory held by the blocks being decoded and those waiting to be written out
+constexpr quint64 max_parallel_bytes = 2 * max_parallel_block_size;
+
+struct XzBlock
+{
+    qint64 offset;
+    quint64 unpadded_size;
+    quint64 uncompressed_size;
+};
+
+quint32 read_le32(const char* data)
+{
+    quint32 value = 0;
+    for (auto i = 3; i >= 0; --i)
+        value = (value << 8) | static_cast<unsigned char>(data[i]);
+
+    return value;
+}
+
+void append_le32(QByteArray& data, quint32 value)
+{
+    for (auto i = 0; i < 4; ++i, value >>= 8)
+        data.append(static_cast<char>(value & 0xff));
+}
+
+quint32 crc32_of(const QByteArray& data)
+{
+    return xz_crc32(reinterpret_cast<const uint8_t*>(data.constData()), data.size(), 0);
+}
+
+bool read_multibyte_integer(const QByteArray& data, qsizetype& pos, quint64& value)
+{
+    value = 0;
+    for (auto shift = 0; shift < 63 && pos < data.size(); shift += 7)
+    {
+        const auto byte = static_cast<unsigned char>(data[pos++]);
+        value |= static_cast<quint64>(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+
+    return false;
+}
+
+void append_multibyte_integer(QByteArray& data, quint64 value)
+{
+    for (; value >= 0x80; value >>= 7)
+        data.append(static_cast<char>((value & 0x7f) | 0x80));
+
+    data.append(static_cast<char>(value));
+}
+
+quint64 padded(quint64 size)
+{
+    return (size + 3) & ~quint64{3};
+}
+
+// Reads the block index at the end of a single-stream xz file. Anything that does not fit that
+// layout yields no blocks, leaving the file to the sequential decoder and its error reporting.
+std::vector<XzBlock> read_blocks(QFile& xz_file)
+{
+    const auto file_size = xz_file.size();
+    if (file_size < stream_header_size + stream_footer_size ||
+        !xz_file.seek(file_size - stream_footer_size))
+        return {};
+
+    const auto footer = xz_file.read(stream_footer_size);
+    if (footer.size() != stream_footer_size || !footer.endsWith("YZ"))
+        return {};
+
+    const auto index_size = (static_cast<qint64>(read_le32(footer.constData() + 4)) + 1) * 4;
+    const auto index_offset = file_size - stream_footer_size - index_size;
+    if (index_offset < stream_header_size || !xz_file.seek(index_offset))
+        return {};
+
+    const auto index = xz_file.read(index_size);
+    if (index.size() != index_size || index[0] != '\0')
+        return {};
+
+    qsizetype pos = 1;
+    quint64 count;
+    if (!read_multibyte_integer(index, pos, count) || count > static_cast<quint64>(index_size))
+        return {};
+
+    std::vector<XzBlock> blocks;
+    qint64 offset = stream_header_size;
+    for (quint64 i = 0; i < count; ++i)
+    {
+        XzBlock block{offset, 0, 0};
+        if (!read_multibyte_integer(index, pos, block.unpadded_size) ||
+            !read_multibyte_integer(index, pos, block.uncompressed_size) ||
+            block.unpadded_size == 0 || block.unpadded_size > static_cast<quint64>(file_size) ||
+            block.uncompressed_size > max_parallel_block_size)
+            return {};
+
+        offset += padded(block.unpadded_size);
+        blocks.push_back(block);
+    }
+
+    // A mismatch means more than one stream, or stream padding
+    if (offset != index_offset)
+        return {};
+
+    return blocks;
+}
+
+// Wraps a block in a stream of its own, so that it can be decoded independently of the others
+QByteArray single_block_stream(const QByteArray& stream_header,
+                               const QByteArray& block_data,
+                               const XzBlock& block)
+{
+    QByteArray index(1, '\0');
+    append_multibyte_integer(index, 1);
+    append_multibyte_integer(index, block.unpadded_size);
+    append_multibyte_integer(index, block.uncompressed_size);
+    index.append(padded(index.size()) - index.size(), '\0');
+    append_le32(index, crc32_of(index));
+
+    QByteArray footer_fields;
+    append_le32(footer_fields, index.size() / 4 - 1);
+    footer_fields.append(stream_header.mid(6, 2));
+
+    QByteArray stream = stream_header + block_data + index;
+    append_le32(stream, crc32_of(footer_fields));
+    return stream + footer_fields + "YZ";
+}
+
+std::vector<char> decode_block(const QByteArray& stream, quint64 uncompressed_size)
+{
+    mp::XzImageDecoder::XzDecoderUPtr decoder{xz_dec_init(XZ_DYNALLOC, 1u << 26), xz_dec_end};
+    std::vector<char> decoded(uncompressed_size);
+
+    struct xz_buf decode_buf
+    {
+    };
+    decode_buf.in = reinterpret_cast<const unsigned char*>(stream.constData());
+    decode_buf.in_pos = 0;
+    decode_buf.in_size = stream.size();
+    decode_buf.out = reinterpret_cast<unsigned char*>(decoded.data());
+    decode_buf.out_pos = 0;
+    decode_buf.out_size = decoded.size();
+
+    // The decoder reports an error if it stops making progress, so this cannot loop forever
+    auto more = true;
+    while (more)
+        more = verify_decode(xz_dec_run(decoder.get(), &decode_buf));
+
+    return decoded;
+}
+
+// Blocks are decoded concurrently by a pool of workers, but written out in order as soon as they
+// and the ones before them are done. A few more blocks than there are workers are queued up, as
+// long as they fit in the memory bound.
+void decode_blocks_in_parallel(QFile& xz_file,
+                               mp::SparseFileWriter& writer,
+                               const std::vector<XzBlock>& blocks,
+                               unsigned workers,
+                               const mp::ProgressMonitor& monitor)
+{
+    if (!xz_file.seek(0))
+        throw std::runtime_error(fmt::format("failed to read {}", xz_file.fileName()));
+
+    const auto stream_header = xz_file.read(stream_header_size);
+    const auto file_size = xz_file.size();
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(workers);
+
+    struct InFlight
+    {
+        std::future<std::vector<char>> decoded;
+        const XzBlock* block;
+        quint64 bytes;
+    };
+    std::deque<InFlight> in_flight;
+    quint64 bytes_in_flight = 0;
+    auto next_block = blocks.cbegin();
+    auto last_progress = -1;
+
+    try
+    {
+        while (next_block != blocks.cend() || !in_flight.empty())
+        {
+            while (next_block != blocks.cend() && in_flight.size() <= workers)
+            {
+                const auto& block = *next_block;
+                const auto bytes = padded(block.unpadded_size) + block.uncompressed_size;
+                if (!in_flight.empty() && bytes_in_flight + bytes > max_parallel_bytes)
+                    break;
+
+                ++next_block;
+                if (!xz_file.seek(block.offset))
+                    throw std::runtime_error(
+                        fmt::format("failed to read {}", xz_file.fileName()));
+
+                const auto block_data = xz_file.read(padded(block.unpadded_size));
+                auto task = std::make_shared<std::packaged_task<std::vector<char>()>>(
+                    [stream = single_block_stream(stream_header, block_data, block),
+                     size = block.uncompressed_size] { return decode_block(stream, size); });
+
+                in_flight.push_back({task->get_future(), &block, bytes});
+                bytes_in_flight += bytes;
+                pool.start([task] { (*task)(); });
+            }
+
+            auto [decoded, block, bytes] = std::move(in_flight.front());
+            in_flight.pop_front();
+
+            const auto data = decoded.get();
+            writer.write(data.data(), data.size());
+            bytes_in_flight -= bytes;
+
+            const auto bytes_extracted = block == &blocks.back()
+                                             ? static_cast<quint64>(file_size)
+                                             : block->offset + padded(block->unpadded_size);
+            auto progress = (bytes_extracted / (float)file_size) * 100;
+            if (last_progress != progress)
+                monitor(mp::LaunchProgress::EXTRACT, progress);
+            last_progress = progress;
+        }
+    }
+    catch (...)
+    {
+        // Blocks that have not started are not worth decoding anymore
+        pool.clear();
+        throw;
+    }
+}
 } // namespace
 
-mp::XzImageDecoder::XzImageDecoder() : xz_decoder{xz_dec_init(XZ_DYNALLOC, 1u << 26), xz_dec_end}
+mp::XzImageDecoder::XzImageDecoder() : XzImageDecoder{std::thread::hardware_concurrency()}
+{
+}
+
+mp::XzImageDecoder::XzImageDecoder(unsigned max_threads)
+    : xz_decoder{xz_dec_init(XZ_DYNALLOC, 1u << 26), xz_dec_end}, max_threads{max_threads}
 {
     xz_crc32_init();
     xz_crc64_init();
@@ -64,6 +310,8 @@ void mp::XzImageDecoder::decode_to(const Path& xz_file_path,
                                    const Path& decoded_image_path,
                                    const ProgressMonitor& monitor) const
 {
+    const mpl::TraceSpan span{"decode_image"};
+
     QFile xz_file{xz_file_path};
     if (!xz_file.open(QIODevice::ReadOnly))
         throw std::runtime_error(fmt::format("failed to open {} for reading", xz_file.fileName()));
@@ -73,6 +321,21 @@ void mp::XzImageDecoder::decode_to(const Path& xz_file_path,
         throw std::runtime_error(
             fmt::format("failed to open {} for writing", decoded_file.fileName()));
 
+    SparseFileWriter writer{decoded_file};
+
+    // Multi-block files, as produced by multi-threaded xz, have blocks that decode independently
+    if (max_threads > 1)
+    {
+        if (const auto blocks = read_blocks(xz_file); blocks.size() > 1)
+        {
+            decode_blocks_in_parallel(xz_file, writer, blocks, max_threads, monitor);
+            writer.finish();
+            return;
+        }
+
+        xz_file.seek(0);
+    }
+
     struct xz_buf decode_buf
     {
     };
@@ -108,14 +371,44 @@ void mp::XzImageDecoder::decode_to(const Path& xz_file_path,
 
         if (!verify_decode(xz_dec_run(xz_decoder.get(), &decode_buf)))
         {
-            decoded_file.write(write_data.data(), decode_buf.out_pos);
+            writer.write(write_data.data(), decode_buf.out_pos);
+            writer.finish();
             return;
         }
 
         if (decode_buf.out_pos == max_size)
         {
-            decoded_file.write(write_data.data(), decode_buf.out_pos);
+            writer.write(write_data.data(), decode_buf.out_pos);
             decode_buf.out_pos = 0;
         }
     }
 }
+
+bool mp::XzImageDecoder::decode_chunk(const QByteArray& chunk, SparseFileWriter& writer) const
+{
+    const auto max_size = 65536u;
+    std::vector<unsigned char> write_data(max_size);
+
+    struct xz_buf decode_buf
+    {
+    };
+    decode_buf.in = reinterpret_cast<const unsigned char*>(chunk.constData());
+    decode_buf.in_pos = 0;
+    decode_buf.in_size = chunk.size();
+    decode_buf.out = write_data.data();
+    decode_buf.out_pos = 0;
+    decode_buf.out_size = max_size;
+
+    while (true)
+    {
+        const auto more = verify_decode(xz_dec_run(xz_decoder.get(), &decode_buf));
+
+        writer.write(reinterpret_cast<const char*>(write_data.data()), decode_buf.out_pos);
+
+        // Carry on while the output buffer is full, there may be more to decode from the input
+        if (!more || (decode_buf.in_pos == decode_buf.in_size && decode_buf.out_pos < max_size))
+            return more;
+
+        decode_buf.out_pos = 0;
+    }
+}
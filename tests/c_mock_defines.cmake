@@ -43,8 +43,11 @@ add_c_mocks(
   ssh_channel_request_pty
   ssh_channel_change_pty_size
   ssh_channel_read_timeout
+  ssh_channel_poll_timeout
   ssh_channel_get_exit_status
   ssh_event_dopoll
+  ssh_event_add_session
+  ssh_event_remove_session
   ssh_add_channel_callbacks
   sftp_server_new
   sftp_free
@@ -66,8 +69,11 @@ add_c_mocks(
   sftp_new
   sftp_init
   sftp_open
-  sftp_write
-  sftp_read
+  sftp_aio_begin_write
+  sftp_aio_wait_write
+  sftp_aio_begin_read
+  sftp_aio_wait_read
+  sftp_aio_free
   sftp_free
   sftp_get_error
   sftp_close
@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "tests/common.h"
+#include "tests/temp_dir.h"
+
+#include <src/sshfs_mount/sftp_attribute_cache.h>
+
+#include <filesystem>
+#include <fstream>
+
+namespace mp = multipass;
+namespace mpt = multipass::test;
+namespace fs = std::filesystem;
+
+using namespace testing;
+using namespace std::chrono_literals;
+
+namespace
+{
+struct SftpAttributeCache : public Test
+{
+    SftpAttributeCache()
+    {
+        std::ofstream{file};
+        fs::create_directory(dir);
+    }
+
+    mp::CachedAttributes make_attributes(uint64_t size, uint32_t type = SSH_S_IFREG)
+    {
+        mp::CachedAttributes attributes{};
+        attributes.attr.size = size;
+        attributes.attr.permissions = type | 0644;
+        attributes.longname = "longname";
+        return attributes;
+    }
+
+    mpt::TempDir temp_dir;
+    const fs::path root{temp_dir.path().toStdString()};
+    const std::string file{(root / "file").string()};
+    const std::string dir{(root / "dir").string()};
+    mp::SftpAttributeCache cache{16, 1h};
+};
+} // namespace
+
+TEST_F(SftpAttributeCache, returnsInsertedAttributes)
+{
+    cache.insert(file, make_attributes(42));
+
+    const auto found = cache.find(file);
+    ASSERT_TRUE(found);
+    EXPECT_EQ(found->attr.size, 42u);
+    EXPECT_EQ(found->longname, "longname");
+    EXPECT_EQ(cache.hits(), 1u);
+    EXPECT_EQ(cache.misses(), 0u);
+}
+
+TEST_F(SftpAttributeCache, countsMisses)
+{
+    EXPECT_FALSE(cache.find(file));
+    EXPECT_EQ(cache.hits(), 0u);
+    EXPECT_EQ(cache.misses(), 1u);
+}
+
+TEST_F(SftpAttributeCache, dropsEntryWhenFileIsModified)
+{
+    cache.insert(file, make_attributes(0));
+    std::ofstream{file, std::ios::app} << "modified";
+
+    EXPECT_FALSE(cache.find(file));
+}
+
+TEST_F(SftpAttributeCache, dropsEntryWhenFileIsRemoved)
+{
+    cache.insert(file, make_attributes(0));
+    fs::remove(file);
+
+    EXPECT_FALSE(cache.find(file));
+}
+
+TEST_F(SftpAttributeCache, dropsDirectoryWhenItsEntriesChange)
+{
+    cache.insert(dir, make_attributes(4096, SSH_S_IFDIR));
+    std::ofstream{fs::path{dir} / "new-file"};
+
+    EXPECT_FALSE(cache.find(dir));
+}
+
+TEST_F(SftpAttributeCache, dropsEntriesUnderRenamedDirectory)
+{
+    const auto nested = (fs::path{dir} / "nested").string();
+    std::ofstream{nested};
+    cache.insert(nested, make_attributes(0));
+
+    fs::rename(dir, root / "renamed");
+
+    EXPECT_FALSE(cache.find(nested));
+}
+
+TEST_F(SftpAttributeCache, keepsUnrelatedEntries)
+{
+    cache.insert(dir, make_attributes(4096, SSH_S_IFDIR));
+    cache.insert(file, make_attributes(0));
+    std::ofstream{file, std::ios::app} << "modified";
+
+    EXPECT_TRUE(cache.find(dir));
+}
+
+TEST_F(SftpAttributeCache, evictsLeastRecentlyUsed)
+{
+    mp::SftpAttributeCache small_cache{2, 1h};
+    const auto other = (root / "other").string();
+    std::ofstream{other};
+
+    small_cache.insert(file, make_attributes(1));
+    small_cache.insert(dir, make_attributes(2, SSH_S_IFDIR));
+    small_cache.find(file);
+    small_cache.insert(other, make_attributes(3));
+
+    EXPECT_TRUE(small_cache.find(file));
+    EXPECT_FALSE(small_cache.find(dir));
+    EXPECT_TRUE(small_cache.find(other));
+}
+
+TEST_F(SftpAttributeCache, expiresEntries)
+{
+    mp::SftpAttributeCache expiring_cache{16, 0ms};
+    expiring_cache.insert(file, make_attributes(0));
+
+    EXPECT_FALSE(expiring_cache.find(file));
+}
+
+TEST_F(SftpAttributeCache, invalidatesExplicitly)
+{
+    cache.insert(file, make_attributes(0));
+    cache.invalidate(file);
+
+    EXPECT_FALSE(cache.find(file));
+}
@@ -35,6 +35,11 @@ public:
                      int64_t size,
                      const int download_type,
                      const ProgressMonitor& monitor) override;
+    void stream_to(const QUrl& url,
+                   const DataHandler& on_data,
+                   int64_t size,
+                   const int download_type,
+                   const ProgressMonitor& monitor) override;
     QByteArray download(const QUrl& url) override;
     QByteArray download(const QUrl& url, const bool is_force_update_from_network) override;
     QDateTime last_modified(const QUrl& url) override;
@@ -72,6 +72,8 @@ public:
     MOCK_METHOD(int, read, (int, void*, size_t), (const, override));
     MOCK_METHOD(int, write, (int, const void*, size_t), (const, override));
     MOCK_METHOD(off_t, lseek, (int, off_t, int), (const, override));
+    MOCK_METHOD(int, pread, (int, void*, size_t, off_t), (const, override));
+    MOCK_METHOD(int, pwrite, (int, const void*, size_t, off_t), (const, override));
 
     // Mock std methods
     MOCK_METHOD(void,
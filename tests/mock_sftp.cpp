@@ -22,8 +22,11 @@ IMPL_MOCK_DEFAULT(1, sftp_new);
 IMPL_MOCK_DEFAULT(1, sftp_free);
 IMPL_MOCK_DEFAULT(1, sftp_init);
 IMPL_MOCK_DEFAULT(4, sftp_open);
-IMPL_MOCK_DEFAULT(3, sftp_write);
-IMPL_MOCK_DEFAULT(3, sftp_read);
+IMPL_MOCK_DEFAULT(4, sftp_aio_begin_write);
+IMPL_MOCK_DEFAULT(1, sftp_aio_wait_write);
+IMPL_MOCK_DEFAULT(3, sftp_aio_begin_read);
+IMPL_MOCK_DEFAULT(3, sftp_aio_wait_read);
+IMPL_MOCK_DEFAULT(1, sftp_aio_free);
 IMPL_MOCK_DEFAULT(1, sftp_get_error);
 IMPL_MOCK_DEFAULT(1, sftp_close);
 IMPL_MOCK_DEFAULT(2, sftp_stat);
@@ -25,8 +25,11 @@ DECL_MOCK(sftp_new);
 DECL_MOCK(sftp_free);
 DECL_MOCK(sftp_init);
 DECL_MOCK(sftp_open);
-DECL_MOCK(sftp_write);
-DECL_MOCK(sftp_read);
+DECL_MOCK(sftp_aio_begin_write);
+DECL_MOCK(sftp_aio_wait_write);
+DECL_MOCK(sftp_aio_begin_read);
+DECL_MOCK(sftp_aio_wait_read);
+DECL_MOCK(sftp_aio_free);
 DECL_MOCK(sftp_get_error);
 DECL_MOCK(sftp_close);
 DECL_MOCK(sftp_stat);
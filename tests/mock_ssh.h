@@ -34,7 +34,10 @@ DECL_MOCK(ssh_channel_new);
 DECL_MOCK(ssh_channel_open_session);
 DECL_MOCK(ssh_channel_request_exec);
 DECL_MOCK(ssh_channel_read_timeout);
+DECL_MOCK(ssh_channel_poll_timeout);
 DECL_MOCK(ssh_channel_get_exit_status);
 DECL_MOCK(ssh_event_dopoll);
+DECL_MOCK(ssh_event_add_session);
+DECL_MOCK(ssh_event_remove_session);
 DECL_MOCK(ssh_add_channel_callbacks);
 DECL_MOCK(ssh_get_error);
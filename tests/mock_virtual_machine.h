@@ -100,6 +100,7 @@ struct MockVirtualMachineT : public T
     MOCK_METHOD(std::shared_ptr<const Snapshot>, get_snapshot, (int index), (const, override));
     MOCK_METHOD(std::shared_ptr<Snapshot>, get_snapshot, (const std::string&), (override));
     MOCK_METHOD(std::shared_ptr<Snapshot>, get_snapshot, (int index), (override));
+    MOCK_METHOD(bool, supports_live_snapshots, (), (const, override));
     MOCK_METHOD(std::shared_ptr<const Snapshot>,
                 take_snapshot,
                 (const VMSpecs&, const std::string&, const std::string&),
@@ -31,6 +31,10 @@ struct MockDNSMasqServer : public DNSMasqServer
     using DNSMasqServer::DNSMasqServer; // ctor
 
     MOCK_METHOD(std::optional<IPAddress>, get_ip_for, (const std::string&), (override));
+    MOCK_METHOD(std::optional<IPAddress>,
+                wait_for_ip_for,
+                (const std::string&, std::chrono::milliseconds),
+                (override));
     MOCK_METHOD(void, release_mac, (const std::string&), (override));
     MOCK_METHOD(void, check_dnsmasq_running, (), (override));
 };
@@ -32,15 +32,20 @@
 
 #include <QDir>
 
+#include <chrono>
+#include <fstream>
+#include <future>
 #include <memory>
 #include <stdexcept>
 #include <string>
+#include <thread>
 
 namespace mp = multipass;
 namespace mpl = multipass::logging;
 namespace mpt = multipass::test;
 using namespace testing;
 using namespace std::string_literals;
+using namespace std::chrono_literals;
 
 namespace
 {
@@ -129,6 +134,66 @@ TEST_F(DNSMasqServer, returnsNullIpWhenLeasesFileDoesNotExist)
     EXPECT_FALSE(ip);
 }
 
+TEST_F(DNSMasqServer, findsIpLeasedAfterPreviousLookups)
+{
+    auto dns = make_default_dnsmasq_server();
+    ASSERT_FALSE(dns.get_ip_for(hw_addr));
+
+    make_lease_entry();
+
+    auto ip = dns.get_ip_for(hw_addr);
+    ASSERT_TRUE(ip);
+    EXPECT_EQ(ip.value(), mp::IPAddress(expected_ip));
+}
+
+TEST_F(DNSMasqServer, forgetsIpNoLongerLeased)
+{
+    auto dns = make_default_dnsmasq_server();
+    make_lease_entry();
+    ASSERT_TRUE(dns.get_ip_for(hw_addr));
+
+    std::ofstream{QDir{data_dir.path()}.filePath("dnsmasq.leases").toStdString(),
+                  std::ios::trunc};
+
+    EXPECT_FALSE(dns.get_ip_for(hw_addr));
+}
+
+TEST_F(DNSMasqServer, skipsLeasesThatAreNotIpv4)
+{
+    auto dns = make_default_dnsmasq_server();
+    mpt::make_file_with_content(QDir{data_dir.path()}.filePath("dnsmasq.leases"),
+                                "duid 00:01:00:01:2c:c1:9c:7a:52:54:00:9c:5e:e1\n"
+                                "0 12345 fd42::1 other_name *\n" +
+                                    lease_entry);
+
+    auto ip = dns.get_ip_for(hw_addr);
+    ASSERT_TRUE(ip);
+    EXPECT_EQ(ip.value(), mp::IPAddress(expected_ip));
+}
+
+TEST_F(DNSMasqServer, waitForIpReturnsIpLeasedWhileWaiting)
+{
+    auto dns = make_default_dnsmasq_server();
+
+    auto leased = std::async(std::launch::async, [this] {
+        std::this_thread::sleep_for(50ms);
+        make_lease_entry();
+    });
+
+    auto ip = dns.wait_for_ip_for(hw_addr, 10s);
+    leased.get();
+
+    ASSERT_TRUE(ip);
+    EXPECT_EQ(ip.value(), mp::IPAddress(expected_ip));
+}
+
+TEST_F(DNSMasqServer, waitForIpTimesOutWithoutLease)
+{
+    auto dns = make_default_dnsmasq_server();
+
+    EXPECT_FALSE(dns.wait_for_ip_for(hw_addr, 10ms));
+}
+
 TEST_F(DNSMasqServer, releaseMacReleasesIp)
 {
     const QString dhcp_release_called{QDir{data_dir.path()}.filePath("dhcp_release_called")};
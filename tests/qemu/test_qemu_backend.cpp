@@ -23,6 +23,7 @@
 #include "tests/mock_logger.h"
 #include "tests/mock_platform.h"
 #include "tests/mock_process_factory.h"
+#include "tests/mock_settings.h"
 #include "tests/mock_snapshot.h"
 #include "tests/mock_status_monitor.h"
 #include "tests/mock_virtual_machine.h"
@@ -38,6 +39,7 @@
 #include <src/platform/backends/qemu/qemu_virtual_machine_factory.h>
 
 #include <multipass/auto_join_thread.h>
+#include <multipass/constants.h>
 #include <multipass/exceptions/start_exception.h>
 #include <multipass/exceptions/virtual_machine_state_exceptions.h>
 #include <multipass/memory_size.h>
@@ -47,6 +49,7 @@
 #include <multipass/virtual_machine_description.h>
 #include <multipass/vm_specs.h>
 
+#include <QFile>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
@@ -153,7 +156,7 @@ struct QemuBackend : public mpt::TestWithMockedBinPath
                             EXPECT_CALL(*process, read_all_standard_output())
                                 .WillRepeatedly(Return("{\"timestamp\": {\"seconds\": 1541188919, "
                                                        "\"microseconds\": 838498}, \"event\": "
-                                                       "\"RESUME\"}"));
+                                                       "\"RESUME\"}\r\n"));
 
                             EXPECT_CALL(*process, kill()).WillOnce([process] {
                                 mp::ProcessState exit_state{
@@ -179,6 +182,50 @@ struct QemuBackend : public mpt::TestWithMockedBinPath
         }
     };
 
+    static void emit_qmp_message(mpt::MockProcess* process, const QJsonObject& message)
+    {
+        EXPECT_CALL(*process, read_all_standard_output())
+            .WillOnce(Return(QJsonDocument{message}.toJson(QJsonDocument::Compact) + "\r\n"));
+        emit process->ready_read_standard_output();
+    }
+
+    // Replies to every QMP command, reporting migrations with the given status, and records the
+    // commands. Like QEMU, it signals that the guest runs again when told to continue.
+    static void answer_qmp_commands(mpt::MockProcess* process,
+                                    std::vector<QJsonObject>& commands,
+                                    const QString& migration_status = "completed")
+    {
+        auto answer = [&commands, process, migration_status](const QByteArray& data) {
+            const auto command = QJsonDocument::fromJson(data).object();
+            commands.push_back(command);
+
+            QJsonObject reply;
+            reply.insert("id", command["id"]);
+            reply.insert("return",
+                         command["execute"] == "query-migrate"
+                             ? QJsonObject{{"status", migration_status}}
+                             : QJsonObject{});
+            emit_qmp_message(process, reply);
+
+            if (command["execute"] == "cont")
+                emit_qmp_message(process, QJsonObject{{"event", "RESUME"}});
+
+            return data.size();
+        };
+
+        EXPECT_CALL(*process, write(_)).WillRepeatedly(answer);
+    }
+
+    static std::optional<QJsonObject> find_command(const std::vector<QJsonObject>& commands,
+                                                   const QString& name)
+    {
+        const auto it = std::find_if(commands.cbegin(), commands.cend(), [&name](const auto& c) {
+            return c["execute"] == name;
+        });
+
+        return it == commands.cend() ? std::nullopt : std::make_optional(*it);
+    }
+
     mpt::MockLogger::Scope logger_scope{mpt::MockLogger::inject()};
 
     mpt::SetEnvScope env_scope{"DISABLE_APPARMOR", "1"};
@@ -268,6 +315,186 @@ TEST_F(QemuBackend, machineStartSuspendSendsMonitoringEvent)
     machine->suspend();
 }
 
+TEST_F(QemuBackend, suspendsToFileWhenConfigured)
+{
+    EXPECT_CALL(*mock_qemu_platform_factory, make_qemu_platform(_)).WillOnce([this](auto...) {
+        return std::move(mock_qemu_platform);
+    });
+
+    auto [mock_settings, guard] = mpt::MockSettings::inject<NiceMock>();
+    ON_CALL(*mock_settings, get(Eq(mp::suspend_format_key)))
+        .WillByDefault(Return(mp::suspend_format_file));
+
+    std::vector<QJsonObject> commands;
+    process_factory->register_callback([&commands](mpt::MockProcess* process) {
+        handle_qemu_system(process);
+        if (process->program().contains("qemu-system") &&
+            !process->arguments().contains("-dump-vmstate"))
+        {
+            answer_qmp_commands(process, commands);
+            EXPECT_CALL(*process, kill());
+        }
+    });
+
+    NiceMock<mpt::MockVMStatusMonitor> mock_monitor;
+    mp::QemuVirtualMachineFactory backend{data_dir.path()};
+    auto machine = backend.create_virtual_machine(default_description, key_provider, mock_monitor);
+    machine->start();
+    machine->state = mp::VirtualMachine::State::running;
+
+    EXPECT_CALL(mock_monitor, on_suspend());
+    EXPECT_CALL(mock_monitor,
+                update_metadata_for(_, Truly([](const QJsonObject& metadata) {
+                                        return metadata["suspend_timings"]["format"] == "file";
+                                    })));
+    machine->suspend();
+
+    EXPECT_EQ(machine->current_state(), mp::VirtualMachine::State::suspended);
+    EXPECT_TRUE(find_command(commands, "migrate-set-capabilities"));
+    EXPECT_TRUE(find_command(commands, "stop"));
+    EXPECT_FALSE(find_command(commands, "human-monitor-command"));
+
+    const auto migrate = find_command(commands, "migrate");
+    ASSERT_TRUE(migrate);
+    EXPECT_EQ((*migrate)["arguments"]["uri"].toString(),
+              "file:" + default_description.image.image_path + ".suspend");
+}
+
+TEST_F(QemuBackend, resumesFromSuspensionFile)
+{
+    EXPECT_CALL(*mock_qemu_platform_factory, make_qemu_platform(_)).WillOnce([this](auto...) {
+        return std::move(mock_qemu_platform);
+    });
+
+    const auto suspend_file = default_description.image.image_path + ".suspend";
+    QFile{suspend_file}.open(QIODevice::WriteOnly);
+
+    std::vector<QJsonObject> commands;
+    mpt::MockProcess* qemu_process = nullptr;
+    process_factory->register_callback([&commands, &qemu_process](mpt::MockProcess* process) {
+        handle_qemu_system(process);
+        if (process->program().contains("qemu-system") &&
+            !process->arguments().contains("-dump-vmstate"))
+        {
+            answer_qmp_commands(process, commands);
+            qemu_process = process;
+        }
+    });
+
+    mp::QemuVirtualMachineFactory backend{data_dir.path()};
+    auto machine = backend.create_virtual_machine(default_description, key_provider, stub_monitor);
+    ASSERT_EQ(machine->current_state(), mp::VirtualMachine::State::suspended);
+
+    machine->start();
+    ASSERT_TRUE(qemu_process);
+
+    // The state is loaded in the background, the start does not wait for it
+    EXPECT_FALSE(find_command(commands, "cont"));
+    EXPECT_FALSE(find_command(commands, "query-migrate"));
+
+    emit_qmp_message(
+        qemu_process,
+        QJsonObject{{"event", "MIGRATION"}, {"data", QJsonObject{{"status", "completed"}}}});
+    machine->state = mp::VirtualMachine::State::running;
+
+    auto processes = process_factory->process_list();
+    auto qemu = std::find_if(processes.cbegin(), processes.cend(), [](const auto& process_info) {
+        return process_info.command.startsWith("qemu-system-");
+    });
+
+    ASSERT_TRUE(qemu != processes.cend());
+    EXPECT_TRUE(qemu->arguments.contains("-incoming"));
+    EXPECT_FALSE(qemu->arguments.contains("-loadvm"));
+
+    const auto incoming = find_command(commands, "migrate-incoming");
+    ASSERT_TRUE(incoming);
+    EXPECT_EQ((*incoming)["arguments"]["uri"].toString(), "file:" + suspend_file);
+    EXPECT_TRUE(find_command(commands, "cont"));
+    EXPECT_FALSE(QFile::exists(suspend_file));
+}
+
+TEST_F(QemuBackend, suspendToFileResumesGuestWhenMigrationFails)
+{
+    EXPECT_CALL(*mock_qemu_platform_factory, make_qemu_platform(_)).WillOnce([this](auto...) {
+        return std::move(mock_qemu_platform);
+    });
+
+    auto [mock_settings, guard] = mpt::MockSettings::inject<NiceMock>();
+    ON_CALL(*mock_settings, get(Eq(mp::suspend_format_key)))
+        .WillByDefault(Return(mp::suspend_format_file));
+
+    std::vector<QJsonObject> commands;
+    process_factory->register_callback([&commands](mpt::MockProcess* process) {
+        handle_qemu_system(process);
+        if (process->program().contains("qemu-system") &&
+            !process->arguments().contains("-dump-vmstate"))
+        {
+            answer_qmp_commands(process, commands, "failed");
+            EXPECT_CALL(*process, kill()).Times(0);
+        }
+    });
+
+    NiceMock<mpt::MockVMStatusMonitor> mock_monitor;
+    mp::QemuVirtualMachineFactory backend{data_dir.path()};
+    auto machine = backend.create_virtual_machine(default_description, key_provider, mock_monitor);
+    machine->start();
+    machine->state = mp::VirtualMachine::State::running;
+
+    EXPECT_CALL(mock_monitor, on_suspend()).Times(0);
+    EXPECT_THROW(machine->suspend(), std::runtime_error);
+
+    EXPECT_EQ(machine->current_state(), mp::VirtualMachine::State::running);
+    EXPECT_TRUE(find_command(commands, "cont"));
+    EXPECT_FALSE(QFile::exists(default_description.image.image_path + ".suspend"));
+}
+
+TEST_F(QemuBackend, failedResumeFromSuspensionFileStopsQemuAndDropsTheFile)
+{
+    EXPECT_CALL(*mock_qemu_platform_factory, make_qemu_platform(_)).WillOnce([this](auto...) {
+        return std::move(mock_qemu_platform);
+    });
+
+    const auto suspend_file = default_description.image.image_path + ".suspend";
+    QFile{suspend_file}.open(QIODevice::WriteOnly);
+
+    std::vector<QJsonObject> commands;
+    mpt::MockProcess* qemu_process = nullptr;
+    process_factory->register_callback([&commands, &qemu_process](mpt::MockProcess* process) {
+        handle_qemu_system(process);
+        if (process->program().contains("qemu-system") &&
+            !process->arguments().contains("-dump-vmstate"))
+        {
+            answer_qmp_commands(process, commands);
+            qemu_process = process;
+        }
+    });
+
+    mp::QemuVirtualMachineFactory backend{data_dir.path()};
+    auto machine = backend.create_virtual_machine(default_description, key_provider, stub_monitor);
+    machine->start();
+    ASSERT_TRUE(qemu_process);
+
+    logger_scope.mock_logger->expect_log(mpl::Level::error,
+                                         "Could not restore the suspended state");
+    EXPECT_CALL(*qemu_process, kill()).WillOnce([qemu_process] {
+        ON_CALL(*qemu_process, running()).WillByDefault(Return(false));
+    });
+    emit_qmp_message(
+        qemu_process,
+        QJsonObject{{"event", "MIGRATION"}, {"data", QJsonObject{{"status", "failed"}}}});
+
+    EXPECT_FALSE(find_command(commands, "cont"));
+    EXPECT_FALSE(QFile::exists(suspend_file));
+
+    // What the wait for SSH runs into
+    MP_EXPECT_THROW_THAT(machine->ensure_vm_is_running(),
+                         mp::StartException,
+                         mpt::match_what(HasSubstr("Could not restore the suspended state")));
+
+    emit qemu_process->finished(mp::ProcessState{9, std::nullopt});
+    EXPECT_EQ(machine->current_state(), mp::VirtualMachine::State::off);
+}
+
 TEST_F(QemuBackend, throwsWhenShutdownWhileStarting)
 {
     mpt::MockProcess* vmproc = nullptr;
@@ -720,6 +947,61 @@ TEST_F(QemuBackend, verifySomeCommonQemuArguments)
     EXPECT_TRUE(qemu_args.contains("null,id=char0"));
 }
 
+TEST_F(QemuBackend, runsMountHelpersBeforeLaunchingQemu)
+{
+    EXPECT_CALL(*mock_qemu_platform_factory, make_qemu_platform(_)).WillOnce([this](auto...) {
+        return std::move(mock_qemu_platform);
+    });
+
+    bool qemu_launched = false;
+    process_factory->register_callback([&qemu_launched](mpt::MockProcess* process) {
+        if (process->program().startsWith("qemu-system-") &&
+            !process->arguments().contains("-dump-vmstate"))
+        {
+            EXPECT_CALL(*process, start).WillOnce([&qemu_launched, process] {
+                qemu_launched = true;
+                emit process->started();
+            });
+        }
+    });
+
+    mp::QemuVirtualMachineFactory backend{data_dir.path()};
+    auto machine = backend.create_virtual_machine(default_description, key_provider, stub_monitor);
+
+    int helper_calls = 0;
+    dynamic_cast<mp::QemuVirtualMachine&>(*machine).modifiable_mount_helpers()["tag"] = [&] {
+        EXPECT_FALSE(qemu_launched);
+        ++helper_calls;
+    };
+
+    machine->start();
+    machine->state = mp::VirtualMachine::State::running;
+
+    EXPECT_TRUE(qemu_launched);
+    EXPECT_EQ(helper_calls, 1);
+}
+
+TEST_F(QemuBackend, refusesToSuspendWithMountHelpers)
+{
+    EXPECT_CALL(*mock_qemu_platform_factory, make_qemu_platform(_)).WillOnce([this](auto...) {
+        return std::move(mock_qemu_platform);
+    });
+
+    process_factory->register_callback(handle_qemu_system);
+
+    mp::QemuVirtualMachineFactory backend{data_dir.path()};
+    auto machine = backend.create_virtual_machine(default_description, key_provider, stub_monitor);
+    dynamic_cast<mp::QemuVirtualMachine&>(*machine).modifiable_mount_helpers()["tag"] = [] {};
+
+    machine->start();
+    machine->state = mp::VirtualMachine::State::running;
+
+    MP_EXPECT_THROW_THAT(machine->suspend(),
+                         std::runtime_error,
+                         mpt::match_what(HasSubstr("while it has virtiofs mounts")));
+    EXPECT_EQ(machine->current_state(), mp::VirtualMachine::State::running);
+}
+
 TEST_F(QemuBackend, verifyQemuArgumentsWhenResumingSuspendImage)
 {
     EXPECT_CALL(*mock_qemu_platform_factory, make_qemu_platform(_)).WillOnce([this](auto...) {
@@ -1024,6 +1306,60 @@ TEST_F(QemuBackend, supportsSnapshots)
     EXPECT_NO_THROW(vm.require_snapshots_support());
 }
 
+TEST_F(QemuBackend, supportsLiveSnapshots)
+{
+    EXPECT_CALL(*mock_qemu_platform_factory, make_qemu_platform(_)).WillOnce([this](auto...) {
+        return std::move(mock_qemu_platform);
+    });
+
+    mp::QemuVirtualMachineFactory backend{data_dir.path()};
+    auto machine = backend.create_virtual_machine(default_description, key_provider, stub_monitor);
+
+    EXPECT_TRUE(machine->supports_live_snapshots());
+}
+
+TEST_F(QemuBackend, capturesLiveSnapshotsThroughQmp)
+{
+    EXPECT_CALL(*mock_qemu_platform_factory, make_qemu_platform(_)).WillOnce([this](auto...) {
+        return std::move(mock_qemu_platform);
+    });
+
+    QJsonObject snapshot_arguments;
+    process_factory->register_callback([&snapshot_arguments](mpt::MockProcess* process) {
+        handle_qemu_system(process);
+        if (!process->program().contains("qemu-system") ||
+            process->arguments().contains("-dump-vmstate"))
+            return;
+
+        EXPECT_CALL(*process, write(_)).WillRepeatedly([&, process](const QByteArray& data) {
+            const auto command = QJsonDocument::fromJson(data).object();
+            if (command["execute"] == "blockdev-snapshot-internal-sync")
+            {
+                snapshot_arguments = command["arguments"].toObject();
+
+                QJsonObject reply;
+                reply.insert("return", QJsonObject{});
+                reply.insert("id", command["id"]);
+                EXPECT_CALL(*process, read_all_standard_output())
+                    .WillOnce(Return(QJsonDocument{reply}.toJson(QJsonDocument::Compact) + "\r\n"));
+                emit process->ready_read_standard_output();
+            }
+
+            return data.size();
+        });
+    });
+
+    mp::QemuVirtualMachineFactory backend{data_dir.path()};
+    auto machine = backend.create_virtual_machine(default_description, key_provider, stub_monitor);
+    machine->start();
+    machine->state = mp::VirtualMachine::State::running;
+
+    dynamic_cast<mp::QemuVirtualMachine&>(*machine).capture_live_snapshot("@s1");
+
+    EXPECT_EQ(snapshot_arguments["device"].toString(), "hda");
+    EXPECT_EQ(snapshot_arguments["name"].toString(), "@s1");
+}
+
 TEST_F(QemuBackend, createsQemuSnapshotsFromSpecs)
 {
     MockQemuVM machine{"mock-qemu-vm", key_provider};
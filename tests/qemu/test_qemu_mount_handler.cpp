@@ -18,6 +18,7 @@
 #include "tests/common.h"
 #include "tests/mock_file_ops.h"
 #include "tests/mock_logger.h"
+#include "tests/mock_process_factory.h"
 #include "tests/mock_server_reader_writer.h"
 #include "tests/mock_ssh_process_exit_status.h"
 #include "tests/mock_ssh_test_fixture.h"
@@ -44,6 +45,7 @@ struct MockQemuVirtualMachine : mpt::MockVirtualMachineT<mp::QemuVirtualMachine>
     }
 
     MOCK_METHOD(mp::QemuVirtualMachine::MountArgs&, modifiable_mount_args, (), (override));
+    MOCK_METHOD(mp::QemuVirtualMachine::MountHelpers&, modifiable_mount_helpers, (), (override));
 };
 
 struct CommandOutput
@@ -78,6 +80,11 @@ std::string command_mount(const std::string& target)
                        target);
 }
 
+std::string command_mount_virtiofs(const std::string& target)
+{
+    return fmt::format("sudo mount -t virtiofs {} {}", tag_from_target(target), target);
+}
+
 std::string command_umount(const std::string& target)
 {
     return fmt::format("if mountpoint -q {0}; then sudo umount {0}; else true; fi", target);
@@ -164,6 +171,23 @@ struct QemuMountHandlerTest : public ::Test
     };
 };
 
+struct QemuVirtiofsMountHandlerTest : public QemuMountHandlerTest
+{
+    QemuVirtiofsMountHandlerTest()
+    {
+        EXPECT_CALL(vm, modifiable_mount_helpers).WillOnce(ReturnRef(mount_helpers));
+        command_outputs.insert({command_mount_virtiofs(default_target), {""}});
+        command_outputs.insert(
+            {fmt::format("findmnt --type virtiofs | grep '{} {}'",
+                         default_target,
+                         tag_from_target(default_target)),
+             {""}});
+    }
+
+    const mp::QemuMountHandler::VirtiofsOptions options{"always"};
+    mp::QemuVirtualMachine::MountHelpers mount_helpers;
+};
+
 struct QemuMountHandlerFailCommand : public QemuMountHandlerTest,
                                      public testing::WithParamInterface<std::string>
 {
@@ -332,3 +356,86 @@ TEST_P(QemuMountHandlerFailCommand, throwOnFail)
                          std::runtime_error,
                          mpt::match_what(StrEq(error)));
 }
+
+TEST_F(QemuVirtiofsMountHandlerTest, mountHandlesMountArgsAndHelpers)
+{
+    {
+        mp::QemuMountHandler handler{&vm, &key_provider, default_target, mount, options};
+        ASSERT_EQ(mount_args.size(), 1);
+        EXPECT_EQ(mount_helpers.size(), 1);
+
+        const auto tag = tag_from_target(default_target);
+        const auto& args = mount_args.begin()->second.second;
+        ASSERT_EQ(args.size(), 4);
+        EXPECT_EQ(args[0], "-chardev");
+        EXPECT_TRUE(args[1].startsWith(
+            QString::fromStdString(fmt::format("socket,id={},path=", tag))));
+        EXPECT_TRUE(args[1].endsWith(QString::fromStdString(
+            fmt::format("/virtiofs-{}.sock", tag.substr(1, 8)))));
+        EXPECT_EQ(args[2], "-device");
+        EXPECT_EQ(args[3].toStdString(),
+                  fmt::format("vhost-user-fs-pci,queue-size=1024,chardev={},tag={}", tag, tag));
+    }
+
+    EXPECT_EQ(mount_args.size(), 0);
+    EXPECT_EQ(mount_helpers.size(), 0);
+}
+
+TEST_F(QemuVirtiofsMountHandlerTest, helperStartsVirtiofsd)
+{
+    auto process_factory = mpt::MockProcessFactory::Inject();
+    EXPECT_CALL(mock_file_ops, remove(An<QFile&>())).WillOnce(Return(true));
+    EXPECT_CALL(mock_file_ops, exists(An<const QFile&>())).WillOnce(Return(true));
+
+    mp::QemuMountHandler handler{&vm, &key_provider, default_target, mount, options};
+    ASSERT_EQ(mount_helpers.size(), 1);
+    mount_helpers.begin()->second();
+
+    const auto processes = process_factory->process_list();
+    ASSERT_EQ(processes.size(), 1);
+    EXPECT_TRUE(processes.front().command.endsWith("virtiofsd"));
+    EXPECT_THAT(processes.front().arguments,
+                AllOf(Contains(QString{"--shared-dir=%1"}.arg(default_source.c_str())),
+                      Contains("--cache=always"),
+                      Contains("--translate-uid=map:6:5:1"),
+                      Contains("--translate-gid=map:2:1:1")));
+}
+
+TEST_F(QemuVirtiofsMountHandlerTest, helperThrowsWhenVirtiofsdQuits)
+{
+    auto process_factory = mpt::MockProcessFactory::Inject();
+    process_factory->register_callback([](mpt::MockProcess* process) {
+        EXPECT_CALL(*process, running).WillRepeatedly(Return(false));
+        EXPECT_CALL(*process, read_all_standard_error).WillOnce(Return("no such directory"));
+    });
+    EXPECT_CALL(mock_file_ops, exists(An<const QFile&>())).WillOnce(Return(false));
+
+    mp::QemuMountHandler handler{&vm, &key_provider, default_target, mount, options};
+    MP_EXPECT_THROW_THAT(mount_helpers.begin()->second(),
+                         std::runtime_error,
+                         mpt::match_what(AllOf(HasSubstr("virtiofsd failed"),
+                                               HasSubstr("no such directory"))));
+}
+
+TEST_F(QemuVirtiofsMountHandlerTest, startSuccessStopSuccess)
+{
+    std::string ssh_command_output;
+    REPLACE(ssh_channel_request_exec, mocked_ssh_channel_request_exec(ssh_command_output));
+    REPLACE(ssh_channel_read_timeout, mocked_ssh_channel_read_timeout(ssh_command_output));
+
+    mp::QemuMountHandler handler{&vm, &key_provider, default_target, mount, options};
+    EXPECT_NO_THROW(handler.activate(&server));
+    EXPECT_TRUE(handler.is_active());
+    EXPECT_NO_THROW(handler.deactivate());
+}
+
+TEST_F(QemuVirtiofsMountHandlerTest, recoverFromSuspendedWithTheSameDevices)
+{
+    mount_args[tag_from_target(default_target)] = {default_source,
+                                                   {"-device", "vhost-user-fs-pci,tag=m"}};
+    EXPECT_CALL(vm, current_state()).WillOnce(Return(mp::VirtualMachine::State::suspended));
+
+    // virtiofs settings no longer in place
+    mp::QemuMountHandler handler{&vm, &key_provider, default_target, mount};
+    EXPECT_EQ(mount_helpers.size(), 1);
+}
@@ -53,6 +53,14 @@ struct PublicQemuSnapshot : public mp::QemuSnapshot
     // clang-format on
 };
 
+struct MockQemuVirtualMachine : public mpt::MockVirtualMachineT<mp::QemuVirtualMachine>
+{
+    using mpt::MockVirtualMachineT<mp::QemuVirtualMachine>::MockVirtualMachineT;
+
+    MOCK_METHOD(void, capture_live_snapshot, (const QString&), (override));
+    MOCK_METHOD(bool, erase_live_snapshot, (const QString&), (override));
+};
+
 struct TestQemuSnapshot : public Test
 {
     using ArgsMatcher = Matcher<QStringList>;
@@ -92,7 +100,7 @@ struct TestQemuSnapshot : public Test
     }();
 
     mpt::StubSSHKeyProvider key_provider{};
-    NiceMock<mpt::MockVirtualMachineT<mp::QemuVirtualMachine>> vm{"qemu-vm", key_provider};
+    NiceMock<MockQemuVirtualMachine> vm{"qemu-vm", key_provider};
     ArgsMatcher list_args_matcher = ElementsAre("snapshot", "-l", desc.image.image_path);
     const mpt::MockCloudInitFileOps::GuardedMock mock_cloud_init_file_ops_injection =
         mpt::MockCloudInitFileOps::inject<NiceMock>();
@@ -229,6 +237,22 @@ TEST_F(TestQemuSnapshot, captureThrowsOnRepeatedTag)
                                                HasSubstr(desc.image.image_path.toStdString()))));
 }
 
+TEST_F(TestQemuSnapshot, capturesLiveSnapshotOfRunningInstance)
+{
+    auto snapshot_index = 5;
+    auto snapshot_tag = derive_tag(snapshot_index);
+    EXPECT_CALL(vm, get_snapshot_count).WillOnce(Return(snapshot_index - 1));
+    EXPECT_CALL(vm, current_state).WillRepeatedly(Return(mp::VirtualMachine::State::running));
+    EXPECT_CALL(vm, capture_live_snapshot(Eq(QString::fromStdString(snapshot_tag))));
+
+    auto mock_factory_scope = mpt::MockProcessFactory::Inject();
+    mock_factory_scope->register_callback([](mpt::MockProcess* process) {
+        ADD_FAILURE() << "Unexpected process: " << process->program().toStdString();
+    });
+
+    quick_snapshot().capture();
+}
+
 TEST_F(TestQemuSnapshot, erasesSnapshot)
 {
     auto snapshot = loaded_snapshot();
@@ -279,6 +303,34 @@ TEST_F(TestQemuSnapshot, eraseLogsOnMissingTag)
     snapshot.erase();
 }
 
+TEST_F(TestQemuSnapshot, erasesLiveSnapshotOfRunningInstance)
+{
+    auto snapshot = loaded_snapshot();
+    EXPECT_CALL(vm, current_state).WillRepeatedly(Return(mp::VirtualMachine::State::running));
+    const auto tag = QString::fromStdString(derive_tag(snapshot.get_index()));
+    EXPECT_CALL(vm, erase_live_snapshot(Eq(tag))).WillOnce(Return(true));
+
+    auto mock_factory_scope = mpt::MockProcessFactory::Inject();
+    mock_factory_scope->register_callback([](mpt::MockProcess* process) {
+        ADD_FAILURE() << "Unexpected process: " << process->program().toStdString();
+    });
+
+    snapshot.erase();
+}
+
+TEST_F(TestQemuSnapshot, eraseLogsOnMissingLiveSnapshot)
+{
+    auto snapshot = loaded_snapshot();
+    EXPECT_CALL(vm, current_state).WillRepeatedly(Return(mp::VirtualMachine::State::running));
+    EXPECT_CALL(vm, erase_live_snapshot).WillOnce(Return(false));
+
+    auto expected_log_level = mpl::Level::warning;
+    auto logger_scope = mpt::MockLogger::inject(expected_log_level);
+    logger_scope.mock_logger->expect_log(expected_log_level, "Could not find");
+
+    snapshot.erase();
+}
+
 TEST_F(TestQemuSnapshot, appliesSnapshot)
 {
     auto snapshot = loaded_snapshot();
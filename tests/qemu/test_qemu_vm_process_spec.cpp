@@ -21,6 +21,7 @@
 #include <src/platform/backends/qemu/qemu_vm_process_spec.h>
 
 #include <QDir>
+#include <QFile>
 #include <QString>
 #include <QStringList>
 #include <QTemporaryDir>
@@ -29,6 +30,22 @@ namespace mp = multipass;
 namespace mpt = multipass::test;
 using namespace testing;
 
+namespace
+{
+// Writes just enough of a qcow2 header for the image to refer to a backing file
+void make_overlay_header(const QString& path, const QByteArray& backing_name)
+{
+    QByteArray header{"QFI\xfb\0\0\0\3", 8};
+    header.append(QByteArray{"\0\0\0\0\0\0\0\x14", 8}); // backing name offset: 20
+    header.append(QByteArray{"\0\0\0", 3}).append(static_cast<char>(backing_name.size()));
+    header.append(backing_name);
+
+    QFile file{path};
+    ASSERT_TRUE(file.open(QIODevice::WriteOnly));
+    file.write(header);
+}
+} // namespace
+
 struct TestQemuVMProcessSpec : public Test
 {
     const mp::VirtualMachineDescription desc{2 /*cores*/,
@@ -86,6 +103,27 @@ TEST_F(TestQemuVMProcessSpec, defaultArgumentsCorrect)
                            "path=path/to/target,mount_tag=m810e457178f448d9afffc9d950d726"}));
 }
 
+TEST_F(TestQemuVMProcessSpec, virtiofsMountsShareGuestMemory)
+{
+    const std::unordered_map<std::string, std::pair<std::string, QStringList>> virtiofs_args{
+        {"path/to/target",
+         {"path/to/source",
+          {"-chardev",
+           "socket,id=mtag,path=/path/to/virtiofs-tag.sock",
+           "-device",
+           "vhost-user-fs-pci,queue-size=1024,chardev=mtag,tag=mtag"}}}};
+
+    mp::QemuVMProcessSpec spec(desc, platform_args, virtiofs_args, std::nullopt);
+    const auto args = spec.arguments();
+
+    const auto memory_object = args.indexOf("memory-backend-memfd,id=mem,size=3072M,share=on");
+    ASSERT_GT(memory_object, 0);
+    EXPECT_EQ(args.at(memory_object - 1), "-object");
+    EXPECT_EQ(args.at(memory_object + 1), "-machine");
+    EXPECT_EQ(args.at(memory_object + 2), "memory-backend=mem");
+    EXPECT_TRUE(args.endsWith("vhost-user-fs-pci,queue-size=1024,chardev=mtag,tag=mtag"));
+}
+
 TEST_F(TestQemuVMProcessSpec, resumeArgumentsTakenFromResumedata)
 {
     const mp::QemuVMProcessSpec::ResumeData resume_data{"suspend_tag",
@@ -100,6 +138,21 @@ TEST_F(TestQemuVMProcessSpec, resumeArgumentsTakenFromResumedata)
                   << mount_args.begin()->second.second);
 }
 
+TEST_F(TestQemuVMProcessSpec, resumeFromFileDefersIncomingMigration)
+{
+    const mp::QemuVMProcessSpec::ResumeData resume_data{"suspend_tag",
+                                                        "machine_type",
+                                                        false,
+                                                        {"-one", "-two"},
+                                                        true};
+
+    mp::QemuVMProcessSpec spec(desc, platform_args, mount_args, resume_data);
+
+    EXPECT_EQ(spec.arguments(),
+              QStringList({"-one", "-two", "-incoming", "defer", "-machine", "machine_type"})
+                  << mount_args.begin()->second.second);
+}
+
 TEST_F(TestQemuVMProcessSpec, resumeWithMissingMachineTypeGuessesCorrectly)
 {
     mp::QemuVMProcessSpec::ResumeData resume_data_missing_machine_info;
@@ -149,6 +202,22 @@ TEST_F(TestQemuVMProcessSpec, apparmorProfileIncludesDiskImages)
 
     EXPECT_TRUE(spec.apparmor_profile().contains("/path/to/image rwk,"));
     EXPECT_TRUE(spec.apparmor_profile().contains("/path/to/cloud_init.iso rk,"));
+    EXPECT_TRUE(spec.apparmor_profile().contains("/path/to/image.suspend rw,"));
+    EXPECT_TRUE(spec.apparmor_profile().contains("/path/to/virtiofs-*.sock rw,"));
+}
+
+TEST_F(TestQemuVMProcessSpec, apparmorProfileAllowsReadingBackingImage)
+{
+    QTemporaryDir dir;
+    const auto backing_image = dir.filePath("cached.img");
+    auto overlay_desc = desc;
+    overlay_desc.image.image_path = dir.filePath("instance.img");
+    make_overlay_header(overlay_desc.image.image_path, backing_image.toUtf8());
+
+    mp::QemuVMProcessSpec spec(overlay_desc, platform_args, mount_args, std::nullopt);
+
+    EXPECT_TRUE(spec.apparmor_profile().contains(QString("%1 rk,").arg(backing_image)));
+    EXPECT_FALSE(spec.apparmor_profile().contains(QString("%1 rwk,").arg(backing_image)));
 }
 
 TEST_F(TestQemuVMProcessSpec, apparmorProfileIdentifier)
@@ -0,0 +1,202 @@
+/*
+ * Copyright (C) Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "tests/common.h"
+
+#include <src/platform/backends/qemu/qmp_client.h>
+
+#include <QJsonDocument>
+
+#include <chrono>
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+namespace mp = multipass;
+namespace mpt = multipass::test;
+using namespace testing;
+using namespace std::chrono_literals;
+
+namespace
+{
+// Stands in for QEMU: answers each command with a scripted reply, optionally after some events,
+// and delivers its output in small pieces that do not line up with the messages
+struct ScriptedQmpEndpoint
+{
+    void reply(const QJsonObject& message)
+    {
+        output += QJsonDocument(message).toJson(QJsonDocument::Compact) + "\r\n";
+    }
+
+    void event(const QString& name)
+    {
+        reply(QJsonObject{{"event", name}, {"data", QJsonObject{{"reason", "test"}}}});
+    }
+
+    void handle(const QByteArray& data)
+    {
+        EXPECT_TRUE(data.endsWith('\n'));
+        const auto command = QJsonDocument::fromJson(data).object();
+        commands.push_back(command);
+
+        const auto name = command["execute"].toString();
+        for (const auto& event_name : events_before[name])
+            event(event_name);
+
+        if (auto it = errors.find(name); it != errors.end())
+            reply({{"error", QJsonObject{{"class", "GenericError"}, {"desc", it->second}}},
+                   {"id", command["id"]}});
+        else if (!held.count(name))
+            reply({{"return", returns[name]}, {"id", command["id"]}});
+    }
+
+    void flush(mp::QmpClient& client, qsizetype chunk_size = 7)
+    {
+        const auto data = std::exchange(output, {});
+        for (qsizetype pos = 0; pos < data.size(); pos += chunk_size)
+            client.receive(data.mid(pos, chunk_size));
+    }
+
+    std::vector<QJsonObject> commands;
+    std::map<QString, QJsonValue> returns;
+    std::map<QString, QString> errors;
+    std::map<QString, std::vector<QString>> events_before;
+    std::set<QString> held;
+    QByteArray output;
+};
+
+struct QmpClient : public Test
+{
+    QmpClient()
+    {
+        QObject::connect(&client,
+                         &mp::QmpClient::event_received,
+                         [this](const QString& event, const QJsonObject&) {
+                             events.push_back(event);
+                         });
+    }
+
+    template <typename T>
+    static bool is_ready(const std::future<T>& future)
+    {
+        return future.wait_for(0s) == std::future_status::ready;
+    }
+
+    ScriptedQmpEndpoint endpoint;
+    mp::QmpClient client{[this](const QByteArray& data) { endpoint.handle(data); }};
+    std::vector<QString> events;
+};
+} // namespace
+
+TEST_F(QmpClient, sendsCommandsWithIdsAndArguments)
+{
+    client.execute("set_link", {{"name", "net0"}, {"up", false}});
+    client.execute("query-status");
+
+    ASSERT_EQ(endpoint.commands.size(), 2u);
+    EXPECT_EQ(endpoint.commands[0].value("execute").toString(), "set_link");
+    EXPECT_EQ(endpoint.commands[0].value("arguments").toObject().value("name").toString(), "net0");
+    EXPECT_FALSE(endpoint.commands[1].contains("arguments"));
+    EXPECT_NE(endpoint.commands[0].value("id").toInteger(),
+              endpoint.commands[1].value("id").toInteger());
+}
+
+TEST_F(QmpClient, deliversReplyValue)
+{
+    endpoint.returns["query-balloon"] = QJsonObject{{"actual", 1073741824}};
+
+    auto reply = client.execute("query-balloon");
+    endpoint.flush(client);
+
+    ASSERT_TRUE(is_ready(reply));
+    EXPECT_EQ(reply.get().toObject().value("actual").toInteger(), 1073741824);
+}
+
+TEST_F(QmpClient, matchesRepliesToTheirCommands)
+{
+    endpoint.returns["query-cpus-fast"] = "cpus";
+    endpoint.returns["query-blockstats"] = "stats";
+    endpoint.held.insert("query-cpus-fast");
+
+    auto cpus = client.execute("query-cpus-fast");
+    auto stats = client.execute("query-blockstats");
+    endpoint.reply({{"return", "cpus"}, {"id", endpoint.commands[0].value("id")}});
+    endpoint.flush(client);
+
+    ASSERT_TRUE(is_ready(cpus));
+    ASSERT_TRUE(is_ready(stats));
+    EXPECT_EQ(cpus.get().toString(), "cpus");
+    EXPECT_EQ(stats.get().toString(), "stats");
+}
+
+TEST_F(QmpClient, passesOnAllEventsThatArriveTogether)
+{
+    endpoint.events_before["system_powerdown"] = {"POWERDOWN", "SHUTDOWN", "STOP"};
+
+    auto reply = client.execute("system_powerdown");
+    endpoint.flush(client, /* chunk_size = */ 4096);
+
+    EXPECT_THAT(events, ElementsAre("POWERDOWN", "SHUTDOWN", "STOP"));
+    EXPECT_TRUE(is_ready(reply));
+}
+
+TEST_F(QmpClient, waitsForTheRestOfSplitMessages)
+{
+    endpoint.event("RESUME");
+    const auto data = std::exchange(endpoint.output, {});
+
+    client.receive(data.left(data.size() / 2));
+    EXPECT_THAT(events, IsEmpty());
+
+    client.receive(data.mid(data.size() / 2));
+    EXPECT_THAT(events, ElementsAre("RESUME"));
+}
+
+TEST_F(QmpClient, reportsErrors)
+{
+    endpoint.errors["human-monitor-command"] = "no such snapshot";
+
+    auto reply = client.human_monitor_command("delvm nonexistent");
+    endpoint.flush(client);
+
+    EXPECT_EQ(endpoint.commands[0].value("arguments").toObject().value("command-line").toString(),
+              "delvm nonexistent");
+    MP_EXPECT_THROW_THAT(reply.get(),
+                         mp::QmpError,
+                         mpt::match_what(HasSubstr("no such snapshot")));
+}
+
+TEST_F(QmpClient, ignoresGreetingAndMalformedMessages)
+{
+    client.receive("{\"QMP\": {\"version\": {}, \"capabilities\": []}}\r\n");
+    client.receive("not json\r\n");
+    endpoint.event("RESET");
+    endpoint.flush(client);
+
+    EXPECT_THAT(events, ElementsAre("RESET"));
+}
+
+TEST_F(QmpClient, failsPendingRepliesWhenAbandoned)
+{
+    endpoint.held.insert("query-status");
+    auto reply = client.execute("query-status");
+
+    client.abandon_pending("QEMU went away");
+
+    MP_EXPECT_THROW_THAT(reply.get(), mp::QmpError, mpt::match_what(HasSubstr("went away")));
+}
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "tests/common.h"
+#include "tests/mock_environment_helpers.h"
+#include "tests/temp_dir.h"
+
+#include <src/platform/backends/qemu/virtiofsd_process_spec.h>
+
+namespace mp = multipass;
+namespace mpt = multipass::test;
+using namespace testing;
+
+struct TestVirtiofsdProcessSpec : public Test
+{
+    mp::VirtiofsdConfig config{"instance",
+                               "mtag",
+                               "/source/path",
+                               "/instance/dir/virtiofs-tag.sock",
+                               "never",
+                               {{1, 2}},
+                               {{5, -1}}};
+};
+
+TEST_F(TestVirtiofsdProcessSpec, argumentsCorrect)
+{
+    mp::VirtiofsdProcessSpec spec(config);
+
+    EXPECT_EQ(spec.arguments(),
+              QStringList({"--socket-path=/instance/dir/virtiofs-tag.sock",
+                           "--shared-dir=/source/path",
+                           "--cache=never",
+                           "--sandbox=chroot",
+                           "--translate-uid=map:1000:5:1",
+                           "--translate-gid=map:2:1:1"}));
+}
+
+TEST_F(TestVirtiofsdProcessSpec, defaultsToDefaultUserWithoutMappings)
+{
+    config.uid_mappings.clear();
+    config.gid_mappings.clear();
+    mp::VirtiofsdProcessSpec spec(config);
+
+    EXPECT_THAT(spec.arguments(),
+                AllOf(Contains("--translate-uid=map:1000:1000:1"),
+                      Contains("--translate-gid=map:1000:1000:1")));
+}
+
+TEST_F(TestVirtiofsdProcessSpec, identifierCorrect)
+{
+    mp::VirtiofsdProcessSpec spec(config);
+    EXPECT_EQ(spec.identifier(), "instance.mtag");
+}
+
+TEST_F(TestVirtiofsdProcessSpec, snapConfinedApparmorProfileReturnsExpectedData)
+{
+    mpt::TempDir bin_dir;
+    const QByteArray snap_name{"multipass"};
+
+    mpt::SetEnvScope env_scope("SNAP", bin_dir.path().toUtf8());
+    mpt::SetEnvScope env_scope2("SNAP_NAME", snap_name);
+    mp::VirtiofsdProcessSpec spec(config);
+
+    const auto apparmor_profile = spec.apparmor_profile();
+
+    EXPECT_EQ(spec.program(), bin_dir.path() + "/usr/libexec/virtiofsd");
+    EXPECT_TRUE(apparmor_profile.contains(bin_dir.path() + "/usr/libexec/virtiofsd ixr,"));
+    EXPECT_TRUE(apparmor_profile.contains("signal (receive) peer=snap.multipass.multipassd"));
+    EXPECT_TRUE(apparmor_profile.contains("/instance/dir/virtiofs-tag.sock rw,"));
+    EXPECT_TRUE(apparmor_profile.contains("/source/path/** rwlk,"));
+}
+
+TEST_F(TestVirtiofsdProcessSpec, unconfinedApparmorProfileReturnsExpectedData)
+{
+    mpt::UnsetEnvScope env_scope("SNAP");
+    mp::VirtiofsdProcessSpec spec(config);
+
+    const auto apparmor_profile = spec.apparmor_profile();
+
+    EXPECT_EQ(spec.program(), "/usr/libexec/virtiofsd");
+    EXPECT_TRUE(apparmor_profile.contains(" /usr/libexec/virtiofsd ixr,"));
+    EXPECT_TRUE(apparmor_profile.contains("signal (receive) peer=unconfined"));
+}
@@ -38,6 +38,7 @@ struct SftpServerTest : public testing::Test
         reply_status.returnValue(SSH_OK);
         get_client_msg.returnValue(nullptr);
         handle_sftp.returnValue(nullptr);
+        poll_channel.returnValue(1);
     }
 
     decltype(MOCK(sftp_server_init)) init_sftp{MOCK(sftp_server_init)};
@@ -45,6 +46,7 @@ struct SftpServerTest : public testing::Test
     decltype(MOCK(sftp_get_client_message)) get_client_msg{MOCK(sftp_get_client_message)};
     decltype(MOCK(sftp_client_message_free)) msg_free{MOCK(sftp_client_message_free)};
     decltype(MOCK(sftp_handle)) handle_sftp{MOCK(sftp_handle)};
+    decltype(MOCK(ssh_channel_poll_timeout)) poll_channel{MOCK(ssh_channel_poll_timeout)};
     MockScope<decltype(mock_sftp_free)> free_sftp;
 
     MockSSHTestFixture mock_ssh_test_fixture;
@@ -35,6 +35,13 @@ struct StubURLDownloader : public multipass::URLDownloader
                      const multipass::ProgressMonitor&) override
     {
     }
+    void stream_to(const QUrl& url,
+                   const DataHandler& on_data,
+                   int64_t size,
+                   const int download_type,
+                   const multipass::ProgressMonitor&) override
+    {
+    }
     QByteArray download(const QUrl& url) override
     {
         return {};
@@ -164,6 +164,11 @@ struct StubVirtualMachine final : public multipass::VirtualMachine
         return nullptr;
     }
 
+    bool supports_live_snapshots() const override
+    {
+        return false;
+    }
+
     std::shared_ptr<const Snapshot> take_snapshot(const VMSpecs&,
                                                   const std::string&,
                                                   const std::string&) override
@@ -312,6 +312,40 @@ TEST_F(BaseVM, getAllIpv4WorksWhenInstanceIsOff)
     EXPECT_EQ(vm.get_all_ipv4().size(), 0u);
 }
 
+TEST_F(BaseVM, getAllIpv4IsCachedBetweenCalls)
+{
+    vm.simulate_state(St::running);
+    EXPECT_CALL(vm, ssh_exec(HasSubstr("ip -brief"), _))
+        .WillOnce(Return("eth0             UP             192.168.2.168/24"));
+
+    EXPECT_THAT(vm.get_all_ipv4(), ElementsAre("192.168.2.168"));
+    EXPECT_THAT(vm.get_all_ipv4(), ElementsAre("192.168.2.168"));
+}
+
+TEST_F(BaseVM, getAllIpv4LooksUpAddressesAgainAfterReconnecting)
+{
+    vm.simulate_state(St::running);
+    EXPECT_CALL(vm, ssh_exec(HasSubstr("ip -brief"), _))
+        .WillOnce(Return("eth0             UP             192.168.2.168/24"))
+        .WillOnce(Return("eth0             UP             192.168.2.169/24"));
+
+    vm.get_all_ipv4();
+    vm.renew_ssh_session();
+
+    EXPECT_THAT(vm.get_all_ipv4(), ElementsAre("192.168.2.169"));
+}
+
+TEST_F(BaseVM, getAllIpv4DoesNotCacheFailures)
+{
+    vm.simulate_state(St::running);
+    EXPECT_CALL(vm, ssh_exec(HasSubstr("ip -brief"), _))
+        .WillOnce(Throw(mp::SSHException{"intentional"}))
+        .WillOnce(Return("eth0             UP             192.168.2.168/24"));
+
+    EXPECT_THAT(vm.get_all_ipv4(), IsEmpty());
+    EXPECT_THAT(vm.get_all_ipv4(), ElementsAre("192.168.2.168"));
+}
+
 TEST_F(BaseVM, addNetworkInterfaceThrows)
 {
     StubBaseVirtualMachine base_vm(St::off);
@@ -410,6 +444,24 @@ TEST_F(BaseVM, takesSnapshots)
     EXPECT_EQ(vm.get_num_snapshots(), 1);
 }
 
+TEST_F(BaseVM, recordsLiveSnapshotsAsStopped)
+{
+    vm.simulate_state(St::running);
+    EXPECT_CALL(vm, supports_live_snapshots).WillRepeatedly(Return(true));
+
+    mp::VMSpecs specs{};
+    specs.state = St::running;
+
+    auto snapshot = std::make_shared<NiceMock<mpt::MockSnapshot>>();
+    EXPECT_CALL(*snapshot, capture).Times(1);
+    EXPECT_CALL(vm,
+                make_specific_snapshot(_, _, _, Field(&mp::VMSpecs::state, Eq(St::stopped)), _))
+        .WillOnce(Return(snapshot));
+
+    vm.take_snapshot(specs, "s1", "");
+    EXPECT_EQ(vm.get_num_snapshots(), 1);
+}
+
 TEST_F(BaseVM, takeSnasphotThrowsIfSpecificSnapshotNotOverridden)
 {
     StubBaseVirtualMachine stub{};
@@ -1289,17 +1341,39 @@ TEST_F(BaseVM, waitForCloudInitNoErrorsAndDoneDoesNotThrow)
 {
     vm.simulate_cloud_init();
     EXPECT_CALL(vm, ensure_vm_is_running()).WillRepeatedly(Return());
-    EXPECT_CALL(vm, ssh_exec).WillOnce(DoDefault());
+
+    auto [mock_utils_ptr, guard] = mpt::MockUtils::inject();
+    EXPECT_CALL(*mock_utils_ptr,
+                run_in_ssh_session(_,
+                                   AllOf(HasSubstr("boot-finished"), Not(HasSubstr("timeout"))),
+                                   _))
+        .WillOnce(Return(""));
 
     std::chrono::milliseconds timeout(1);
     EXPECT_NO_THROW(vm.wait_for_cloud_init(timeout));
 }
 
+TEST_F(BaseVM, waitForCloudInitDoesNotUseCachedSession)
+{
+    vm.simulate_cloud_init();
+    EXPECT_CALL(vm, ensure_vm_is_running()).WillRepeatedly(Return());
+    EXPECT_CALL(vm, ssh_exec).Times(0);
+
+    auto [mock_utils_ptr, guard] = mpt::MockUtils::inject();
+    EXPECT_CALL(*mock_utils_ptr, run_in_ssh_session).WillOnce(Return(""));
+
+    EXPECT_NO_THROW(vm.wait_for_cloud_init(std::chrono::milliseconds{1}));
+}
+
 TEST_F(BaseVM, waitForCloudInitErrorTimesOutThrows)
 {
     vm.simulate_cloud_init();
     EXPECT_CALL(vm, ensure_vm_is_running()).WillRepeatedly(Return());
-    EXPECT_CALL(vm, ssh_exec).WillOnce(Throw(mp::SSHExecFailure{"no worky", 1}));
+
+    auto [mock_utils_ptr, guard] = mpt::MockUtils::inject();
+    EXPECT_CALL(*mock_utils_ptr, run_in_ssh_session)
+        .WillRepeatedly(Throw(mp::SSHExecFailure{"no worky", 1}));
+    EXPECT_CALL(*mock_utils_ptr, sleep_for(_)).WillRepeatedly(Return());
 
     std::chrono::milliseconds timeout(1);
     MP_EXPECT_THROW_THAT(
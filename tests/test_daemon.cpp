@@ -2161,6 +2161,35 @@ INSTANTIATE_TEST_SUITE_P(Daemon,
                                                 std::vector<std::string>{"list", "--no-ipv4"},
                                                 std::vector<std::string>{"Stopped", "--"})));
 
+TEST_F(Daemon, listFailsWhenAddressesCannotBeQueried)
+{
+    auto mock_factory = use_a_mock_vm_factory();
+    config_builder.vault = std::make_unique<NiceMock<mpt::MockVMImageVault>>();
+
+    mp::Daemon daemon{config_builder.build()};
+
+    auto instance_ptr = std::make_unique<NiceMock<mpt::MockVirtualMachine>>("mock");
+    EXPECT_CALL(*mock_factory, create_virtual_machine).WillRepeatedly([&instance_ptr](auto&&...) {
+        return std::move(instance_ptr);
+    });
+
+    EXPECT_CALL(*instance_ptr, current_state())
+        .WillRepeatedly(Return(mp::VirtualMachine::State::running));
+    EXPECT_CALL(*instance_ptr, ensure_vm_is_running())
+        .WillRepeatedly(Throw(std::runtime_error("Not running")));
+    EXPECT_CALL(*instance_ptr, get_all_ipv4())
+        .WillOnce(Throw(std::runtime_error("cannot reach instance")));
+
+    MP_DELEGATE_MOCK_CALLS_ON_BASE(mock_utils, is_running, mp::Utils);
+
+    send_command({"launch"});
+
+    std::stringstream err_stream;
+    send_command({"list"}, trash_stream, err_stream);
+
+    EXPECT_THAT(err_stream.str(), HasSubstr("cannot reach instance"));
+}
+
 TEST_F(Daemon, preventsRepetitionOfLoadedMacAddresses)
 {
     config_builder.vault = std::make_unique<NiceMock<mpt::MockVMImageVault>>();
@@ -2959,6 +2988,41 @@ TEST_F(Daemon, infoAllReturnsAllInstances)
     call_daemon_slot(daemon, &mp::Daemon::info, mp::InfoRequest{}, mock_server);
 }
 
+TEST_F(Daemon, infoKeepsPartialRecordWhenRuntimeInfoFails)
+{
+    auto mock_factory = use_a_mock_vm_factory();
+    config_builder.vault = std::make_unique<NiceMock<mpt::MockVMImageVault>>();
+
+    mp::Daemon daemon{config_builder.build()};
+
+    auto instance_ptr = std::make_unique<NiceMock<mpt::MockVirtualMachine>>("mock");
+    EXPECT_CALL(*mock_factory, create_virtual_machine).WillRepeatedly([&instance_ptr](auto&&...) {
+        return std::move(instance_ptr);
+    });
+
+    EXPECT_CALL(*instance_ptr, current_state())
+        .WillRepeatedly(Return(mp::VirtualMachine::State::running));
+    EXPECT_CALL(*instance_ptr, ensure_vm_is_running())
+        .WillRepeatedly(Throw(std::runtime_error("Not running")));
+    auto instance = instance_ptr.get();
+
+    MP_DELEGATE_MOCK_CALLS_ON_BASE(mock_utils, is_running, mp::Utils);
+
+    send_command({"launch"});
+
+    EXPECT_CALL(*instance, ssh_exec(_, _))
+        .WillRepeatedly(Throw(std::runtime_error("cannot reach instance")));
+
+    StrictMock<mpt::MockServerReaderWriter<mp::InfoReply, mp::InfoRequest>> mock_server{};
+    EXPECT_CALL(mock_server,
+                Write(Property(&mp::InfoReply::details,
+                               ElementsAre(Property(&mp::DetailedInfoItem::name, "mock"))),
+                      _))
+        .WillOnce(Return(true));
+
+    EXPECT_TRUE(call_daemon_slot(daemon, &mp::Daemon::info, mp::InfoRequest{}, mock_server).ok());
+}
+
 TEST_F(Daemon, setsPermissionsOnProvidedStoragePath)
 {
     const QString path{"Where all the secrets go"};
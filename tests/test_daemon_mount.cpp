@@ -33,6 +33,8 @@
 #include <multipass/constants.h>
 #include <multipass/exceptions/not_implemented_on_this_backend_exception.h>
 #include <multipass/exceptions/sshfs_missing_error.h>
+#include <multipass/settings/bool_setting_spec.h>
+#include <multipass/settings/persistent_settings_handler.h>
 
 namespace mp = multipass;
 namespace mpt = multipass::test;
@@ -96,6 +98,31 @@ TEST_F(TestDaemonMount, refusesDisabledMount)
                 HasSubstr("Mounts are disabled on this installation of Multipass."));
 }
 
+TEST_F(TestDaemonMount, followsMountsSettingFromItsHandler)
+{
+    mpt::TempDir settings_dir;
+    mp::SettingSpec::Set settings;
+    settings.insert(std::make_unique<mp::BoolSettingSpec>(mp::mounts_key, "true"));
+    mp::PersistentSettingsHandler handler{settings_dir.filePath("settings.conf"),
+                                          std::move(settings)};
+
+    mp::Daemon daemon{config_builder.build()};
+    daemon.follow_settings(handler);
+    handler.set(mp::mounts_key, "false");
+
+    EXPECT_CALL(mock_settings, get(Eq(mp::mounts_key))).Times(0);
+
+    auto status = call_daemon_slot(
+        daemon,
+        &mp::Daemon::mount,
+        mp::MountRequest{},
+        StrictMock<mpt::MockServerReaderWriter<mp::MountReply, mp::MountRequest>>{});
+
+    EXPECT_EQ(status.error_code(), grpc::StatusCode::FAILED_PRECONDITION);
+    EXPECT_THAT(status.error_message(),
+                HasSubstr("Mounts are disabled on this installation of Multipass."));
+}
+
 TEST_F(TestDaemonMount, missingInstanceFails)
 {
     const std::string& fake_instance{"fake"};
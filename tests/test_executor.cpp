@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "common.h"
+
+#include <multipass/executor.h>
+#include <multipass/utils.h>
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace mp = multipass;
+namespace mpt = multipass::test;
+namespace mpu = multipass::utils;
+
+using namespace std::chrono_literals;
+using namespace testing;
+
+using Priority = mp::Executor::Priority;
+
+TEST(Executor, runsTasksInThePool)
+{
+    auto future = MP_EXECUTOR.run(Priority::interactive, [](int a, int b) { return a + b; }, 40, 2);
+
+    EXPECT_EQ(future.result(), 42);
+}
+
+TEST(Executor, runsTasksWithTheirPriority)
+{
+    auto future =
+        MP_EXECUTOR.run(Priority::background, [] { return mp::Executor::current_priority(); });
+
+    EXPECT_EQ(future.result(), Priority::background);
+    EXPECT_EQ(mp::Executor::current_priority(), Priority::interactive);
+}
+
+TEST(Executor, nestedTasksInheritPriority)
+{
+    auto future = MP_EXECUTOR.run(Priority::background, [] {
+        std::vector<Priority> priorities(4, Priority::interactive);
+        MP_EXECUTOR.run_and_wait(priorities.size(), [&priorities](std::size_t i) {
+            priorities[i] = mp::Executor::current_priority();
+        });
+        return priorities;
+    });
+
+    EXPECT_THAT(future.result(), Each(Priority::background));
+}
+
+TEST(Executor, runAndWaitCallsEveryTask)
+{
+    std::vector<std::atomic<int>> calls(100);
+    MP_EXECUTOR.run_and_wait(calls.size(), [&calls](std::size_t i) { ++calls[i]; });
+
+    for (const auto& call_count : calls)
+        EXPECT_EQ(call_count.load(), 1);
+}
+
+TEST(Executor, runAndWaitRethrowsTheFirstException)
+{
+    std::atomic<int> calls{0};
+    auto task = [&calls](std::size_t i) {
+        ++calls;
+        if (i % 2)
+            throw std::runtime_error{"task " + std::to_string(i)};
+    };
+
+    MP_EXPECT_THROW_THAT(MP_EXECUTOR.run_and_wait(10, task),
+                         std::runtime_error,
+                         mpt::match_what(StrEq("task 1")));
+    EXPECT_EQ(calls.load(), 10);
+}
+
+TEST(Executor, nestedRunAndWaitCompletesOnABusyPool)
+{
+    const auto outer_count = static_cast<std::size_t>(2 * MP_EXECUTOR.max_thread_count());
+    std::atomic<std::size_t> calls{0};
+
+    MP_EXECUTOR.run_and_wait(outer_count, [&calls](std::size_t) {
+        MP_EXECUTOR.run_and_wait(4, [&calls](std::size_t) {
+            std::this_thread::sleep_for(1ms);
+            ++calls;
+        });
+    });
+
+    EXPECT_EQ(calls.load(), 4 * outer_count);
+}
+
+TEST(Executor, countsTasks)
+{
+    const auto before = MP_EXECUTOR.counters(Priority::background);
+
+    auto future = MP_EXECUTOR.run(Priority::background, [] { std::this_thread::sleep_for(2ms); });
+    future.waitForFinished();
+
+    const auto after = MP_EXECUTOR.counters(Priority::background);
+    EXPECT_EQ(after.tasks, before.tasks + 1);
+    EXPECT_GE(after.running - before.running, 2ms);
+}
+
+TEST(Executor, parallelTransformKeepsOrderAndDropsDefaults)
+{
+    const std::vector<int> input{1, 0, 3, 0, 5};
+
+    EXPECT_THAT(mpu::parallel_transform(input, [](int i) { return i * 2; }), ElementsAre(2, 6, 10));
+}
+
+TEST(Executor, parallelForEachVisitsEveryItem)
+{
+    std::vector<int> items{1, 2, 3};
+    mpu::parallel_for_each(items, [](int& i) { i *= 10; });
+
+    EXPECT_THAT(items, ElementsAre(10, 20, 30));
+}
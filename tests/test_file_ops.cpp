@@ -185,6 +185,27 @@ TEST_F(FileOps, posixLseek)
     EXPECT_STREQ(buffer.data(), file_content.c_str() + seek);
 }
 
+TEST_F(FileOps, posixPread)
+{
+    const auto named_fd = MP_FILEOPS.open_fd(temp_file, O_RDWR, 0);
+    const auto offset = 3;
+    std::array<char, 100> buffer{};
+    const auto r = MP_FILEOPS.pread(named_fd->fd, buffer.data(), buffer.size(), offset);
+    EXPECT_EQ(r, file_content.size() - offset);
+    EXPECT_STREQ(buffer.data(), file_content.c_str() + offset);
+}
+
+TEST_F(FileOps, posixPwrite)
+{
+    const auto named_fd = MP_FILEOPS.open_fd(temp_file, O_RDWR, 0);
+    const char data[] = "abc";
+    const auto r = MP_FILEOPS.pwrite(named_fd->fd, data, sizeof(data) - 1, 2);
+    EXPECT_EQ(r, sizeof(data) - 1);
+    std::ifstream stream{temp_file};
+    std::string string{std::istreambuf_iterator{stream}, {}};
+    EXPECT_EQ(string, file_content.substr(0, 2) + data + file_content.substr(5));
+}
+
 TEST_F(FileOps, removeExtension)
 {
     EXPECT_EQ(MP_FILEOPS.remove_extension(""), "");
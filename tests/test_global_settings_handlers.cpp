@@ -238,8 +238,12 @@ TEST_F(TestGlobalSettingsHandlers, daemonRegistersPersistentHandlerForDaemonSett
     mp::daemon::register_global_settings_handlers();
     inject_default_returning_mock_qsettings();
 
-    expect_setting_values(
-        {{mp::driver_key, driver}, {mp::bridged_interface_key, ""}, {mp::mounts_key, mount}});
+    expect_setting_values({{mp::driver_key, driver},
+                           {mp::bridged_interface_key, ""},
+                           {mp::mounts_key, mount},
+                           {mp::suspend_format_key, mp::suspend_format_snapshot},
+                           {mp::native_mount_type_key, mp::native_mount_type_9p},
+                           {mp::virtiofs_cache_key, mp::virtiofs_cache_default}});
 }
 
 TEST_F(TestGlobalSettingsHandlers, daemonRegistersPersistentHandlerForDaemonPlatformSettings)
@@ -348,6 +352,62 @@ TEST_F(TestGlobalSettingsHandlers, daemonRegistersHandlerThatAcceptsBrigedInterf
     ASSERT_NO_THROW(handler->set(mp::bridged_interface_key, val));
 }
 
+TEST_F(TestGlobalSettingsHandlers, daemonRegistersHandlerThatAcceptsSuspendFormat)
+{
+    mp::daemon::register_global_settings_handlers();
+
+    EXPECT_CALL(*mock_qsettings, setValue(Eq(mp::suspend_format_key), Eq("file")));
+    inject_mock_qsettings();
+
+    ASSERT_NO_THROW(handler->set(mp::suspend_format_key, "File"));
+}
+
+TEST_F(TestGlobalSettingsHandlers, daemonRegistersHandlerThatRejectsUnknownSuspendFormat)
+{
+    const auto val = "hibernate";
+
+    mp::daemon::register_global_settings_handlers();
+
+    MP_ASSERT_THROW_THAT(handler->set(mp::suspend_format_key, val),
+                         mp::InvalidSettingException,
+                         mpt::match_what(AllOf(HasSubstr(mp::suspend_format_key), HasSubstr(val))));
+}
+
+TEST_F(TestGlobalSettingsHandlers, daemonRegistersHandlerThatAcceptsVirtiofsMounts)
+{
+    mp::daemon::register_global_settings_handlers();
+
+    EXPECT_CALL(*mock_qsettings, setValue(Eq(mp::native_mount_type_key), Eq("virtiofs")));
+    EXPECT_CALL(*mock_qsettings, setValue(Eq(mp::virtiofs_cache_key), Eq("always")));
+    inject_mock_qsettings();
+
+    ASSERT_NO_THROW(handler->set(mp::native_mount_type_key, "VirtioFS"));
+    ASSERT_NO_THROW(handler->set(mp::virtiofs_cache_key, "Always"));
+}
+
+TEST_F(TestGlobalSettingsHandlers, daemonRegistersHandlerThatRejectsUnknownNativeMountType)
+{
+    const auto val = "nfs";
+
+    mp::daemon::register_global_settings_handlers();
+
+    MP_ASSERT_THROW_THAT(
+        handler->set(mp::native_mount_type_key, val),
+        mp::InvalidSettingException,
+        mpt::match_what(AllOf(HasSubstr(mp::native_mount_type_key), HasSubstr(val))));
+}
+
+TEST_F(TestGlobalSettingsHandlers, daemonRegistersHandlerThatRejectsUnknownVirtiofsCacheMode)
+{
+    const auto val = "sometimes";
+
+    mp::daemon::register_global_settings_handlers();
+
+    MP_ASSERT_THROW_THAT(handler->set(mp::virtiofs_cache_key, val),
+                         mp::InvalidSettingException,
+                         mpt::match_what(AllOf(HasSubstr(mp::virtiofs_cache_key), HasSubstr(val))));
+}
+
 TEST_F(TestGlobalSettingsHandlers, daemonRegistersHandlerThatHashesNonEmptyPassword)
 {
     const auto val = "correct horse battery staple";
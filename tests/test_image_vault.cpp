@@ -39,7 +39,9 @@
 #include <multipass/url_downloader.h>
 #include <multipass/utils.h>
 
+#include <QCryptographicHash>
 #include <QDateTime>
+#include <QFile>
 #include <QThread>
 #include <QUrl>
 
@@ -58,13 +60,13 @@ struct BadURLDownloader : public mp::URLDownloader
     BadURLDownloader() : mp::URLDownloader{std::chrono::seconds(10)}
     {
     }
-    void download_to(const QUrl& url,
-                     const QString& file_name,
-                     int64_t size,
-                     const int download_type,
-                     const mp::ProgressMonitor&) override
+    void stream_to(const QUrl& url,
+                   const DataHandler& on_data,
+                   int64_t size,
+                   const int download_type,
+                   const mp::ProgressMonitor&) override
     {
-        mpt::make_file_with_content(file_name, "Bad hash");
+        on_data("Bad hash");
     }
 
     QByteArray download(const QUrl& url) override
@@ -78,15 +80,14 @@ struct HttpURLDownloader : public mp::URLDownloader
     HttpURLDownloader() : mp::URLDownloader{std::chrono::seconds(10)}
     {
     }
-    void download_to(const QUrl& url,
-                     const QString& file_name,
-                     int64_t size,
-                     const int download_type,
-                     const mp::ProgressMonitor&) override
+    void stream_to(const QUrl& url,
+                   const DataHandler& on_data,
+                   int64_t size,
+                   const int download_type,
+                   const mp::ProgressMonitor&) override
     {
-        mpt::make_file_with_content(file_name, "");
+        on_data("");
         downloaded_urls << url.toString();
-        downloaded_files << file_name;
     }
 
     QByteArray download(const QUrl& url) override
@@ -99,20 +100,51 @@ struct HttpURLDownloader : public mp::URLDownloader
         return default_last_modified;
     }
 
-    QStringList downloaded_files;
     QStringList downloaded_urls;
 };
 
+struct ChunkedURLDownloader : public mp::URLDownloader
+{
+    explicit ChunkedURLDownloader(const QByteArray& content)
+        : mp::URLDownloader{std::chrono::seconds(10)}, content{content}
+    {
+    }
+    void stream_to(const QUrl& url,
+                   const DataHandler& on_data,
+                   int64_t size,
+                   const int download_type,
+                   const mp::ProgressMonitor&) override
+    {
+        for (qsizetype pos = 0; pos < content.size(); pos += chunk_size)
+            if (!on_data(content.mid(pos, chunk_size)))
+                throw mp::AbortedDownloadException("Aborted!");
+    }
+
+    QByteArray download(const QUrl& url) override
+    {
+        return {};
+    }
+
+    static constexpr qsizetype chunk_size = 7;
+    const QByteArray content;
+};
+
+// "multipass " repeated 1000 times, xz-compressed
+const auto xz_image = QByteArray::fromHex(
+    "fd377a585a000004e6d6b4460200210116000000742fe5a3e0270f00365d00369d49bd02faf9fa3d046a1d73"
+    "87de93784234145f7a01411ed3067c984527fdeea557fb8c7f106d341485b22b9bef5f34c59af99000000000"
+    "a135f477f51c2a95000152904e0000003f75de28b1c467fb020000000004595a");
+
 struct RunningURLDownloader : public mp::URLDownloader
 {
     RunningURLDownloader() : mp::URLDownloader{std::chrono::seconds(10)}
     {
     }
-    void download_to(const QUrl& url,
-                     const QString& file_name,
-                     int64_t size,
-                     const int download_type,
-                     const mp::ProgressMonitor&) override
+    void stream_to(const QUrl& url,
+                   const DataHandler& on_data,
+                   int64_t size,
+                   const int download_type,
+                   const mp::ProgressMonitor&) override
     {
         while (!abort_downloads)
             QThread::yieldCurrentThread();
@@ -207,7 +239,7 @@ TEST_F(ImageVault, downloadsImage)
                                       std::nullopt,
                                       instance_dir);
 
-    EXPECT_THAT(url_downloader.downloaded_files.size(), Eq(1));
+    EXPECT_THAT(url_downloader.downloaded_urls.size(), Eq(1));
     EXPECT_TRUE(url_downloader.downloaded_urls.contains(host.image.url()));
 }
 
@@ -334,7 +366,7 @@ TEST_F(ImageVault, recordsInstancedImages)
                                        std::nullopt,
                                        instance_dir);
 
-    EXPECT_THAT(url_downloader.downloaded_files.size(), Eq(1));
+    EXPECT_THAT(url_downloader.downloaded_urls.size(), Eq(1));
     EXPECT_THAT(prepare_called_count, Eq(1));
     EXPECT_THAT(vm_image1.image_path, Eq(vm_image2.image_path));
     EXPECT_THAT(vm_image1.id, Eq(vm_image2.id));
@@ -369,7 +401,7 @@ TEST_F(ImageVault, cachesPreparedImages)
                           std::nullopt,
                           save_dir.filePath(QString::fromStdString(another_query.name)));
 
-    EXPECT_THAT(url_downloader.downloaded_files.size(), Eq(1));
+    EXPECT_THAT(url_downloader.downloaded_urls.size(), Eq(1));
     EXPECT_THAT(prepare_called_count, Eq(1));
 
     EXPECT_THAT(vm_image1.image_path, Ne(vm_image2.image_path));
@@ -413,7 +445,7 @@ TEST_F(ImageVault, remembersInstanceImages)
                                                std::nullopt,
                                                instance_dir);
 
-    EXPECT_THAT(url_downloader.downloaded_files.size(), Eq(1));
+    EXPECT_THAT(url_downloader.downloaded_urls.size(), Eq(1));
     EXPECT_THAT(prepare_called_count, Eq(1));
     EXPECT_THAT(vm_image1.image_path, Eq(vm_image2.image_path));
 }
@@ -458,7 +490,7 @@ TEST_F(ImageVault, remembersPreparedImages)
                                   std::nullopt,
                                   save_dir.filePath(QString::fromStdString(another_query.name)));
 
-    EXPECT_THAT(url_downloader.downloaded_files.size(), Eq(1));
+    EXPECT_THAT(url_downloader.downloaded_urls.size(), Eq(1));
     EXPECT_THAT(prepare_called_count, Eq(1));
     EXPECT_THAT(vm_image1.image_path, Ne(vm_image2.image_path));
     EXPECT_THAT(vm_image1.id, Eq(vm_image2.id));
@@ -522,6 +554,78 @@ TEST_F(ImageVault, imagePurgedExpired)
     EXPECT_FALSE(QFileInfo::exists(file_name));
 }
 
+TEST_F(ImageVault, thinInstanceImagesAreOverlaysOnPreparedImages)
+{
+    auto mock_factory_scope = mpt::MockProcessFactory::Inject();
+    mp::DefaultVMImageVault vault{hosts,
+                                  &url_downloader,
+                                  cache_dir.path(),
+                                  data_dir.path(),
+                                  mp::days{0},
+                                  true};
+
+    QDir images_dir{MP_UTILS.make_dir(cache_dir.path(), "images")};
+    auto file_name = images_dir.filePath("mock_image.img");
+
+    auto prepare = [&file_name](const mp::VMImage& source_image) -> mp::VMImage {
+        mpt::make_file_with_content(file_name);
+        return {file_name, source_image.id, "", "", "", {}};
+    };
+    auto vm_image = vault.fetch_image(mp::FetchType::ImageOnly,
+                                      default_query,
+                                      prepare,
+                                      stub_monitor,
+                                      std::nullopt,
+                                      instance_dir);
+
+    EXPECT_EQ(vm_image.image_path, QDir{instance_dir}.filePath("mock_image.img"));
+
+    const auto processes = mock_factory_scope->process_list();
+    ASSERT_EQ(processes.size(), 1u);
+    EXPECT_EQ(processes.front().command, "qemu-img");
+    EXPECT_THAT(processes.front().arguments,
+                ElementsAre("create",
+                            "-f",
+                            "qcow2",
+                            "-F",
+                            "qcow2",
+                            "-b",
+                            QFileInfo{file_name}.absoluteFilePath(),
+                            vm_image.image_path));
+}
+
+TEST_F(ImageVault, expiredImageIsKeptWhileInstancesAreBasedOnIt)
+{
+    auto mock_factory_scope = mpt::MockProcessFactory::Inject();
+    mp::DefaultVMImageVault vault{hosts,
+                                  &url_downloader,
+                                  cache_dir.path(),
+                                  data_dir.path(),
+                                  mp::days{0},
+                                  true};
+
+    QDir images_dir{MP_UTILS.make_dir(cache_dir.path(), "images")};
+    auto file_name = images_dir.filePath("mock_image.img");
+
+    auto prepare = [&file_name](const mp::VMImage& source_image) -> mp::VMImage {
+        mpt::make_file_with_content(file_name);
+        return {file_name, source_image.id, "", "", "", {}};
+    };
+    vault.fetch_image(mp::FetchType::ImageOnly,
+                      default_query,
+                      prepare,
+                      stub_monitor,
+                      std::nullopt,
+                      instance_dir);
+
+    vault.prune_expired_images();
+    EXPECT_TRUE(QFileInfo::exists(file_name));
+
+    vault.remove(instance_name);
+    vault.prune_expired_images();
+    EXPECT_FALSE(QFileInfo::exists(file_name));
+}
+
 TEST_F(ImageVault, imageExistsNotExpired)
 {
     mp::DefaultVMImageVault vault{hosts,
@@ -636,15 +740,40 @@ TEST_F(ImageVault, DISABLE_ON_WINDOWS_AND_MACOS(customImageUrlDownloads))
                       std::nullopt,
                       instance_dir);
 
-    EXPECT_THAT(url_downloader.downloaded_files.size(), Eq(1));
+    EXPECT_THAT(url_downloader.downloaded_urls.size(), Eq(1));
     EXPECT_TRUE(url_downloader.downloaded_urls.contains(QString::fromStdString(query.release)));
 }
 
-TEST_F(ImageVault, missingDownloadedImageThrows)
+TEST_F(ImageVault, decodesXzImageAsItIsDownloaded)
 {
-    mpt::StubURLDownloader stub_url_downloader;
+    host.mock_bionic_image_info.image_location = "http://www.foo.com/images/bionic.img.xz";
+    host.mock_bionic_image_info.id =
+        QCryptographicHash::hash(xz_image, QCryptographicHash::Sha256).toHex();
+
+    ChunkedURLDownloader chunked_url_downloader{xz_image};
     mp::DefaultVMImageVault vault{hosts,
-                                  &stub_url_downloader,
+                                  &chunked_url_downloader,
+                                  cache_dir.path(),
+                                  data_dir.path(),
+                                  mp::days{0}};
+    auto vm_image = vault.fetch_image(mp::FetchType::ImageOnly,
+                                      default_query,
+                                      stub_prepare,
+                                      stub_monitor,
+                                      std::nullopt,
+                                      instance_dir);
+
+    EXPECT_EQ(mpt::load(vm_image.image_path), QByteArray{"multipass "}.repeated(1000));
+}
+
+TEST_F(ImageVault, truncatedXzImageThrows)
+{
+    host.mock_bionic_image_info.image_location = "http://www.foo.com/images/bionic.img.xz";
+    host.mock_bionic_image_info.verify = false;
+
+    ChunkedURLDownloader chunked_url_downloader{xz_image.left(xz_image.size() - 10)};
+    mp::DefaultVMImageVault vault{hosts,
+                                  &chunked_url_downloader,
                                   cache_dir.path(),
                                   data_dir.path(),
                                   mp::days{0}};
@@ -779,10 +908,10 @@ TEST_F(ImageVault, imageUpdateCreatesNewDirAndRemovesOld)
                       std::nullopt,
                       instance_dir);
 
-    auto original_file{url_downloader.downloaded_files[0]};
-    auto original_absolute_path{QFileInfo(original_file).absolutePath()};
-    EXPECT_TRUE(QFileInfo::exists(original_file));
-    EXPECT_TRUE(original_absolute_path.contains(mpt::default_version));
+    const QDir images_dir{cache_dir.filePath("vault/images")};
+    const auto original_dirs = images_dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+    ASSERT_EQ(original_dirs.size(), 1);
+    EXPECT_TRUE(original_dirs.front().contains(mpt::default_version));
 
     // Mock an update to the image and don't verify because of hash mismatch
     const QString new_date_string{"20180825"};
@@ -793,13 +922,85 @@ TEST_F(ImageVault, imageUpdateCreatesNewDirAndRemovesOld)
 
     vault.update_images(mp::FetchType::ImageOnly, stub_prepare, stub_monitor);
 
-    auto updated_file{url_downloader.downloaded_files[1]};
-    EXPECT_TRUE(QFileInfo::exists(updated_file));
-    EXPECT_TRUE(QFileInfo(updated_file).absolutePath().contains(new_date_string));
+    EXPECT_THAT(url_downloader.downloaded_urls.size(), Eq(2));
+
+    // Old image directory should be replaced by the new one
+    const auto updated_dirs = images_dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+    ASSERT_EQ(updated_dirs.size(), 1);
+    EXPECT_TRUE(updated_dirs.front().contains(new_date_string));
+}
+
+TEST_F(ImageVault, imageUpdateKeepsImageInstancesAreBasedOnAndDoesNotRepeat)
+{
+    auto mock_factory_scope = mpt::MockProcessFactory::Inject();
+    mp::DefaultVMImageVault vault{hosts,
+                                  &url_downloader,
+                                  cache_dir.path(),
+                                  data_dir.path(),
+                                  mp::days{1},
+                                  true};
+    vault.fetch_image(mp::FetchType::ImageOnly,
+                      default_query,
+                      stub_prepare,
+                      stub_monitor,
+                      std::nullopt,
+                      instance_dir);
+
+    // Mock an update to the image and don't verify because of hash mismatch
+    host.mock_bionic_image_info.id =
+        "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b856";
+    host.mock_bionic_image_info.version = "20180825";
+    host.mock_bionic_image_info.verify = false;
+
+    vault.update_images(mp::FetchType::ImageOnly, stub_prepare, stub_monitor);
+    vault.update_images(mp::FetchType::ImageOnly, stub_prepare, stub_monitor);
+
+    EXPECT_THAT(url_downloader.downloaded_urls.size(), Eq(2));
+
+    const QDir images_dir{cache_dir.filePath("vault/images")};
+    EXPECT_EQ(images_dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot).size(), 2);
+}
+
+TEST_F(ImageVault, imageUpdateDoesNotWriteOverImageInstancesAreBasedOn)
+{
+    auto mock_factory_scope = mpt::MockProcessFactory::Inject();
+    mp::DefaultVMImageVault vault{hosts,
+                                  &url_downloader,
+                                  cache_dir.path(),
+                                  data_dir.path(),
+                                  mp::days{1},
+                                  true};
+    vault.fetch_image(mp::FetchType::ImageOnly,
+                      default_query,
+                      stub_prepare,
+                      stub_monitor,
+                      std::nullopt,
+                      instance_dir);
+
+    const QDir images_dir{cache_dir.filePath("vault/images")};
+    const auto original_dirs = images_dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+    ASSERT_EQ(original_dirs.size(), 1);
+    const QDir original_dir{images_dir.filePath(original_dirs.front())};
+    const auto original_images = original_dir.entryList(QDir::Files);
+    ASSERT_EQ(original_images.size(), 1);
+    const auto original_image = original_dir.filePath(original_images.front());
+    {
+        QFile image{original_image};
+        ASSERT_TRUE(image.open(QIODevice::WriteOnly));
+        image.write("instances are based on this");
+    }
 
-    // Old image and directory should be removed
-    EXPECT_FALSE(QFileInfo::exists(original_file));
-    EXPECT_FALSE(QFileInfo::exists(original_absolute_path));
+    // Mock a rebuild of the image with the same version, so that it maps to the same directory
+    host.mock_bionic_image_info.id =
+        "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b856";
+    host.mock_bionic_image_info.verify = false;
+
+    vault.update_images(mp::FetchType::ImageOnly, stub_prepare, stub_monitor);
+
+    EXPECT_THAT(url_downloader.downloaded_urls.size(), Eq(2));
+    EXPECT_THAT(images_dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot),
+                UnorderedElementsAre(original_dirs.front(), original_dirs.front() + ".1"));
+    EXPECT_EQ(mpt::load(original_image), "instances are based on this");
 }
 
 TEST_F(ImageVault, abortedDownloadThrows)
@@ -846,6 +1047,33 @@ TEST_F(ImageVault, minimumImageSizeReturnsExpectedSize)
     EXPECT_EQ(image_size, size);
 }
 
+TEST_F(ImageVault, minimumImageSizeLogsAllocatedSize)
+{
+    const mp::MemorySize image_size{"1048576"};
+    const mp::ProcessState qemuimg_exit_status{0, std::nullopt};
+    const QByteArray qemuimg_output(fake_img_info(image_size) + "disk size: 196 KiB\n");
+    auto mock_factory_scope = inject_fake_qemuimg_callback(qemuimg_exit_status, qemuimg_output);
+
+    mp::DefaultVMImageVault vault{hosts,
+                                  &url_downloader,
+                                  cache_dir.path(),
+                                  data_dir.path(),
+                                  mp::days{0}};
+    auto vm_image = vault.fetch_image(mp::FetchType::ImageOnly,
+                                      default_query,
+                                      stub_prepare,
+                                      stub_monitor,
+                                      std::nullopt,
+                                      instance_dir);
+
+    mpt::MockLogger::Scope logger_scope = mpt::MockLogger::inject(mpl::Level::debug);
+    logger_scope.mock_logger->screen_logs(mpl::Level::warning);
+    logger_scope.mock_logger->expect_log(mpl::Level::debug,
+                                         "virtual size of 1048576 bytes, 196 KiB allocated");
+
+    vault.minimum_image_size_for(vm_image.id);
+}
+
 TEST_F(ImageVault, DISABLE_ON_WINDOWS_AND_MACOS(fileBasedMinimumSizeReturnsExpectedSize))
 {
     const mp::MemorySize image_size{"2097152"};
@@ -16,10 +16,13 @@
  */
 
 #include "common.h"
+#include "disabling_macros.h"
+#include "file_operations.h"
 #include "mock_file_ops.h"
 #include "mock_image_decoder.h"
 #include "mock_image_host.h"
 #include "mock_image_vault_utils.h"
+#include "temp_dir.h"
 
 #include <QBuffer>
 #include <multipass/progress_monitor.h>
@@ -65,7 +68,7 @@ TEST_F(TestImageVaultUtils, copyToDirThrowsOnNonexistantFile)
 TEST_F(TestImageVaultUtils, copyToDirThrowsOnFailToCopy)
 {
     EXPECT_CALL(mock_file_ops, exists(test_info)).WillOnce(Return(true));
-    EXPECT_CALL(mock_file_ops, copy(test_path, test_output)).WillOnce(Return(false));
+    EXPECT_CALL(mock_file_ops, open(_, _)).WillOnce(Return(false));
 
     MP_EXPECT_THROW_THAT(MP_IMAGE_VAULT_UTILS.copy_to_dir(test_path, test_dir),
                          std::runtime_error,
@@ -77,12 +80,53 @@ TEST_F(TestImageVaultUtils, copyToDirThrowsOnFailToCopy)
 TEST_F(TestImageVaultUtils, copyToDirCopysToDir)
 {
     EXPECT_CALL(mock_file_ops, exists(test_info)).WillOnce(Return(true));
-    EXPECT_CALL(mock_file_ops, copy(test_path, test_output)).WillOnce(Return(true));
+    EXPECT_CALL(mock_file_ops, open(_, _)).Times(2).WillRepeatedly(Return(true));
+    EXPECT_CALL(mock_file_ops, read(A<QFile&>(), _, _)).WillOnce(Return(0));
 
     auto result = MP_IMAGE_VAULT_UTILS.copy_to_dir(test_path, test_dir);
     EXPECT_EQ(result, test_output);
 }
 
+TEST_F(TestImageVaultUtils, copyToDirRemovesPartialCopyOnReadFailure)
+{
+    EXPECT_CALL(mock_file_ops, exists(test_info)).WillOnce(Return(true));
+    EXPECT_CALL(mock_file_ops, open(_, _)).Times(2).WillRepeatedly(Return(true));
+    EXPECT_CALL(mock_file_ops, read(A<QFile&>(), _, _)).WillOnce(Return(-1));
+    EXPECT_CALL(mock_file_ops, remove(A<QFile&>())).WillOnce(Return(true));
+
+    MP_EXPECT_THROW_THAT(MP_IMAGE_VAULT_UTILS.copy_to_dir(test_path, test_dir),
+                         std::runtime_error,
+                         mpt::match_what(HasSubstr("Failed to copy")));
+}
+
+TEST_F(TestImageVaultUtils, DISABLE_ON_WINDOWS(copyToDirPreservesContentsAndPermissions))
+{
+    mpt::TempDir temp_dir;
+    const auto source_path = temp_dir.filePath("sparse.img");
+    const QDir output_dir{temp_dir.filePath("out")};
+    ASSERT_TRUE(output_dir.mkpath("."));
+
+    QFile source{source_path};
+    ASSERT_TRUE(source.open(QIODevice::WriteOnly));
+    source.write("start");
+    source.resize(4u << 20);
+    source.seek(source.size() - 3);
+    source.write("end");
+    source.close();
+    source.setPermissions(QFile::ReadOwner | QFile::WriteOwner);
+
+    ON_CALL(mock_file_ops, exists(A<const QFileInfo&>())).WillByDefault(Return(true));
+    ON_CALL(mock_file_ops, open(_, _))
+        .WillByDefault([](QFileDevice& file, QIODevice::OpenMode mode) { return file.open(mode); });
+    ON_CALL(mock_file_ops, read(A<QFile&>(), _, _))
+        .WillByDefault([](QFile& file, char* data, qint64 size) { return file.read(data, size); });
+
+    const auto copy_path = MP_IMAGE_VAULT_UTILS.copy_to_dir(source_path, output_dir);
+
+    EXPECT_EQ(mpt::load(copy_path), mpt::load(source_path));
+    EXPECT_EQ(QFile::permissions(copy_path), QFile::permissions(source_path));
+}
+
 TEST_F(TestImageVaultUtils, computeHashThrowsWhenCantRead)
 {
     QBuffer buffer{}; // note: buffer is not opened
@@ -0,0 +1,165 @@
+/*
+ * Copyright (C) Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "common.h"
+#include "temp_dir.h"
+
+#include <src/daemon/instance_journal.h>
+
+#include <QFile>
+#include <QJsonDocument>
+
+namespace mp = multipass;
+namespace mpt = mp::test;
+using namespace testing;
+
+namespace
+{
+struct InstanceJournal : public Test
+{
+    QJsonObject record(int state)
+    {
+        return QJsonObject{{"state", state}};
+    }
+
+    mpt::TempDir temp_dir;
+    const QString file_path{temp_dir.filePath("instances.journal")};
+    const QJsonObject db_records{{"foo", QJsonObject{{"state", 0}}},
+                                 {"bar", QJsonObject{{"state", 0}}}};
+    const QByteArray db_contents{QJsonDocument{db_records}.toJson()};
+};
+} // namespace
+
+TEST_F(InstanceJournal, replaysNothingWithoutJournal)
+{
+    mp::InstanceJournal journal{file_path};
+
+    EXPECT_EQ(journal.replay(db_contents, db_records), db_records);
+}
+
+TEST_F(InstanceJournal, replaysAppendedRecords)
+{
+    {
+        mp::InstanceJournal journal{file_path};
+        journal.replay(db_contents, db_records);
+
+        ASSERT_TRUE(journal.append("foo", record(1)));
+        ASSERT_TRUE(journal.append("bar", record(2)));
+        ASSERT_TRUE(journal.append("foo", record(3)));
+    }
+
+    mp::InstanceJournal journal{file_path};
+    const auto records = journal.replay(db_contents, db_records);
+
+    EXPECT_EQ(records["foo"].toObject(), record(3));
+    EXPECT_EQ(records["bar"].toObject(), record(2));
+}
+
+TEST_F(InstanceJournal, ignoresJournalOfOtherDatabase)
+{
+    {
+        mp::InstanceJournal journal{file_path};
+        journal.replay(db_contents, db_records);
+        ASSERT_TRUE(journal.append("foo", record(1)));
+    }
+
+    mp::InstanceJournal journal{file_path};
+    const auto other_contents = QJsonDocument{QJsonObject{{"foo", record(4)}}}.toJson();
+
+    EXPECT_EQ(journal.replay(other_contents, db_records), db_records);
+    EXPECT_FALSE(QFile::exists(file_path));
+}
+
+TEST_F(InstanceJournal, ignoresIncompleteLastEntry)
+{
+    {
+        mp::InstanceJournal journal{file_path};
+        journal.replay(db_contents, db_records);
+        ASSERT_TRUE(journal.append("foo", record(1)));
+    }
+
+    QFile file{file_path};
+    ASSERT_TRUE(file.open(QIODevice::Append));
+    file.write(R"({"bar":{"sta)");
+    file.close();
+
+    mp::InstanceJournal journal{file_path};
+    const auto records = journal.replay(db_contents, db_records);
+
+    EXPECT_EQ(records["foo"].toObject(), record(1));
+    EXPECT_EQ(records["bar"].toObject(), record(0));
+}
+
+TEST_F(InstanceJournal, appendsAfterIncompleteLastEntry)
+{
+    {
+        mp::InstanceJournal journal{file_path};
+        journal.replay(db_contents, db_records);
+        ASSERT_TRUE(journal.append("foo", record(1)));
+    }
+
+    QFile file{file_path};
+    ASSERT_TRUE(file.open(QIODevice::Append));
+    file.write(R"({"bar":{"sta)");
+    file.close();
+
+    {
+        mp::InstanceJournal journal{file_path};
+        journal.replay(db_contents, db_records);
+        ASSERT_TRUE(journal.append("bar", record(2)));
+        ASSERT_TRUE(journal.append("foo", record(3)));
+    }
+
+    mp::InstanceJournal journal{file_path};
+    const auto records = journal.replay(db_contents, db_records);
+
+    EXPECT_EQ(records["foo"].toObject(), record(3));
+    EXPECT_EQ(records["bar"].toObject(), record(2));
+}
+
+TEST_F(InstanceJournal, asksForRewriteWhenFull)
+{
+    mp::InstanceJournal journal{file_path, 2};
+    journal.replay(db_contents, db_records);
+
+    EXPECT_TRUE(journal.append("foo", record(1)));
+    EXPECT_TRUE(journal.append("foo", record(2)));
+    EXPECT_FALSE(journal.append("foo", record(3)));
+}
+
+TEST_F(InstanceJournal, asksForRewriteWithoutDatabase)
+{
+    mp::InstanceJournal journal{file_path};
+
+    EXPECT_FALSE(journal.append("foo", record(1)));
+}
+
+TEST_F(InstanceJournal, resetDiscardsEntries)
+{
+    mp::InstanceJournal journal{file_path, 1};
+    journal.replay(db_contents, db_records);
+    ASSERT_TRUE(journal.append("foo", record(1)));
+
+    const auto new_contents = QJsonDocument{QJsonObject{{"foo", record(1)}}}.toJson();
+    journal.reset(new_contents);
+
+    EXPECT_FALSE(QFile::exists(file_path));
+    EXPECT_TRUE(journal.append("foo", record(2)));
+
+    mp::InstanceJournal reloaded{file_path};
+    EXPECT_EQ(reloaded.replay(new_contents, {})["foo"].toObject(), record(2));
+}
@@ -18,6 +18,7 @@
 #include "common.h"
 #include "mock_file_ops.h"
 #include "mock_qsettings.h"
+#include "temp_dir.h"
 
 #include <multipass/constants.h>
 #include <multipass/exceptions/settings_exceptions.h>
@@ -25,14 +26,18 @@
 #include <multipass/settings/custom_setting_spec.h>
 #include <multipass/settings/persistent_settings_handler.h>
 
+#include <QCoreApplication>
+#include <QFile>
 #include <QString>
 
+#include <chrono>
 #include <functional>
 #include <optional>
 
 namespace mp = multipass;
 namespace mpt = mp::test;
 using namespace testing;
+using namespace std::chrono_literals;
 
 namespace
 {
@@ -294,6 +299,118 @@ TEST_F(TestPersistentSettingsHandler, setRecordsInterpretedSetting)
     ASSERT_NO_THROW(handler.set(key, given_val));
 }
 
+TEST_F(TestPersistentSettingsHandler, getReadsEachSettingFromDiskOnlyOnce)
+{
+    const auto key = "read.once", val = "lazy";
+    const auto handler = make_handler(key);
+
+    EXPECT_CALL(*mock_qsettings, value_impl(Eq(key), _)).WillOnce(Return(val));
+
+    inject_mock_qsettings(); // a single QSettings, for the first read
+
+    EXPECT_EQ(handler.get(key), QString{val});
+    EXPECT_EQ(handler.get(key), QString{val});
+}
+
+TEST_F(TestPersistentSettingsHandler, getReturnsSetValueWithoutReadingDisk)
+{
+    const auto key = "written.key", val = "written value";
+    auto handler = make_handler(key);
+
+    EXPECT_CALL(*mock_qsettings, setValue(Eq(key), Eq(val)));
+    EXPECT_CALL(*mock_qsettings, value_impl).Times(0);
+
+    inject_mock_qsettings(); // a single QSettings, for the write
+
+    handler.set(key, val);
+    EXPECT_EQ(handler.get(key), QString{val});
+}
+
+TEST_F(TestPersistentSettingsHandler, getReadsAgainAfterFailing)
+{
+    const auto key = "retried.key", val = "eventually";
+    const auto handler = make_handler(key);
+
+    auto good_qsettings = std::make_unique<NiceMock<mpt::MockQSettings>>();
+    EXPECT_CALL(*good_qsettings, value_impl(Eq(key), _)).WillOnce(Return(val));
+    EXPECT_CALL(*mock_qsettings, status).WillOnce(Return(QSettings::AccessError));
+    EXPECT_CALL(*mock_qsettings_provider, make_wrapped_qsettings)
+        .WillOnce(Return(ByMove(std::move(mock_qsettings))))
+        .WillOnce(Return(ByMove(std::move(good_qsettings))));
+
+    EXPECT_THROW(handler.get(key), mp::PersistentSettingsException);
+    EXPECT_EQ(handler.get(key), QString{val});
+}
+
+TEST_F(TestPersistentSettingsHandler, setNotifiesSubscribers)
+{
+    const auto key = "observed.key", given_val = "given", interpreted_val = "interpreted";
+    auto handler =
+        make_handler(key, "default", [&interpreted_val](QString) { return interpreted_val; });
+
+    inject_mock_qsettings();
+
+    std::vector<std::pair<QString, QString>> notifications;
+    handler.subscribe([&notifications](const QString& k, const QString& v) {
+        notifications.emplace_back(k, v);
+    });
+
+    handler.set(key, given_val);
+
+    EXPECT_THAT(notifications, ElementsAre(Pair(QString{key}, QString{interpreted_val})));
+}
+
+TEST_F(TestPersistentSettingsHandler, setDoesNotNotifyOnFailure)
+{
+    const auto key = "unlucky.key";
+    auto handler = make_handler(key);
+
+    EXPECT_CALL(*mock_qsettings, status).WillOnce(Return(QSettings::AccessError));
+    inject_mock_qsettings();
+
+    auto notified = false;
+    handler.subscribe([&notified](const QString&, const QString&) { notified = true; });
+
+    EXPECT_THROW(handler.set(key, "value"), mp::PersistentSettingsException);
+    EXPECT_FALSE(notified);
+}
+
+TEST_F(TestPersistentSettingsHandler, notifiesSubscribersOfChangesOnDisk)
+{
+    const auto key = "external.key", old_val = "old", new_val = "new";
+    mpt::TempDir temp_dir;
+    fake_filename = temp_dir.path() + "/settings.conf";
+
+    QFile file{fake_filename};
+    ASSERT_TRUE(file.open(QIODevice::WriteOnly));
+
+    auto handler = make_handler(key);
+
+    EXPECT_CALL(*mock_qsettings, value_impl(Eq(key), _)).WillOnce(Return(old_val));
+    EXPECT_CALL(*mock_qsettings_provider, make_wrapped_qsettings(Eq(fake_filename), _))
+        .WillOnce(Return(ByMove(std::move(mock_qsettings))))
+        .WillRepeatedly(InvokeWithoutArgs([&key, &new_val] {
+            auto reloaded_qsettings = std::make_unique<NiceMock<mpt::MockQSettings>>();
+            ON_CALL(*reloaded_qsettings, value_impl(Eq(key), _)).WillByDefault(Return(new_val));
+            return std::unique_ptr<mp::WrappedQSettings>{std::move(reloaded_qsettings)};
+        })); // the file may be reported to change more than once
+
+    ASSERT_EQ(handler.get(key), QString{old_val});
+
+    std::optional<QString> notified_val;
+    handler.subscribe([&notified_val](const QString&, const QString& v) { notified_val = v; });
+
+    file.write("[General]\n");
+    file.close();
+
+    const auto deadline = std::chrono::steady_clock::now() + 5s;
+    while (!notified_val && std::chrono::steady_clock::now() < deadline)
+        QCoreApplication::processEvents(QEventLoop::AllEvents, 50);
+
+    EXPECT_EQ(notified_val, QString{new_val});
+    EXPECT_EQ(handler.get(key), QString{new_val});
+}
+
 TEST_F(TestPersistentSettingsHandler, setThrowsInterpreterExceptions)
 {
     const auto key = "clave", default_ = "valid", val = "invalid", error = "nope";
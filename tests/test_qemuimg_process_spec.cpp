@@ -28,6 +28,22 @@ namespace mp = multipass;
 namespace mpt = multipass::test;
 using namespace testing;
 
+namespace
+{
+// Writes just enough of a qcow2 header for the image to refer to a backing file
+void make_overlay_header(const QString& path, const QByteArray& backing_name)
+{
+    QByteArray header{"QFI\xfb\0\0\0\3", 8};
+    header.append(QByteArray{"\0\0\0\0\0\0\0\x14", 8}); // backing name offset: 20
+    header.append(QByteArray{"\0\0\0", 3}).append(static_cast<char>(backing_name.size()));
+    header.append(backing_name);
+
+    QFile file{path};
+    ASSERT_TRUE(file.open(QIODevice::WriteOnly));
+    file.write(header);
+}
+} // namespace
+
 TEST(TestQemuImgProcessSpec, programCorrect)
 {
     mp::QemuImgProcessSpec spec({}, "");
@@ -144,3 +160,40 @@ TEST(TestQemuImgProcessSpec, apparmorProfileNotRunningAsSnapCorrect)
     EXPECT_TRUE(spec.apparmor_profile().contains("capability dac_read_search,"));
     EXPECT_TRUE(spec.apparmor_profile().contains(" /usr/bin/qemu-img ixr,")); // space wanted
 }
+
+TEST(TestQemuImgProcessSpec, apparmorProfileAllowsReadingBackingImages)
+{
+    QTemporaryDir dir;
+    const auto backing_image = dir.filePath("backing.img");
+    const auto overlay_image = dir.filePath("overlay.img");
+    make_overlay_header(overlay_image, backing_image.toUtf8());
+
+    mp::QemuImgProcessSpec spec({}, overlay_image);
+
+    EXPECT_TRUE(spec.apparmor_profile().contains(QString("%1 rwk,").arg(overlay_image)));
+    EXPECT_TRUE(spec.apparmor_profile().contains(QString("%1 rk,").arg(backing_image)));
+    EXPECT_FALSE(spec.apparmor_profile().contains(QString("%1 rwk,").arg(backing_image)));
+}
+
+TEST(TestQemuImgProcessSpec, backingImagesFollowsChainWithRelativeNames)
+{
+    QTemporaryDir dir;
+    make_overlay_header(dir.filePath("top.img"), "middle.img");
+    make_overlay_header(dir.filePath("middle.img"), dir.filePath("base.img").toUtf8());
+
+    EXPECT_EQ(mp::QemuImgProcessSpec::backing_images_of(dir.filePath("top.img")),
+              QStringList({dir.filePath("middle.img"), dir.filePath("base.img")}));
+}
+
+TEST(TestQemuImgProcessSpec, backingImagesEmptyForImagesWithoutBacking)
+{
+    QTemporaryDir dir;
+    const auto image = dir.filePath("raw.img");
+    QFile file{image};
+    ASSERT_TRUE(file.open(QIODevice::WriteOnly));
+    file.write("not a qcow2 image");
+    file.close();
+
+    EXPECT_THAT(mp::QemuImgProcessSpec::backing_images_of(image), IsEmpty());
+    EXPECT_THAT(mp::QemuImgProcessSpec::backing_images_of(dir.filePath("missing.img")), IsEmpty());
+}
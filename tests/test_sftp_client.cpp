@@ -31,6 +31,9 @@
 
 #include <fmt/std.h>
 
+#include <cstring>
+#include <deque>
+
 namespace mp = multipass;
 namespace mpt = multipass::test;
 namespace mpl = multipass::logging;
@@ -68,7 +71,19 @@ struct SFTPClient : public testing::Test
                            std::calloc(1, sizeof(struct sftp_session_struct)));
                        return sftp;
                    }},
-          free_sftp{mock_sftp_free, [](sftp_session sftp) { std::free(sftp); }}
+          free_sftp{mock_sftp_free, [](sftp_session sftp) { std::free(sftp); }},
+          begin_write{mock_sftp_aio_begin_write,
+                      [this](auto, auto, size_t size, sftp_aio* aio) {
+                          *aio = dummy_aio;
+                          return static_cast<ssize_t>(size);
+                      }},
+          wait_write{mock_sftp_aio_wait_write, [](auto...) { return ssize_t{0}; }},
+          begin_read{mock_sftp_aio_begin_read,
+                     [this](auto, size_t len, sftp_aio* aio) {
+                         *aio = dummy_aio;
+                         return static_cast<ssize_t>(len);
+                     }},
+          free_aio{mock_sftp_aio_free, [](auto...) {}}
     {
         close.returnValue(SSH_OK);
     }
@@ -88,6 +103,14 @@ struct SFTPClient : public testing::Test
     decltype(MOCK(sftp_close)) close{MOCK(sftp_close)};
     MockScope<decltype(mock_sftp_new)> sftp_new;
     MockScope<decltype(mock_sftp_free)> free_sftp;
+    MockScope<decltype(mock_sftp_aio_begin_write)> begin_write;
+    MockScope<decltype(mock_sftp_aio_wait_write)> wait_write;
+    MockScope<decltype(mock_sftp_aio_begin_read)> begin_read;
+    MockScope<decltype(mock_sftp_aio_free)> free_aio;
+
+    // requests are never looked into, so any non-null handle will do
+    int aio_tag{0};
+    sftp_aio dummy_aio{reinterpret_cast<sftp_aio>(&aio_tag)};
 
     sftp_limits_struct limits{32768, 32768, 32768, 0};
 
@@ -151,8 +174,10 @@ TEST_F(SFTPClient, pushFileSuccess)
     REPLACE(sftp_open, [](auto sftp, auto...) { return get_dummy_sftp_file(sftp); });
 
     std::string written_data;
-    REPLACE(sftp_write, [&](auto, auto data, auto size) {
-        return written_data.append((char*)data, size).size();
+    REPLACE(sftp_aio_begin_write, [&](auto, auto data, auto size, auto aio) {
+        written_data.append((char*)data, size);
+        *aio = dummy_aio;
+        return size;
     });
 
     auto status = fs::file_status{fs::file_type::regular, fs::perms::all};
@@ -223,7 +248,7 @@ TEST_F(SFTPClient, pushFileCannotWriteTarget)
         .WillOnce(Return(std::make_unique<std::stringstream>(test_data)));
     REPLACE(sftp_open, [](auto sftp, auto...) { return get_dummy_sftp_file(sftp); });
 
-    REPLACE(sftp_write, [](auto...) { return -1; });
+    REPLACE(sftp_aio_begin_write, [](auto...) { return -1; });
     auto err = "SFTP server: Permission denied";
     REPLACE(ssh_get_error, [&](auto...) { return err; });
 
@@ -234,6 +259,66 @@ TEST_F(SFTPClient, pushFileCannotWriteTarget)
     EXPECT_FALSE(sftp_client.push(source_path, target_path));
 }
 
+TEST_F(SFTPClient, pushFileCannotCompleteWrite)
+{
+    std::string test_data = "test_data";
+
+    REPLACE_SFTP_INIT();
+    EXPECT_CALL(*mock_file_ops, is_directory(source_path, _)).WillOnce(Return(false));
+    EXPECT_CALL(*mock_sftp_utils, get_remote_file_target(_, source_path, target_path, _))
+        .WillOnce(Return(target_path));
+    EXPECT_CALL(*mock_file_ops, open_read(source_path, _))
+        .WillOnce(Return(std::make_unique<std::stringstream>(test_data)));
+    REPLACE(sftp_open, [](auto sftp, auto...) { return get_dummy_sftp_file(sftp); });
+
+    REPLACE(sftp_aio_wait_write, [](auto...) { return -1; });
+    auto err = "SFTP server: No space left on device";
+    REPLACE(ssh_get_error, [&](auto...) { return err; });
+
+    auto sftp_client = make_sftp_client();
+
+    mock_logger->expect_log(mpl::Level::error,
+                            fmt::format("cannot write to remote file {}: {}", target_path, err));
+    EXPECT_FALSE(sftp_client.push(source_path, target_path));
+}
+
+TEST_F(SFTPClient, pushFileKeepsSeveralWritesInFlight)
+{
+    std::string test_data(limits.max_write_length * 40 + 7, 'x');
+
+    REPLACE_SFTP_INIT();
+    EXPECT_CALL(*mock_file_ops, is_directory(source_path, _)).WillOnce(Return(false));
+    EXPECT_CALL(*mock_sftp_utils, get_remote_file_target(_, source_path, target_path, _))
+        .WillOnce(Return(target_path));
+    EXPECT_CALL(*mock_file_ops, open_read(source_path, _))
+        .WillOnce(Return(std::make_unique<std::stringstream>(test_data)));
+    REPLACE(sftp_open, [](auto sftp, auto...) { return get_dummy_sftp_file(sftp); });
+
+    std::string written_data;
+    auto in_flight = 0, max_in_flight = 0;
+    REPLACE(sftp_aio_begin_write, [&](auto, auto data, auto size, auto aio) {
+        written_data.append((char*)data, size);
+        max_in_flight = std::max(max_in_flight, ++in_flight);
+        *aio = dummy_aio;
+        return size;
+    });
+    REPLACE(sftp_aio_wait_write, [&](auto...) {
+        --in_flight;
+        return 0;
+    });
+
+    EXPECT_CALL(*mock_file_ops, status(source_path, _))
+        .WillOnce(Return(fs::file_status{fs::file_type::regular, fs::perms::all}));
+    REPLACE(sftp_chmod, [](auto...) { return SSH_FX_OK; });
+
+    auto sftp_client = make_sftp_client();
+
+    EXPECT_TRUE(sftp_client.push(source_path, target_path));
+    EXPECT_EQ(test_data, written_data);
+    EXPECT_GT(max_in_flight, 1);
+    EXPECT_EQ(in_flight, 0);
+}
+
 TEST_F(SFTPClient, pushFileCannotReadSource)
 {
     std::string test_data = "test_data";
@@ -248,7 +333,6 @@ TEST_F(SFTPClient, pushFileCannotReadSource)
     EXPECT_CALL(*mock_file_ops, open_read(source_path, _)).WillOnce(Return(std::move(test_file)));
     REPLACE(sftp_open, [](auto sftp, auto...) { return get_dummy_sftp_file(sftp); });
 
-    REPLACE(sftp_write, [](auto, auto, auto size) { return size; });
     auto err = EACCES;
     EXPECT_CALL(*mock_file_ops, status(source_path, _)).WillOnce([&](auto...) {
         test_file_p->clear();
@@ -278,7 +362,6 @@ TEST_F(SFTPClient, pushFileCannotSetPerms)
         .WillOnce(Return(std::make_unique<std::stringstream>(test_data)));
     REPLACE(sftp_open, [](auto sftp, auto...) { return get_dummy_sftp_file(sftp); });
 
-    REPLACE(sftp_write, [](auto, auto, auto size) { return size; });
 
     EXPECT_CALL(*mock_file_ops, status(source_path, _))
         .WillOnce(Return(fs::file_status{fs::file_type::regular, fs::perms::all}));
@@ -307,11 +390,11 @@ TEST_F(SFTPClient, pullFileSuccess)
         .WillOnce(Return(std::make_unique<std::ostream>(test_file.rdbuf())));
     REPLACE(sftp_open, [](auto sftp, auto...) { return get_dummy_sftp_file(sftp); });
 
-    auto mocked_sftp_read = [&, read = false](auto, void* data, auto) mutable {
+    auto mocked_sftp_aio_wait_read = [&, read = false](auto, void* data, auto) mutable {
         strcpy((char*)data, test_data.c_str());
-        return (read = !read) ? test_data.size() : 0;
+        return std::exchange(read, true) ? 0 : test_data.size();
     };
-    REPLACE(sftp_read, mocked_sftp_read);
+    REPLACE(sftp_aio_wait_read, mocked_sftp_aio_wait_read);
 
     mode_t perms = 0777;
     REPLACE(sftp_stat,
@@ -384,13 +467,13 @@ TEST_F(SFTPClient, pullFileCannotWriteTarget)
     REPLACE(sftp_open, [](auto sftp, auto...) { return get_dummy_sftp_file(sftp); });
 
     auto err = EACCES;
-    auto mocked_sftp_read = [&, read = false](auto...) mutable {
+    auto mocked_sftp_aio_wait_read = [&, read = false](auto...) mutable {
         test_file_p->clear();
         test_file_p->setstate(std::ios_base::failbit);
         errno = err;
-        return (read = !read) ? 10 : 0;
+        return std::exchange(read, true) ? 0 : 10;
     };
-    REPLACE(sftp_read, mocked_sftp_read);
+    REPLACE(sftp_aio_wait_read, mocked_sftp_aio_wait_read);
     REPLACE(sftp_stat, [&](auto...) { return get_dummy_sftp_attr(); });
     EXPECT_CALL(mock_platform, set_permissions(target_path, _, _)).WillOnce(Return(true));
     REPLACE(sftp_setstat, [](auto...) { return SSH_FX_OK; });
@@ -413,7 +496,28 @@ TEST_F(SFTPClient, pullFileCannotReadSource)
         .WillOnce(Return(std::make_unique<std::stringstream>()));
     REPLACE(sftp_open, [](auto sftp, auto...) { return get_dummy_sftp_file(sftp); });
 
-    REPLACE(sftp_read, [](auto...) { return -1; });
+    REPLACE(sftp_aio_wait_read, [](auto...) { return -1; });
+    auto err = "SFTP server: Permission denied";
+    REPLACE(ssh_get_error, [&](auto...) { return err; });
+
+    auto sftp_client = make_sftp_client();
+
+    mock_logger->expect_log(mpl::Level::error,
+                            fmt::format("cannot read from remote file {}: {}", source_path, err));
+    EXPECT_FALSE(sftp_client.pull(source_path, target_path));
+}
+
+TEST_F(SFTPClient, pullFileCannotRequestRead)
+{
+    REPLACE_SFTP_INIT();
+    REPLACE(sftp_stat, [](auto...) { return get_dummy_sftp_attr(); });
+    EXPECT_CALL(*mock_sftp_utils, get_local_file_target(source_path, target_path, _))
+        .WillOnce(Return(target_path));
+    EXPECT_CALL(*mock_file_ops, open_write(target_path, _))
+        .WillOnce(Return(std::make_unique<std::stringstream>()));
+    REPLACE(sftp_open, [](auto sftp, auto...) { return get_dummy_sftp_file(sftp); });
+
+    REPLACE(sftp_aio_begin_read, [](auto...) { return -1; });
     auto err = "SFTP server: Permission denied";
     REPLACE(ssh_get_error, [&](auto...) { return err; });
 
@@ -424,6 +528,52 @@ TEST_F(SFTPClient, pullFileCannotReadSource)
     EXPECT_FALSE(sftp_client.pull(source_path, target_path));
 }
 
+TEST_F(SFTPClient, pullFileResumesAfterShortRead)
+{
+    std::string test_data;
+    for (auto i = 0u; i < limits.max_read_length * 40 + 7; ++i)
+        test_data.push_back(static_cast<char>(i % 251));
+
+    REPLACE_SFTP_INIT();
+    EXPECT_CALL(*mock_sftp_utils, get_local_file_target(source_path, target_path, _))
+        .WillOnce(Return(target_path));
+
+    std::stringstream test_file;
+    EXPECT_CALL(*mock_file_ops, open_write(target_path, _))
+        .WillOnce(Return(std::make_unique<std::ostream>(test_file.rdbuf())));
+    REPLACE(sftp_open, [](auto sftp, auto...) { return get_dummy_sftp_file(sftp); });
+
+    // behave like libssh, where each request reads from the file offset and advances it
+    std::deque<uint64_t> requested_offsets;
+    REPLACE(sftp_aio_begin_read, [&](sftp_file file, size_t len, sftp_aio* aio) {
+        requested_offsets.push_back(file->offset);
+        file->offset += len;
+        *aio = reinterpret_cast<sftp_aio>(&requested_offsets.back());
+        return static_cast<ssize_t>(len);
+    });
+    REPLACE(sftp_aio_wait_read,
+            [&, short_read = true](sftp_aio* aio, void* data, size_t size) mutable {
+                const auto offset = *reinterpret_cast<uint64_t*>(*aio);
+                if (offset >= test_data.size())
+                    return ssize_t{0};
+
+                auto len = std::min<uint64_t>(size, test_data.size() - offset);
+                if (std::exchange(short_read, false))
+                    len /= 2;
+
+                std::memcpy(data, test_data.data() + offset, len);
+                return static_cast<ssize_t>(len);
+            });
+
+    REPLACE(sftp_stat, [](auto...) { return get_dummy_sftp_attr(); });
+    EXPECT_CALL(mock_platform, set_permissions(target_path, _, _)).WillOnce(Return(true));
+
+    auto sftp_client = make_sftp_client();
+
+    EXPECT_TRUE(sftp_client.pull(source_path, target_path));
+    EXPECT_EQ(test_data, test_file.str());
+}
+
 TEST_F(SFTPClient, pullFileCannotSetPerms)
 {
     REPLACE_SFTP_INIT();
@@ -432,7 +582,8 @@ TEST_F(SFTPClient, pullFileCannotSetPerms)
     EXPECT_CALL(*mock_file_ops, open_write(target_path, _))
         .WillOnce(Return(std::make_unique<std::stringstream>()));
     REPLACE(sftp_open, [](auto sftp, auto...) { return get_dummy_sftp_file(sftp); });
-    REPLACE(sftp_read, [read = false](auto...) mutable { return (read = !read) ? 10 : 0; });
+    REPLACE(sftp_aio_wait_read,
+            [read = false](auto...) mutable { return std::exchange(read, true) ? 0 : 10; });
 
     mode_t perms = 0777;
     REPLACE(sftp_stat,
@@ -474,8 +625,10 @@ TEST_F(SFTPClient, pushDirSuccessRegular)
         .WillOnce(Return(std::make_unique<std::stringstream>(test_data)));
     REPLACE(sftp_open, [](auto sftp, auto...) { return get_dummy_sftp_file(sftp); });
     std::string written_data;
-    REPLACE(sftp_write, [&](auto, const void* data, auto size) {
-        return written_data.append((char*)data, size).size();
+    REPLACE(sftp_aio_begin_write, [&](auto, const void* data, auto size, auto aio) {
+        written_data.append((char*)data, size);
+        *aio = dummy_aio;
+        return size;
     });
     EXPECT_CALL(*mock_file_ops, status).Times(2).WillRepeatedly(Return(status));
 
@@ -806,11 +959,11 @@ TEST_F(SFTPClient, pullDirSuccessRegular)
     EXPECT_CALL(*mock_file_ops, open_write).WillOnce(Return(std::make_unique<std::ostream>(test_file.rdbuf())));
     REPLACE(sftp_open, [](auto sftp, auto...) { return get_dummy_sftp_file(sftp); });
 
-    auto mocked_sftp_read = [&, read = false](auto, const void* data, auto size) mutable {
+    auto mocked_sftp_aio_wait_read = [&, read = false](auto, void* data, auto) mutable {
         strcpy((char*)data, test_data.c_str());
-        return (read = !read) ? test_data.size() : 0;
+        return std::exchange(read, true) ? 0 : test_data.size();
     };
-    REPLACE(sftp_read, mocked_sftp_read);
+    REPLACE(sftp_aio_wait_read, mocked_sftp_aio_wait_read);
 
     mode_t perms = 0777;
     REPLACE(sftp_stat, [&](auto, auto path) {
@@ -37,6 +37,7 @@
 #include <multipass/ssh/ssh_session.h>
 
 #include <queue>
+#include <thread>
 
 namespace mp = multipass;
 namespace mpl = multipass::logging;
@@ -76,6 +77,20 @@ struct SftpServer : public mp::test::SftpServerTest
                 "sshfs"};
     }
 
+    mp::SftpServer make_pipelined_sftpserver(const std::string& path, int io_workers = 4)
+    {
+        mp::SSHSession session{"a", 42, "ubuntu", key_provider};
+        return {std::move(session),
+                path,
+                path,
+                {{default_gid, mp::default_id}},
+                {{default_uid, mp::default_id}},
+                default_uid,
+                default_gid,
+                "sshfs",
+                io_workers};
+    }
+
     auto make_msg(uint8_t type = SFTP_BAD_MESSAGE)
     {
         auto msg = std::make_unique<sftp_client_message_struct>();
@@ -1698,6 +1713,66 @@ TEST_F(SftpServer, handlesReaddir)
     EXPECT_THAT(given_entries, ContainerEq(expected_entries));
 }
 
+struct ReaddirBatching : public SftpServer, public WithParamInterface<std::pair<std::size_t, int>>
+{
+};
+
+TEST_P(ReaddirBatching, fillsRepliesBySize)
+{
+    const auto& [name_length, expected_replies] = GetParam();
+    constexpr auto num_entries = 200ul;
+
+    mpt::TempDir temp_dir;
+    auto sftp = make_sftpserver(temp_dir.path().toStdString());
+
+    auto readdir_msgs = std::vector<std::unique_ptr<sftp_client_message_struct>>{};
+    for (auto i = 0; i <= expected_replies; ++i)
+        readdir_msgs.push_back(make_msg(SFTP_READDIR));
+
+    std::vector<mp::fs::path> entries;
+    for (auto i = 0ul; i < num_entries; ++i)
+        entries.push_back(fmt::format("{:0{}}", i, name_length));
+    auto entries_read = 0ul;
+
+    auto directory_entry = mpt::MockDirectoryEntry{};
+    EXPECT_CALL(directory_entry, path).WillRepeatedly([&]() -> const mp::fs::path& {
+        return entries[entries_read - 1];
+    });
+    auto dir_iterator = mpt::MockDirIterator{};
+    EXPECT_CALL(dir_iterator, hasNext).WillRepeatedly([&] {
+        return entries_read != entries.size();
+    });
+    EXPECT_CALL(dir_iterator, next)
+        .WillRepeatedly(DoAll([&] { entries_read++; }, ReturnRef(directory_entry)));
+
+    REPLACE(sftp_handle, [&dir_iterator](auto...) { return &dir_iterator; });
+    REPLACE(sftp_get_client_message, make_msg_handler());
+    int eof_num_calls{0};
+    REPLACE(sftp_reply_status,
+            make_reply_status(readdir_msgs.back().get(), SSH_FX_EOF, eof_num_calls));
+
+    auto entries_added = 0ul;
+    REPLACE(sftp_reply_names_add, [&entries_added](auto...) {
+        ++entries_added;
+        return SSH_OK;
+    });
+    int names_num_calls{0};
+    REPLACE(sftp_reply_names, [&names_num_calls](auto...) {
+        ++names_num_calls;
+        return SSH_OK;
+    });
+
+    sftp.run();
+
+    EXPECT_EQ(entries_added, num_entries);
+    EXPECT_EQ(names_num_calls, expected_replies);
+    EXPECT_EQ(eof_num_calls, 1);
+}
+
+INSTANTIATE_TEST_SUITE_P(SftpServer,
+                         ReaddirBatching,
+                         Values(std::make_pair(8ul, 1), std::make_pair(1000ul, 7)));
+
 TEST_F(SftpServer, handlesReaddirAttributesPreserved)
 {
     mpt::TempDir temp_dir;
@@ -2224,13 +2299,13 @@ TEST_F(SftpServer, handlesWrites)
     const auto fd = 123;
     const auto named_fd = std::make_pair(path, fd);
 
-    std::stringstream stream;
+    std::string content;
 
     const auto [file_ops, mock_file_ops_guard] = mpt::MockFileOps::inject();
-    EXPECT_CALL(*file_ops, lseek).WillRepeatedly(Return(true));
-    EXPECT_CALL(*file_ops, write(fd, _, _))
-        .WillRepeatedly([&stream](int, const void* buf, size_t nbytes) {
-            stream.write((const char*)buf, nbytes);
+    EXPECT_CALL(*file_ops, pwrite(fd, _, _, _))
+        .WillRepeatedly([&content](int, const void* buf, size_t nbytes, off_t offset) {
+            content.resize(std::max(content.size(), offset + nbytes));
+            ::memcpy(content.data() + offset, buf, nbytes);
             return nbytes;
         });
 
@@ -2248,35 +2323,7 @@ TEST_F(SftpServer, handlesWrites)
     sftp.run();
 
     ASSERT_EQ(num_calls, 2);
-    EXPECT_EQ(stream.str(), "The answer is always 42");
-}
-
-TEST_F(SftpServer, writeCannotSeekFails)
-{
-    mpt::TempDir temp_dir;
-    auto sftp = make_sftpserver(temp_dir.path().toStdString());
-
-    auto write_msg = make_msg(SFTP_WRITE);
-    auto data1 = make_data("The answer is ");
-    write_msg->data = data1.get();
-    write_msg->offset = 10;
-
-    const auto path = mp::fs::path{temp_dir.path().toStdString()} / "test-file";
-    const auto fd = 123;
-    const auto named_fd = std::make_pair(path, fd);
-
-    const auto [file_ops, mock_file_ops_guard] = mpt::MockFileOps::inject();
-    EXPECT_CALL(*file_ops, lseek(fd, _, _)).WillRepeatedly(Return(-1));
-
-    REPLACE(sftp_handle, [&named_fd](auto...) { return (void*)&named_fd; });
-    REPLACE(sftp_get_client_message, make_msg_handler());
-    int failure_num_calls{0};
-    REPLACE(sftp_reply_status,
-            make_reply_status(write_msg.get(), SSH_FX_FAILURE, failure_num_calls));
-
-    sftp.run();
-
-    EXPECT_EQ(failure_num_calls, 1);
+    EXPECT_EQ(content, "The answer is always 42");
 }
 
 TEST_F(SftpServer, writeFailureFails)
@@ -2294,8 +2341,7 @@ TEST_F(SftpServer, writeFailureFails)
     const auto named_fd = std::make_pair(path, fd);
 
     const auto [file_ops, mock_file_ops_guard] = mpt::MockFileOps::inject();
-    EXPECT_CALL(*file_ops, lseek(fd, _, _)).WillRepeatedly(Return(true));
-    EXPECT_CALL(*file_ops, write(fd, _, _)).WillRepeatedly(Return(-1));
+    EXPECT_CALL(*file_ops, pwrite(fd, _, _, _)).WillRepeatedly(Return(-1));
 
     REPLACE(sftp_handle, [&named_fd](auto...) { return (void*)&named_fd; });
     REPLACE(sftp_get_client_message, make_msg_handler());
@@ -2323,11 +2369,9 @@ TEST_F(SftpServer, handlesReads)
     const auto named_fd = std::make_pair(path, fd);
 
     const auto [file_ops, mock_file_ops_guard] = mpt::MockFileOps::inject();
-    EXPECT_CALL(*file_ops, lseek(fd, _, _)).WillRepeatedly(Return(true));
-    EXPECT_CALL(*file_ops, read(fd, _, _))
-        .WillRepeatedly([&given_data, r = 0](int, void* buf, size_t count) mutable {
-            ::memcpy(buf, given_data.c_str() + r, count);
-            r += count;
+    EXPECT_CALL(*file_ops, pread(fd, _, _, 0))
+        .WillRepeatedly([&given_data](int, void* buf, size_t count, off_t) {
+            ::memcpy(buf, given_data.c_str(), count);
             return count;
         });
 
@@ -2352,15 +2396,15 @@ TEST_F(SftpServer, handlesReads)
     ASSERT_EQ(num_calls, 1);
 }
 
-TEST_F(SftpServer, readCannotSeekFails)
+TEST_F(SftpServer, readCoalescesShortReads)
 {
     mpt::TempDir temp_dir;
     auto sftp = make_sftpserver(temp_dir.path().toStdString());
 
     std::string given_data{"some text"};
-    const int seek_pos{10};
+    const int offset{10};
     auto read_msg = make_msg(SFTP_READ);
-    read_msg->offset = seek_pos;
+    read_msg->offset = offset;
     read_msg->len = given_data.size();
 
     const auto path = mp::fs::path{temp_dir.path().toStdString()} / "test-file";
@@ -2368,24 +2412,30 @@ TEST_F(SftpServer, readCannotSeekFails)
     const auto named_fd = std::make_pair(path, fd);
 
     const auto [file_ops, mock_file_ops_guard] = mpt::MockFileOps::inject();
-    EXPECT_CALL(*file_ops, lseek(fd, _, _)).WillRepeatedly(Return(-1));
+    EXPECT_CALL(*file_ops, pread(fd, _, _, _))
+        .Times(given_data.size())
+        .WillRepeatedly([&given_data](int, void* buf, size_t, off_t pos) {
+            ::memcpy(buf, given_data.c_str() + pos - offset, 1);
+            return 1;
+        });
 
     REPLACE(sftp_handle, [&named_fd](auto...) { return (void*)&named_fd; });
     REPLACE(sftp_get_client_message, make_msg_handler());
-    int failure_num_calls{0};
-    REPLACE(sftp_reply_status,
-            make_reply_status(read_msg.get(), SSH_FX_FAILURE, failure_num_calls));
 
-    logger_scope.mock_logger->screen_logs(mpl::Level::trace);
-    EXPECT_CALL(*logger_scope.mock_logger,
-                log(mpl::Level::trace,
-                    StrEq("sftp server"),
-                    AllOf(HasSubstr(fmt::format("cannot seek to position {} in", seek_pos)),
-                          HasSubstr(path.string()))));
+    int num_calls{0};
+    auto reply_data = [&](sftp_client_message msg, const void* data, int len) {
+        EXPECT_EQ(msg, read_msg.get());
+        EXPECT_EQ((std::string{reinterpret_cast<const char*>(data),
+                               static_cast<std::string::size_type>(len)}),
+                  given_data);
+        ++num_calls;
+        return SSH_OK;
+    };
+    REPLACE(sftp_reply_data, reply_data);
 
     sftp.run();
 
-    EXPECT_EQ(failure_num_calls, 1);
+    EXPECT_EQ(num_calls, 1);
 }
 
 TEST_F(SftpServer, readReturnsFailureFails)
@@ -2403,8 +2453,7 @@ TEST_F(SftpServer, readReturnsFailureFails)
     const auto named_fd = std::make_pair(path, fd);
 
     const auto [file_ops, mock_file_ops_guard] = mpt::MockFileOps::inject();
-    EXPECT_CALL(*file_ops, lseek(fd, _, _)).WillRepeatedly(Return(true));
-    EXPECT_CALL(*file_ops, read(fd, _, _)).WillOnce(Return(-1));
+    EXPECT_CALL(*file_ops, pread(fd, _, _, _)).WillOnce(Return(-1));
 
     REPLACE(sftp_handle, [&named_fd](auto...) { return (void*)&named_fd; });
     REPLACE(sftp_get_client_message, make_msg_handler());
@@ -2437,8 +2486,7 @@ TEST_F(SftpServer, readReturnsZeroEndOfFile)
     const auto named_fd = std::make_pair(path, fd);
 
     const auto [file_ops, mock_file_ops_guard] = mpt::MockFileOps::inject();
-    EXPECT_CALL(*file_ops, lseek(fd, _, _)).WillRepeatedly(Return(true));
-    EXPECT_CALL(*file_ops, read(fd, _, _)).WillOnce(Return(0));
+    EXPECT_CALL(*file_ops, pread(fd, _, _, _)).WillOnce(Return(0));
 
     REPLACE(sftp_handle, [&named_fd](auto...) { return (void*)&named_fd; });
     REPLACE(sftp_get_client_message, make_msg_handler());
@@ -2450,6 +2498,217 @@ TEST_F(SftpServer, readReturnsZeroEndOfFile)
     EXPECT_EQ(eof_num_calls, 1);
 }
 
+TEST_F(SftpServer, pipelinedWritesAreAllAcknowledgedInOrder)
+{
+    mpt::TempDir temp_dir;
+    auto sftp = make_pipelined_sftpserver(temp_dir.path().toStdString());
+
+    const std::vector<std::string> chunks{"The ", "answer ", "is ", "always ", "42"};
+    std::vector<std::unique_ptr<sftp_client_message_struct>> write_msgs;
+    std::vector<StringUPtr> datas;
+    uint64_t offset = 0;
+    for (const auto& chunk : chunks)
+    {
+        auto& msg = write_msgs.emplace_back(make_msg(SFTP_WRITE));
+        auto& data = datas.emplace_back(make_data(chunk));
+        msg->data = data.get();
+        msg->offset = offset;
+        offset += chunk.size();
+    }
+
+    const auto path = mp::fs::path{temp_dir.path().toStdString()} / "test-file";
+    const auto fd = 123;
+    const auto named_fd = std::make_pair(path, fd);
+
+    std::string content;
+
+    const auto [file_ops, mock_file_ops_guard] = mpt::MockFileOps::inject();
+    EXPECT_CALL(*file_ops, pwrite(fd, _, _, _))
+        .WillRepeatedly([&content](int, const void* buf, size_t nbytes, off_t offset) {
+            content.resize(std::max(content.size(), offset + nbytes));
+            ::memcpy(content.data() + offset, buf, nbytes);
+            return nbytes;
+        });
+
+    REPLACE(sftp_handle, [&named_fd](auto...) { return (void*)&named_fd; });
+    REPLACE(sftp_get_client_message, make_msg_handler());
+
+    std::vector<sftp_client_message> replied;
+    auto reply_status = [&replied](sftp_client_message msg, uint32_t status, auto) {
+        EXPECT_TRUE(status == SSH_FX_OK);
+        replied.push_back(msg);
+        return SSH_OK;
+    };
+    REPLACE(sftp_reply_status, reply_status);
+
+    sftp.run();
+
+    std::vector<sftp_client_message> expected;
+    for (const auto& msg : write_msgs)
+        expected.push_back(msg.get());
+
+    EXPECT_THAT(replied, ElementsAreArray(expected));
+    EXPECT_EQ(content, "The answer is always 42");
+}
+
+TEST_F(SftpServer, pipelinedReadsAreAllReplied)
+{
+    mpt::TempDir temp_dir;
+    auto sftp = make_pipelined_sftpserver(temp_dir.path().toStdString());
+
+    std::string given_data{"some text"};
+    auto read_msg1 = make_msg(SFTP_READ);
+    read_msg1->offset = 0;
+    read_msg1->len = given_data.size();
+    auto read_msg2 = make_msg(SFTP_READ);
+    read_msg2->offset = 0;
+    read_msg2->len = given_data.size();
+
+    const auto path1 = mp::fs::path{temp_dir.path().toStdString()} / "test-file1";
+    const auto path2 = mp::fs::path{temp_dir.path().toStdString()} / "test-file2";
+    const auto named_fd1 = std::make_pair(path1, 123);
+    const auto named_fd2 = std::make_pair(path2, 124);
+
+    const auto [file_ops, mock_file_ops_guard] = mpt::MockFileOps::inject();
+    EXPECT_CALL(*file_ops, pread(_, _, _, 0))
+        .WillRepeatedly([&given_data](int, void* buf, size_t, off_t) {
+            ::memcpy(buf, given_data.c_str(), given_data.size());
+            return given_data.size();
+        });
+
+    REPLACE(sftp_handle, [&](auto, ssh_string) {
+        return (void*)(messages.size() % 2 ? &named_fd1 : &named_fd2);
+    });
+    REPLACE(sftp_get_client_message, make_msg_handler());
+
+    int num_calls{0};
+    auto reply_data = [&](sftp_client_message msg, const void* data, int len) {
+        EXPECT_THAT(msg, AnyOf(Eq(read_msg1.get()), Eq(read_msg2.get())));
+        EXPECT_EQ((std::string{reinterpret_cast<const char*>(data),
+                               static_cast<std::string::size_type>(len)}),
+                  given_data);
+        ++num_calls;
+        return SSH_OK;
+    };
+    REPLACE(sftp_reply_data, reply_data);
+
+    sftp.run();
+
+    EXPECT_EQ(num_calls, 2);
+}
+
+TEST_F(SftpServer, pipelinedIoKeepsOrderAcrossHandlesToTheSameFile)
+{
+    mpt::TempDir temp_dir;
+    auto file_name = temp_dir.path() + "/test-file";
+    mpt::make_file_with_content(file_name, "");
+
+    auto sftp = make_pipelined_sftpserver(temp_dir.path().toStdString());
+
+    auto name = name_as_char_array(file_name.toStdString());
+    auto open_msg1 = make_msg(SFTP_OPEN);
+    open_msg1->filename = name.data();
+    open_msg1->flags |= SSH_FXF_READ | SSH_FXF_WRITE;
+    auto open_msg2 = make_msg(SFTP_OPEN);
+    open_msg2->filename = name.data();
+    open_msg2->flags |= SSH_FXF_READ | SSH_FXF_WRITE;
+
+    // The write goes through the first handle, the read that must see it through the second
+    auto write_handle = make_data("1");
+    auto read_handle = make_data("2");
+    auto write_msg = make_msg(SFTP_WRITE);
+    auto data = make_data("42");
+    write_msg->handle = write_handle.get();
+    write_msg->data = data.get();
+    write_msg->offset = 0;
+    auto read_msg = make_msg(SFTP_READ);
+    read_msg->handle = read_handle.get();
+    read_msg->offset = 0;
+    read_msg->len = 10;
+
+    const auto file_ops_injection = mpt::MockFileOps::inject();
+    const auto file_ops = file_ops_injection.first;
+    EXPECT_CALL(*file_ops, symlink_status(_, _))
+        .WillRepeatedly([](const mp::fs::path& path, std::error_code& err) {
+            return mp::fs::symlink_status(path, err);
+        });
+    EXPECT_CALL(*file_ops, ownerId(_)).WillRepeatedly([](const QFileInfo& file) {
+        return file.ownerId();
+    });
+    EXPECT_CALL(*file_ops, groupId(_)).WillRepeatedly([](const QFileInfo& file) {
+        return file.groupId();
+    });
+    EXPECT_CALL(*file_ops, open_fd(_, _, _))
+        .WillRepeatedly([file_ops](const mp::fs::path& path, int flags, int perms) {
+            return file_ops->FileOps::open_fd(path, flags, perms);
+        });
+    EXPECT_CALL(*file_ops, pwrite(_, _, _, _))
+        .WillOnce([file_ops](int fd, const void* buf, size_t nbytes, off_t offset) {
+            std::this_thread::sleep_for(std::chrono::milliseconds{50});
+            return file_ops->FileOps::pwrite(fd, buf, nbytes, offset);
+        });
+    EXPECT_CALL(*file_ops, pread(_, _, _, _))
+        .WillRepeatedly([file_ops](int fd, void* buf, size_t nbytes, off_t offset) {
+            return file_ops->FileOps::pread(fd, buf, nbytes, offset);
+        });
+
+    std::vector<void*> ids;
+    REPLACE(sftp_handle_alloc, [&ids](sftp_session, void* info) {
+        ids.push_back(info);
+        return ssh_string_new(4);
+    });
+    REPLACE(sftp_reply_handle, [](auto...) { return SSH_OK; });
+    REPLACE(sftp_handle, [&](auto, ssh_string handle) {
+        return handle == write_handle.get() ? ids.at(0) : ids.at(1);
+    });
+    REPLACE(sftp_get_client_message, make_msg_handler());
+    REPLACE(sftp_reply_status, [](auto...) { return SSH_OK; });
+
+    std::string read_data;
+    REPLACE(sftp_reply_data, [&read_data](sftp_client_message, const void* data, int len) {
+        read_data.assign(static_cast<const char*>(data), len);
+        return SSH_OK;
+    });
+
+    sftp.run();
+
+    EXPECT_EQ(read_data, "42");
+}
+
+TEST_F(SftpServer, pipelinedIoCompletesBeforeOtherRequests)
+{
+    mpt::TempDir temp_dir;
+    auto sftp = make_pipelined_sftpserver(temp_dir.path().toStdString());
+
+    auto write_msg = make_msg(SFTP_WRITE);
+    auto data = make_data("42");
+    write_msg->data = data.get();
+    write_msg->offset = 0;
+    auto close_msg = make_msg(SFTP_CLOSE);
+
+    const auto path = mp::fs::path{temp_dir.path().toStdString()} / "test-file";
+    const auto named_fd = std::make_pair(path, 123);
+
+    const auto [file_ops, mock_file_ops_guard] = mpt::MockFileOps::inject();
+    EXPECT_CALL(*file_ops, pwrite(_, _, _, _)).WillOnce([](int, const void*, size_t nbytes, off_t) {
+        std::this_thread::sleep_for(std::chrono::milliseconds{50});
+        return nbytes;
+    });
+
+    REPLACE(sftp_handle, [&named_fd](auto...) { return (void*)&named_fd; });
+    REPLACE(sftp_get_client_message, make_msg_handler());
+
+    std::vector<sftp_client_message> replies;
+    REPLACE(sftp_reply_status, [&replies](sftp_client_message msg, auto...) {
+        replies.push_back(msg);
+        return SSH_OK;
+    });
+
+    sftp.run();
+
+    EXPECT_THAT(replies, ElementsAre(write_msg.get(), close_msg.get()));
+}
+
 TEST_F(SftpServer, handleExtendedLink)
 {
     mpt::TempDir temp_dir;
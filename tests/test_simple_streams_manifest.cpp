@@ -77,6 +77,16 @@ TEST_F(TestSimpleStreamsManifest, canFindInfoByAlias)
     EXPECT_THAT(info->stream_location, Eq(host_url));
 }
 
+TEST_F(TestSimpleStreamsManifest, indexesAllProductsById)
+{
+    auto json = mpt::load_test_file("good_manifest.json");
+    auto manifest = mp::SimpleStreamsManifest::fromJson(json, std::nullopt, "");
+
+    ASSERT_THAT(manifest->images_by_id.size(), Eq(manifest->products.size()));
+    for (const auto& product : manifest->products)
+        EXPECT_THAT(manifest->images_by_id.values(product.id), Contains(&product));
+}
+
 TEST_F(TestSimpleStreamsManifest, throwsOnInvalidJson)
 {
     QByteArray json;
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "common.h"
+#include "file_operations.h"
+#include "temp_dir.h"
+
+#include <multipass/sparse_file_writer.h>
+
+namespace mp = multipass;
+namespace mpt = multipass::test;
+
+using namespace testing;
+
+namespace
+{
+constexpr auto block_size = mp::SparseFileWriter::block_size;
+
+struct SparseFileWriter : public Test
+{
+    SparseFileWriter()
+    {
+        file.open(QIODevice::WriteOnly);
+    }
+
+    // Writes the data in chunks that do not line up with the writer's blocks
+    void write_in_chunks(const QByteArray& data, qsizetype chunk_size = 1000)
+    {
+        for (qsizetype pos = 0; pos < data.size(); pos += chunk_size)
+            writer.write(data.mid(pos, chunk_size));
+
+        writer.finish();
+        file.close();
+    }
+
+    mpt::TempDir temp_dir;
+    QFile file{temp_dir.filePath("image")};
+    mp::SparseFileWriter writer{file};
+};
+} // namespace
+
+TEST_F(SparseFileWriter, writesDataWithoutZeroBlocks)
+{
+    const QByteArray data(3 * block_size, 'x');
+    write_in_chunks(data);
+
+    EXPECT_EQ(mpt::load(file.fileName()), data);
+    EXPECT_EQ(writer.bytes_written(), data.size());
+    EXPECT_EQ(writer.size(), data.size());
+}
+
+TEST_F(SparseFileWriter, skipsZeroBlocks)
+{
+    const QByteArray data = QByteArray(block_size, 'x') + QByteArray(2 * block_size, '\0') +
+                            QByteArray(block_size + 10, 'y');
+    write_in_chunks(data);
+
+    EXPECT_EQ(mpt::load(file.fileName()), data);
+    EXPECT_EQ(writer.bytes_written(), 2 * block_size + 10);
+    EXPECT_EQ(writer.size(), data.size());
+}
+
+TEST_F(SparseFileWriter, extendsFileOverTrailingZeros)
+{
+    const QByteArray data = QByteArray(10, 'x') + QByteArray(3 * block_size - 10, '\0');
+    write_in_chunks(data, 4000);
+
+    EXPECT_EQ(mpt::load(file.fileName()), data);
+    EXPECT_EQ(writer.bytes_written(), block_size);
+}
+
+TEST_F(SparseFileWriter, writesPartialBlocksOfZeros)
+{
+    const QByteArray data = QByteArray(block_size, 'x') + QByteArray(block_size / 2, '\0');
+    write_in_chunks(data, block_size);
+
+    EXPECT_EQ(mpt::load(file.fileName()), data);
+    EXPECT_EQ(writer.bytes_written(), data.size());
+}
@@ -17,12 +17,22 @@
 
 #include "common.h"
 #include "mock_ssh.h"
+#include "mock_ssh_process_exit_status.h"
+#include "mock_ssh_test_fixture.h"
 #include "stub_ssh_key_provider.h"
 
+#include <multipass/exceptions/exitless_sshprocess_exceptions.h>
 #include <multipass/ssh/ssh_session.h>
 
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
 namespace mp = multipass;
+namespace mpt = multipass::test;
 using namespace testing;
+using namespace std::chrono_literals;
 
 namespace
 {
@@ -35,6 +45,13 @@ struct SSHSession : public Test
 
     mp::test::StubSSHKeyProvider key_provider;
 };
+
+struct SSHSessionExecAsync : public Test
+{
+    const mpt::StubSSHKeyProvider key_provider;
+    mpt::MockSSHTestFixture mock_ssh_test_fixture;
+    mp::SSHSession session{"theanswertoeverything", 42, "ubuntu", key_provider};
+};
 } // namespace
 
 TEST_F(SSHSession, throwsWhenUnableToAllocateSession)
@@ -130,3 +147,132 @@ TEST_F(SSHSession, moveAssigns)
     EXPECT_EQ(ssh_session{session1}, ssh_session2);
     EXPECT_EQ(ssh_session{session2}, nullptr);
 }
+
+TEST_F(SSHSessionExecAsync, returnsExitStatusAndOutput)
+{
+    mpt::ExitStatusMock exit_status_mock;
+    exit_status_mock.set_exit_status(mpt::ExitStatusMock::success_status);
+
+    std::string output{"some output"};
+    auto channel_read = [&output](ssh_channel, void* dest, uint32_t count, int is_stderr, int) {
+        if (is_stderr || output.empty())
+            return 0;
+
+        const auto num_bytes = std::min(count, static_cast<uint32_t>(output.size()));
+        std::copy_n(output.begin(), num_bytes, static_cast<char*>(dest));
+        output.erase(0, num_bytes);
+        return static_cast<int>(num_bytes);
+    };
+    REPLACE(ssh_channel_read_timeout, channel_read);
+
+    const auto result = session.exec_async("something").get();
+    EXPECT_EQ(result.exit_code, mpt::ExitStatusMock::success_status);
+    EXPECT_EQ(result.std_output, "some output");
+    EXPECT_EQ(result.std_error, "");
+}
+
+TEST_F(SSHSessionExecAsync, readsOutputTrailingTheExitStatusWithoutBlocking)
+{
+    mpt::ExitStatusMock exit_status_mock;
+    exit_status_mock.set_exit_status(mpt::ExitStatusMock::success_status);
+
+    // The output only arrives after the exit status was seen and the channel is not at EOF yet
+    auto eof_checks = 0;
+    REPLACE(ssh_channel_is_eof, [&eof_checks](auto...) { return eof_checks++ > 0; });
+
+    std::string output{"late output"};
+    auto blocking_reads = 0;
+    auto channel_read = [&](ssh_channel, void* dest, uint32_t count, int is_stderr, int timeout) {
+        blocking_reads += timeout < 0;
+        if (is_stderr || eof_checks == 0 || output.empty())
+            return 0;
+
+        const auto num_bytes = std::min(count, static_cast<uint32_t>(output.size()));
+        std::copy_n(output.begin(), num_bytes, static_cast<char*>(dest));
+        output.erase(0, num_bytes);
+        return static_cast<int>(num_bytes);
+    };
+    REPLACE(ssh_channel_read_timeout, channel_read);
+
+    const auto result = session.exec_async("something").get();
+    EXPECT_EQ(result.exit_code, mpt::ExitStatusMock::success_status);
+    EXPECT_EQ(result.std_output, "late output");
+    EXPECT_EQ(blocking_reads, 0);
+}
+
+TEST_F(SSHSessionExecAsync, leavesTheSessionOutOfTheEventWhenIdle)
+{
+    mpt::ExitStatusMock exit_status_mock;
+    exit_status_mock.set_exit_status(mpt::ExitStatusMock::success_status);
+
+    std::atomic_int sessions_in_event{0};
+    REPLACE(ssh_event_add_session, [&sessions_in_event](auto...) {
+        ++sessions_in_event;
+        return SSH_OK;
+    });
+    REPLACE(ssh_event_remove_session, [&sessions_in_event](auto...) {
+        --sessions_in_event;
+        return SSH_OK;
+    });
+
+    EXPECT_EQ(sessions_in_event, 0);
+    session.exec_async("something").get();
+
+    // The session leaves the event right after the command completes, on the multiplexer thread
+    const auto deadline = std::chrono::steady_clock::now() + 1s;
+    while (sessions_in_event != 0 && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(1ms);
+
+    EXPECT_EQ(sessions_in_event, 0);
+}
+
+TEST_F(SSHSessionExecAsync, runsCommandsConcurrently)
+{
+    std::vector<ssh_channel_callbacks> callbacks;
+    REPLACE(ssh_add_channel_callbacks, [&callbacks](ssh_channel, ssh_channel_callbacks cb) {
+        callbacks.push_back(cb);
+        return SSH_OK;
+    });
+
+    // Neither command finishes until both are running
+    REPLACE(ssh_event_dopoll, [&callbacks](auto...) {
+        if (callbacks.size() == 2)
+            for (auto cb : callbacks)
+                cb->channel_exit_status_function(nullptr, nullptr, 0, cb->userdata);
+
+        return SSH_OK;
+    });
+
+    auto first = session.exec_async("first", false, 1s);
+    auto second = session.exec_async("second", false, 1s);
+
+    EXPECT_EQ(first.get().exit_code, 0);
+    EXPECT_EQ(second.get().exit_code, 0);
+}
+
+TEST_F(SSHSessionExecAsync, timesOut)
+{
+    mpt::ExitStatusMock exit_status_mock;
+    exit_status_mock.set_no_exit();
+
+    auto result = session.exec_async("something", false, 1ms);
+    EXPECT_THROW(result.get(), mp::SSHProcessTimeoutException);
+}
+
+TEST_F(SSHSessionExecAsync, reportsSshErrors)
+{
+    mpt::ExitStatusMock exit_status_mock;
+    exit_status_mock.set_no_exit();
+    exit_status_mock.set_ssh_rc(SSH_ERROR);
+
+    auto result = session.exec_async("something");
+    EXPECT_THROW(result.get(), mp::SSHProcessExitError);
+}
+
+TEST_F(SSHSessionExecAsync, throwsOnADeadSession)
+{
+    mock_ssh_test_fixture.is_connected.returnValue(false);
+
+    auto result = session.exec_async("something");
+    EXPECT_THROW(result.get(), mp::SSHException);
+}
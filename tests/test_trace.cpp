@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "common.h"
+
+#include <multipass/logging/trace.h>
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <optional>
+#include <thread>
+
+namespace mpl = multipass::logging;
+
+using namespace testing;
+
+namespace
+{
+std::vector<std::string> names_of(const std::vector<mpl::TraceEvent>& events)
+{
+    std::vector<std::string> names;
+    for (const auto& event : events)
+        names.push_back(event.name);
+
+    return names;
+}
+} // namespace
+
+TEST(Trace, spansOutsideRecordingsAreDropped)
+{
+    {
+        mpl::TraceSpan span{"unrecorded"};
+    }
+
+    mpl::TraceRecording recording{"rpc"};
+    recording.finish();
+
+    EXPECT_THAT(names_of(recording.events()), ElementsAre("rpc"));
+}
+
+TEST(Trace, recordsNestedSpans)
+{
+    mpl::TraceRecording recording{"rpc"};
+    {
+        mpl::TraceSpan outer{"outer"};
+        mpl::TraceSpan inner{"inner"};
+    }
+    recording.finish();
+
+    const auto events = recording.events();
+    ASSERT_THAT(names_of(events), ElementsAre("inner", "outer", "rpc"));
+    EXPECT_GE(events[0].start, events[1].start);
+    EXPECT_LE(events[0].start + events[0].duration, events[1].start + events[1].duration);
+    EXPECT_EQ(events[0].thread, events[2].thread);
+}
+
+TEST(Trace, recordsSpansFromOtherThreads)
+{
+    mpl::TraceRecording recording{"rpc"};
+    std::thread{[] { mpl::TraceSpan span{"worker"}; }}.join();
+    recording.finish();
+
+    const auto events = recording.events();
+    ASSERT_THAT(names_of(events), ElementsAre("worker", "rpc"));
+    EXPECT_NE(events[0].thread, events[1].thread);
+}
+
+TEST(Trace, ignoresSpansAfterFinishing)
+{
+    mpl::TraceRecording recording{"rpc"};
+    recording.finish();
+    {
+        mpl::TraceSpan span{"late"};
+    }
+
+    EXPECT_THAT(names_of(recording.events()), ElementsAre("rpc"));
+}
+
+TEST(Trace, ignoresSpansStartedBeforeRecording)
+{
+    mpl::TraceRecording first{"first"};
+    std::optional<mpl::TraceRecording> second;
+    {
+        mpl::TraceSpan span{"early"};
+        second.emplace("second");
+    }
+    second->finish();
+    first.finish();
+
+    EXPECT_THAT(names_of(second->events()), ElementsAre("second"));
+    EXPECT_THAT(names_of(first.events()), ElementsAre("early", "first"));
+}
+
+TEST(Trace, exportsChromeTrace)
+{
+    mpl::TraceRecording recording{"launch"};
+    std::thread{[] { mpl::TraceSpan span{"fetch_image"}; }}.join();
+    recording.finish();
+
+    const auto trace = QJsonDocument::fromJson(recording.to_chrome_trace()).object();
+    const auto events = trace["traceEvents"].toArray();
+    ASSERT_EQ(events.size(), 2);
+
+    const auto launch = events[0].toObject();
+    EXPECT_EQ(launch["name"].toString(), "launch");
+    EXPECT_EQ(launch["ph"].toString(), "X");
+    EXPECT_EQ(launch["ts"].toDouble(), 0.0);
+    EXPECT_EQ(launch["tid"].toInt(), 1);
+
+    const auto fetch = events[1].toObject();
+    EXPECT_EQ(fetch["name"].toString(), "fetch_image");
+    EXPECT_GE(fetch["ts"].toDouble(), 0.0);
+    EXPECT_LE(fetch["dur"].toDouble(), launch["dur"].toDouble());
+    EXPECT_EQ(fetch["tid"].toInt(), 2);
+    EXPECT_EQ(fetch["pid"], launch["pid"]);
+}
@@ -224,6 +224,27 @@ TEST_F(UbuntuImageHost, canQueryByPartialHash)
     EXPECT_FALSE(host.info_for(make_query("abcde", release_remote_spec.first)));
 }
 
+TEST_F(UbuntuImageHost, infoForFullHashReturnsExpectedInfo)
+{
+    mp::UbuntuVMImageHost host{{release_remote_spec}, &url_downloader};
+    host.update_manifests(false);
+
+    const auto info = host.info_for_full_hash(expected_id.toStdString());
+
+    EXPECT_THAT(info.id, Eq(expected_id));
+    EXPECT_THAT(info.image_location, Eq(expected_location));
+}
+
+TEST_F(UbuntuImageHost, infoForFullHashThrowsOnPartialHash)
+{
+    mp::UbuntuVMImageHost host{all_remote_specs, &url_downloader};
+    host.update_manifests(false);
+
+    MP_EXPECT_THROW_THAT(host.info_for_full_hash(expected_id.left(12).toStdString()),
+                         std::runtime_error,
+                         mpt::match_what(HasSubstr("Unable to find an image matching hash")));
+}
+
 TEST_F(UbuntuImageHost, supportsMultipleManifests)
 {
     mp::UbuntuVMImageHost host{all_remote_specs, &url_downloader};
@@ -23,6 +23,7 @@
 #include "mock_ssh.h"
 #include "mock_ssh_process_exit_status.h"
 #include "mock_ssh_test_fixture.h"
+#include "mock_utils.h"
 #include "mock_virtual_machine.h"
 #include "stub_ssh_key_provider.h"
 #include "temp_dir.h"
@@ -456,6 +457,23 @@ TEST(Utils, tryActionDoesNotTimeout)
     EXPECT_TRUE(action_called);
 }
 
+TEST(Utils, tryActionEveryRetriesAtGivenInterval)
+{
+    auto [mock_utils_ptr, guard] = mpt::MockUtils::inject();
+    EXPECT_CALL(*mock_utils_ptr, sleep_for(std::chrono::milliseconds(250))).Times(1);
+
+    auto attempts = 0;
+    auto action = [&attempts] {
+        return ++attempts < 2 ? mp::utils::TimeoutAction::retry : mp::utils::TimeoutAction::done;
+    };
+    mp::utils::try_action_every(std::chrono::milliseconds(250),
+                                [] { FAIL() << "unexpected timeout"; },
+                                std::chrono::seconds(10),
+                                action);
+
+    EXPECT_EQ(attempts, 2);
+}
+
 TEST(Utils, uuidHasNoCurlyBrackets)
 {
     auto uuid = mp::utils::make_uuid();
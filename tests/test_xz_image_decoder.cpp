@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "common.h"
+#include "file_operations.h"
+#include "path.h"
+#include "temp_dir.h"
+
+#include <multipass/progress_monitor.h>
+#include <multipass/rpc/multipass.grpc.pb.h>
+#include <multipass/xz_image_decoder.h>
+
+#include <algorithm>
+
+namespace mp = multipass;
+namespace mpt = multipass::test;
+
+using namespace testing;
+
+namespace
+{
+struct XzImageDecoder : public Test
+{
+    // Both test files hold these 16000 bytes, compressed as 4 blocks and as a single one
+    QByteArray expected_image()
+    {
+        QByteArray image;
+        for (auto i = 0; i < 1000; ++i)
+            image += QByteArray::number(i).rightJustified(5, '0').prepend("multipass ") + "\n";
+
+        return image;
+    }
+
+    mp::ProgressMonitor recording_monitor()
+    {
+        return [this](int type, int progress) {
+            EXPECT_EQ(type, mp::LaunchProgress::EXTRACT);
+            reported_progress.push_back(progress);
+            return true;
+        };
+    }
+
+    mpt::TempDir temp_dir;
+    const QString decoded_path{temp_dir.filePath("decoded.img")};
+    const mp::XzImageDecoder decoder{4}; // multi-block files take the parallel path on any host
+    std::vector<int> reported_progress;
+};
+} // namespace
+
+TEST_F(XzImageDecoder, decodesMultiBlockFile)
+{
+    decoder.decode_to(mpt::test_data_path_for("multi_block.img.xz"),
+                      decoded_path,
+                      recording_monitor());
+
+    EXPECT_EQ(mpt::load(decoded_path), expected_image());
+}
+
+TEST_F(XzImageDecoder, decodesMultiBlockFileSequentiallyWithOneThread)
+{
+    const mp::XzImageDecoder sequential_decoder{1};
+    sequential_decoder.decode_to(mpt::test_data_path_for("multi_block.img.xz"),
+                                 decoded_path,
+                                 recording_monitor());
+
+    EXPECT_EQ(mpt::load(decoded_path), expected_image());
+}
+
+TEST_F(XzImageDecoder, decodesSingleBlockFile)
+{
+    decoder.decode_to(mpt::test_data_path_for("single_block.img.xz"),
+                      decoded_path,
+                      recording_monitor());
+
+    EXPECT_EQ(mpt::load(decoded_path), expected_image());
+}
+
+TEST_F(XzImageDecoder, reportsProgressUpToCompletion)
+{
+    decoder.decode_to(mpt::test_data_path_for("multi_block.img.xz"),
+                      decoded_path,
+                      recording_monitor());
+
+    ASSERT_FALSE(reported_progress.empty());
+    EXPECT_TRUE(std::is_sorted(reported_progress.begin(), reported_progress.end()));
+    EXPECT_EQ(reported_progress.back(), 100);
+}
+
+TEST_F(XzImageDecoder, throwsOnCorruptBlock)
+{
+    auto xz_data = mpt::load_test_file("multi_block.img.xz");
+    xz_data[300] = ~xz_data[300]; // inside the second block
+
+    const auto xz_path = temp_dir.filePath("corrupt.img.xz");
+    mpt::make_file_with_content(xz_path, xz_data.toStdString());
+
+    EXPECT_THROW(decoder.decode_to(xz_path, decoded_path, recording_monitor()),
+                 std::runtime_error);
+}
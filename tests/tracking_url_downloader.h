@@ -47,6 +47,16 @@ struct TrackingURLDownloader : public URLDownloader
         downloaded_files << file_name;
     }
 
+    void stream_to(const QUrl& url,
+                   const DataHandler& on_data,
+                   int64_t size,
+                   const int download_type,
+                   const ProgressMonitor&) override
+    {
+        on_data(QByteArray::fromStdString(content));
+        downloaded_urls << url.toString();
+    }
+
     QByteArray download(const QUrl& url) override
     {
         return {};